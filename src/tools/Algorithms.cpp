@@ -3,6 +3,7 @@
 #include <tools/AlgorithmsTools.h>
 #include <tools/Threading.h>
 
+#include <algorithm>
 #include <emmintrin.h>
 #ifdef WINDOWS_PLATFORM
 #  include <Windows.h>
@@ -10,6 +11,9 @@
 #endif // WINDOWS_PLATFORM
 #ifdef UNIX_PLATFORM
 #  include <assert.h>
+#  ifdef __x86_64__
+#    include <cpuid.h>
+#  endif // __x86_64__
 #  include <fcntl.h>
 #  include <sys/stat.h>
 #  include <sys/types.h>
@@ -291,10 +295,168 @@ RandomStateImpl::certify(void)
     }
 }
 
+namespace {
+    // Slicing-by-8 tables for CRC32C (reflected polynomial 0x82F63B78), without pre/post inversion to
+    // match the crc32 instruction.
+    struct Crc32cTables
+    {
+        Crc32cTables(void)
+        {
+            for (uint32 i = 0U; i != 256U; ++i) {
+                uint32 crc = i;
+                for (unsigned bit = 0U; bit != 8U; ++bit) {
+                    crc = ((crc & 1U) != 0U) ? ((crc >> 1) ^ 0x82F63B78U) : (crc >> 1);
+                }
+                t_[0][i] = crc;
+            }
+            for (unsigned k = 1U; k != 8U; ++k) {
+                for (uint32 i = 0U; i != 256U; ++i) {
+                    t_[k][i] = (t_[k - 1U][i] >> 8) ^ t_[0][t_[k - 1U][i] & 0xFFU];
+                }
+            }
+        }
+
+        uint32 t_[8][256];
+    };
+
+    // Function local, StringIds hash during static initialization.
+    Crc32cTables const & crc32cTables(void)
+    {
+        static Crc32cTables tables;
+        return tables;
+    }
+
+#if defined(UNIX_PLATFORM) && defined(__x86_64__) && defined(TOOLS_ARCH_UNKNOWN)
+    // Built without assuming SSE 4.2, so only called once cpuid has reported it. The target applies to the
+    // lambdas as well, letting the instruction inline into the loop.
+#  pragma GCC push_options
+#  pragma GCC target("sse4.2")
+    uint32 hashBytesSse42(void const * data, size_t len, uint32 initial)
+    {
+        return hashBytesWith(static_cast<uint8 const *>(data), len, initial, [](uint32 crc, uint64 v)->uint32 {
+            return static_cast<uint32>(_mm_crc32_u64(crc, v));
+        }, [](uint8 const * p)->uint64 {
+            uint64 ret;
+            memcpy(&ret, p, sizeof(ret));
+            return ret;
+        });
+    }
+#  pragma GCC pop_options
+
+    // Function local, for the same reason as the tables.
+    bool crc32cHardware(void)
+    {
+        static bool const has = []()->bool {
+            unsigned a, b, c, d;
+            return (__get_cpuid(1U, &a, &b, &c, &d) != 0) && ((c & bit_SSE4_2) != 0U);
+        }();
+        return has;
+    }
+#endif // UNIX_PLATFORM && __x86_64__ && TOOLS_ARCH_UNKNOWN
+
+    // Find a displacement for every bucket, largest buckets first. Fails if some bucket cannot be placed in
+    // a reasonable number of tries, in which case the caller retries with more slots.
+    bool perfectHashPlace(uint32 const * hashes, size_t count, uint32 buckets, uint32 slots, std::vector<uint32> & displacements, std::vector<uint32> & slotOf)
+    {
+        static const uint32 maxTries = 1U << 16;
+        std::vector<std::vector<uint32>> members(buckets);
+        for (uint32 i = 0U; i != count; ++i) {
+            members[hashes[i] & (buckets - 1U)].push_back(i);
+        }
+        std::vector<uint32> order(buckets);
+        for (uint32 i = 0U; i != buckets; ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32 l, uint32 r)->bool {
+            return members[l].size() > members[r].size();
+        });
+        displacements.assign(buckets, 0U);
+        slotOf.assign(count, 0U);
+        std::vector<bool> used(slots, false);
+        for (auto && bucket : order) {
+            std::vector<uint32> const & bucketMembers = members[bucket];
+            if (bucketMembers.empty()) {
+                break;
+            }
+            bool placed = false;
+            for (uint32 displacement = 0U; !placed && (displacement != maxTries); ++displacement) {
+                size_t marked = 0U;
+                for (; marked != bucketMembers.size(); ++marked) {
+                    uint32 slot = tools::impl::perfectHashSlot(hashes[bucketMembers[marked]], displacement, slots);
+                    if (used[slot]) {
+                        break;
+                    }
+                    used[slot] = true;
+                    slotOf[bucketMembers[marked]] = slot;
+                }
+                placed = (marked == bucketMembers.size());
+                if (placed) {
+                    displacements[bucket] = displacement;
+                } else {
+                    while (marked != 0U) {
+                        used[slotOf[bucketMembers[--marked]]] = false;
+                    }
+                }
+            }
+            if (!placed) {
+                return false;
+            }
+        }
+        return true;
+    }
+};  // anonymous namespace
+
 ///////////////////////
 // Non-member Functions
 ///////////////////////
 
+uint32 tools::impl::hashBytesPortable(void const * data, size_t len, uint32 initial)
+{
+    uint32 const (&t)[8][256] = crc32cTables().t_;
+    return hashBytesWith(static_cast<uint8 const *>(data), len, initial, [&t](uint32 crc, uint64 v)->uint32 {
+        uint64 x = v ^ crc;
+        return t[7][x & 0xFFU] ^ t[6][(x >> 8) & 0xFFU] ^ t[5][(x >> 16) & 0xFFU] ^ t[4][(x >> 24) & 0xFFU]
+            ^ t[3][(x >> 32) & 0xFFU] ^ t[2][(x >> 40) & 0xFFU] ^ t[1][(x >> 48) & 0xFFU] ^ t[0][x >> 56];
+    }, [](uint8 const * p)->uint64 {
+        return hashBytesTail(p, 8U);
+    });
+}
+
+uint32 tools::impl::hashBytesRuntime(void const * data, size_t len, uint32 initial)
+{
+#ifdef TOOLS_ARCH_X86
+    return hashBytes(data, len, initial);
+#elif defined(UNIX_PLATFORM) && defined(__x86_64__)
+    if (crc32cHardware()) {
+        return hashBytesSse42(data, len, initial);
+    }
+    return hashBytesPortable(data, len, initial);
+#else // TOOLS_ARCH_X86
+    return hashBytesPortable(data, len, initial);
+#endif // TOOLS_ARCH_X86
+}
+
+bool tools::impl::hashBytesHardware(void)
+{
+#ifdef TOOLS_ARCH_X86
+    return true;
+#elif defined(UNIX_PLATFORM) && defined(__x86_64__)
+    return crc32cHardware();
+#else // TOOLS_ARCH_X86
+    return false;
+#endif // TOOLS_ARCH_X86
+}
+
+void tools::impl::perfectHashBuild(uint32 const * hashes, size_t count, uint32 & buckets, uint32 & slots, std::vector<uint32> & displacements, std::vector<uint32> & slotOf)
+{
+    uint32 count32 = static_cast<uint32>(count);
+    buckets = roundToPow2(std::max(count32 / 4U, 1U));
+    slots = roundToPow2(std::max(count32 + (count32 / 4U), 1U));
+    while (!perfectHashPlace(hashes, count, buckets, slots, displacements, slotOf)) {
+        slots *= 2U;
+    }
+}
+
 sint32 tools::randomS32(void)
 {
     return randomHandle_->rndS32();
@@ -329,3 +491,117 @@ AutoDispose<RandomState> tools::randomStateNew(uint8 const * key, unsigned lengt
 {
     return new RandomStateImpl(key, length);
 }
+
+#include <tools/UnitTest.h>
+#if TOOLS_UNIT_TEST
+#include <tools/Environment.h>
+#include <tools/Timing.h>
+
+namespace {
+    // The byte-at-a-time hash StringId used before hashBytes, kept for comparison.
+    TOOLS_NO_INLINE uint32 hashBytesLegacy(void const * data, size_t len)
+    {
+        size_t ret = 0;
+        char const * str = static_cast<char const *>(data);
+        char const * end = str + len;
+        for (; str != end; ++str) {
+            ret = ret ^ ((ret << 10) + (ret >> 3) + *str);
+        }
+        return static_cast<uint32>(ret);
+    }
+
+    void hashBytesFill(uint8 * buf, size_t len)
+    {
+        for (size_t i = 0U; i != len; ++i) {
+            buf[i] = static_cast<uint8>((i * 37U) + 11U);
+        }
+    }
+};  // anonymous namespace
+
+TOOLS_TEST_CASE("hashBytes.portable", [](Test &)
+{
+    // The hardware and table versions must agree, at every alignment and across every tail length.
+    uint8 buf[320];
+    hashBytesFill(buf, sizeof(buf));
+    for (size_t offset = 0U; offset != 8U; ++offset) {
+        for (size_t len = 0U; len != 300U; ++len) {
+            TOOLS_ASSERTR(tools::impl::hashBytes(buf + offset, len, 0x1234U) == tools::impl::hashBytesPortable(buf + offset, len, 0x1234U));
+            TOOLS_ASSERTR(tools::impl::hashBytesRuntime(buf + offset, len, 0x1234U) == tools::impl::hashBytesPortable(buf + offset, len, 0x1234U));
+        }
+    }
+});
+
+TOOLS_TEST_CASE("hashBytes.distinct", [](Test &)
+{
+    uint8 buf[264];
+    uint8 other[264];
+    hashBytesFill(buf, sizeof(buf));
+    // Position independent
+    memcpy(other + 3U, buf, 256U);
+    TOOLS_ASSERTR(tools::impl::hashBytes(buf, 256U, 0U) == tools::impl::hashBytes(other + 3U, 256U, 0U));
+    // Every bit matters, in every lane and in the tail
+    uint32 base = tools::impl::hashBytes(buf, 61U, 0U);
+    for (size_t i = 0U; i != 61U; ++i) {
+        for (unsigned bit = 0U; bit != 8U; ++bit) {
+            buf[i] ^= static_cast<uint8>(1U << bit);
+            TOOLS_ASSERTR(tools::impl::hashBytes(buf, 61U, 0U) != base);
+            buf[i] ^= static_cast<uint8>(1U << bit);
+        }
+    }
+    // Zero fill does not alias shorter keys, and the seed matters
+    memset(other, 0, sizeof(other));
+    for (size_t len = 0U; len != 16U; ++len) {
+        TOOLS_ASSERTR(tools::impl::hashBytes(other, len, 0U) != tools::impl::hashBytes(other, len + 1U, 0U));
+        TOOLS_ASSERTR(tools::impl::hashBytes(other, len, 0U) != tools::impl::hashBytes(other, len, 1U));
+    }
+    // Containers hash by content
+    std::string str("hashBytes distinct string");
+    std::string str2(str);
+    TOOLS_ASSERTR(HashAnyOf<std::string>()(str) == HashAnyOf<std::string>()(str2));
+    str2[0] = 'H';
+    TOOLS_ASSERTR(HashAnyOf<std::string>()(str) != HashAnyOf<std::string>()(str2));
+    std::vector<uint8> vec(buf, buf + 40U);
+    TOOLS_ASSERTR(HashAnyOf<std::vector<uint8>>()(vec) == tools::impl::hashBytes(buf, 40U, hashAnyInit<std::vector<uint8>>()));
+});
+
+TOOLS_TEST_CASE("hashBytes.throughput", testParamValues({ 8U, 16U, 32U, 64U, 128U, 256U }), [](Test & test, unsigned len)
+{
+    static const unsigned iterations = 2000000U;
+    auto timing = test.environment().unmockNow<Timing>();
+    uint8 buf[256 + 8];
+    hashBytesFill(buf, sizeof(buf));
+    uint32 volatile sink = 0U;
+    uint64 start = timing->mark();
+    for (unsigned i = 0U; i != iterations; ++i) {
+        sink = tools::impl::hashBytes(buf + (i & 7U), len, sink);
+    }
+    uint64 hashed = timing->mark(start);
+    start = timing->mark();
+    for (unsigned i = 0U; i != iterations; ++i) {
+        sink = tools::impl::hashBytesPortable(buf + (i & 7U), len, sink);
+    }
+    uint64 portable = timing->mark(start);
+    start = timing->mark();
+    for (unsigned i = 0U; i != iterations; ++i) {
+        sink = sink + hashBytesLegacy(buf + (i & 7U), len);
+    }
+    uint64 legacy = timing->mark(start);
+    if (testTimingsReported()) {
+        double bytes = static_cast<double>(iterations) * static_cast<double>(len);
+        fprintf(stderr, "hashBytes %u bytes (%s): %.2f ns/hash (%.2f GB/s), portable: %.2f ns/hash, legacy byte loop: %.2f ns/hash\n", len,
+            tools::impl::hashBytesHardware() ? "crc32 instruction" : "tables",
+            static_cast<double>(hashed) / static_cast<double>(iterations), bytes / static_cast<double>(hashed),
+            static_cast<double>(portable) / static_cast<double>(iterations),
+            static_cast<double>(legacy) / static_cast<double>(iterations));
+    }
+    // Word at a time tables beat a byte at a time loop once the setup is paid for
+    if (len >= 128U) {
+        TOOLS_ASSERTR(portable < legacy);
+    }
+    if (tools::impl::hashBytesHardware() && (len >= 64U)) {
+        // Past the call overhead, the instruction has to beat the tables
+        TOOLS_ASSERTR(hashed < portable);
+    }
+});
+
+#endif /* TOOLS_UNIT_TEST */
@@ -13,7 +13,7 @@ namespace tools {
         , Notifiable< InternalAssetSingleton >
         , Completable< InternalAssetSingleton >
     {
-        typedef std::unordered_map< StringId, AutoDispose< Asset >, std::hash< StringId >, std::equal_to< StringId >, AllocatorAffinity< std::pair< StringId, AutoDispose< Asset >>>> ChildMap;
+        typedef std::unordered_map< StringId, AutoDispose< Asset >, StringIdHash, StringIdEqual, AllocatorAffinity< std::pair< StringId, AutoDispose< Asset >>>> ChildMap;
 
         InternalAssetSingleton( AutoDispose< Asset > &, AutoDispose< AssetLoader > &, StringId const &, AssetSingletonFactory & );
 
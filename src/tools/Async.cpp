@@ -6,6 +6,8 @@
 #include <tools/Threading.h>
 #include <tools/WeakPointer.h>
 
+#include "TimingImpl.h"
+
 using namespace tools;
 
 ////////
@@ -191,11 +193,24 @@ tools::runRequestSynchronously( NoDispose< Request > const & req )
         AutoDispose<> p_( phantomTryBindPrototype< PhantomUniversal >() );
         req->start( thunk.toCompletion< &SyncThunk::completed >() );
     }
-    {
+    // A scheduler worker fires its own timers, and what this waits on may be one of them.
+    TimerQueueOwner * timers = impl::timerQueueLocal();
+    for(;;) {
+        uint64 due = 0U;  // while another worker is firing them, look again straight away
+        if( !!timers ) {
+            // Outside the monitor, as firing one may complete the request. Through the owner, which keeps
+            // this from racing an idle worker evaluating the same queue.
+            timers->eval( &due );
+        }
         AutoDispose<> l_( thunk.local_->monitor_->enter() );
-        while( !thunk.complete_ ) {
+        if( thunk.complete_ ) {
+            break;
+        }
+        if( !timers ) {
             thunk.local_->cvar_->wait();
-            // TODO: consider adding a timeout
+        } else {
+            uint64 now = impl::getHighResTime();
+            thunk.local_->cvar_->wait(( due > now ) ? ( due - now ) : 0U );
         }
     }
     return std::move( thunk.error_ );
@@ -2,6 +2,7 @@
 
 #include <tools/Algorithms.h>
 #include <tools/AsyncTools.h>
+#include <tools/AtomicCollections.h>
 #include <tools/Concurrency.h>
 #include <tools/InterfaceTools.h>
 #include <tools/Threading.h>
@@ -438,6 +439,41 @@ namespace {
         bool doDump_;
     };
 
+    // Timers armed on a worker stay with it, rather than going through the timer thread, and are fired by the
+    // worker itself between tasks or when it wakes from idle for them. They then run on the core that armed
+    // them, without the hop from the timer thread. While the worker is stuck in a long task, idle workers
+    // fire what comes due in its place.
+    //
+    // These live as long as the scheduler, so that other workers can look at them after the worker exits.
+    struct TaskTimers
+        : Notifiable< TaskTimers >
+        , TimerQueueOwner
+    {
+        TaskTimers( ConditionVar &, Monitor & );
+
+        // TimerQueueOwner
+        TimerQueue & queue( void );
+        // Also returns false if nothing fired.
+        bool eval( uint64 * = nullptr );
+
+        // local methods
+        // Stop taking timers, and cancel those still waiting.
+        void close( void );
+        // Whether a worker other than the owner should evaluate these.
+        bool overdue( uint64 );
+        // How long idle can last, before the next is due.
+        uint64 nap( void );
+        void notifyWake( void );
+
+        ConditionVar & idle_;
+        Monitor & idleLock_;
+        AutoDispose< TimerQueue > queue_;
+        uint64 volatile due_;
+        unsigned volatile kicked_;  // armed or moved since the last eval
+        unsigned volatile evaluating_;  // held by whichever worker evaluates, and for good once closed
+        unsigned volatile busy_;  // the worker is not idle
+    };
+
     struct SchedulerBind;
 
 	struct TaskSchedImpl
@@ -448,9 +484,11 @@ namespace {
 	{
         enum : uint64 {
             kickTimeout = 628ULL * TOOLS_NANOSECONDS_PER_MILLISECOND,  // 2pi 100 milliseconds
+            kickSlack = 100ULL * TOOLS_NANOSECONDS_PER_MILLISECOND,  // the kick is housekeeping, let it share a wakeup
         };
 
 		typedef std::vector< std::unique_ptr< TaskLocalQueue >, AllocatorAffinity< std::unique_ptr< TaskLocalQueue >>> Queues;
+        typedef std::vector< std::unique_ptr< TaskTimers >, AllocatorAffinity< std::unique_ptr< TaskTimers >>> Timers;
 
 		TaskSchedImpl( Environment & );
 		~TaskSchedImpl( void );
@@ -474,6 +512,8 @@ namespace {
 		void threadEntry( void );
         void runAndReport( Task *, SchedulerBind *, impl::HungThreadDetector *, WorkDoneItem * );
         bool peek( void );
+        bool stealTimers( TaskTimers * );
+        uint64 idleNap( TaskTimers * );
         // TODO: These may no longer be needed
 		void notifyKick( Error * );
 		void preIdle( void );
@@ -483,6 +523,7 @@ namespace {
 		Timing & timer_;
 		AutoDispose< Monitor > peersLock_;
 		Queues peers_;
+        Timers timers_;  // parallel to peers_
 		unsigned volatile peersUsed_;
 		std::unique_ptr<OrderedTasksSet> ordered_;
 		std::unique_ptr<ThreadSafeOrderedTasks> orderedSpawns_;
@@ -2146,6 +2187,96 @@ TaskThreadStats::sleep( void )
     // TODO: log for each item in dequeued_: enqueue time (queueTime_), start time (startTime_), run time (runTime_), name (symbol name from addr (callSite_)), thread ID (threadId_), if longQueued_
 }
 
+/////////////
+// TaskTimers
+/////////////
+
+TaskTimers::TaskTimers(
+    ConditionVar & idle,
+    Monitor & idleLock )
+    : idle_( idle )
+    , idleLock_( idleLock )
+    , queue_( impl::timerQueueNew( toThunk< &TaskTimers::notifyWake >() ))
+    , due_( UINT64_MAX )
+    , kicked_( 0U )
+    , evaluating_( 0U )
+    , busy_( 1U )
+{
+    impl::timerQueueBindLocal( this );
+}
+
+TimerQueue &
+TaskTimers::queue( void )
+{
+    return *queue_;
+}
+
+void
+TaskTimers::close( void )
+{
+    impl::timerQueueBindLocal( nullptr );
+    // Wait out any worker firing these, and keep them out. Timers still referring to the queue keep it
+    // alive, closed.
+    while( atomicCas( &evaluating_, 0U, 1U ) != 0U ) {
+        tools::detail::atomicSpinPause();
+    }
+    queue_.reset();
+    // Nothing here for idle workers to wait for.
+    atomicSet( &busy_, 0U );
+    atomicSet( &due_, UINT64_MAX );
+}
+
+bool
+TaskTimers::eval(
+    uint64 * next )
+{
+    if( atomicCas( &evaluating_, 0U, 1U ) != 0U ) {
+        return false;
+    }
+    atomicSet( &kicked_, 0U );
+    uint64 fired = queue_->stats().fired_;
+    uint64 due;
+    queue_->eval( &due );
+    atomicSet( &due_, due );
+    if( !!next ) {
+        *next = due;
+    }
+    bool ret = ( queue_->stats().fired_ != fired );
+    atomicSet( &evaluating_, 0U );
+    return ret;
+}
+
+bool
+TaskTimers::overdue(
+    uint64 now )
+{
+    // An idle owner fires its own; a kick means the owner hasn't yet seen a timer it armed.
+    if( !atomicRead( &busy_ ) || !!atomicRead( &evaluating_ )) {
+        return false;
+    }
+    return !!atomicRead( &kicked_ ) || ( now >= atomicRead( &due_ ));
+}
+
+uint64
+TaskTimers::nap( void )
+{
+    uint64 now = impl::getHighResTime();
+    uint64 due = atomicRead( &due_ );
+    return ( due > now ) ? ( due - now ) : 0U;
+}
+
+void
+TaskTimers::notifyWake( void )
+{
+    atomicSet( &kicked_, 1U );
+    if( impl::timerQueueLocal() != this ) {
+        // Started or moved from another thread, and the worker may be idle. Under the lock, so this can't
+        // fall between it seeing no kick and it starting to wait.
+        AutoDispose<> l( idleLock_.enter() );
+        idle_.signal( true );
+    }
+}
+
 ////////////////
 // TaskSchedImpl
 ////////////////
@@ -2177,12 +2308,14 @@ TaskSchedImpl::TaskSchedImpl(
 	, kickShutdown_( false )
 {
 	peers_.resize( 48 );
+    timers_.resize( 48 );
 }
 
 TaskSchedImpl::~TaskSchedImpl( void )
 {
 	// delete the queues manually to avoid locking during thread termination.
 	peers_.clear();
+    timers_.clear();
 }
 
 void
@@ -2352,7 +2485,8 @@ TaskSchedImpl::reportQtime(
     TaskThreadStats * stats )
 {
     WorkDoneItem item( task );
-    auto now = impl::getHighResTime();
+    // The end of the last task to run is close enough, but the task may have been queued since.
+    auto now = std::max( impl::getCoarseTime(), task->queueTime_ );
     if( ( task->queueTime_ + TOOLS_NANOSECONDS_PER_SECOND ) < now ) {
         TOOLS_ASSERT( !!task->callSite_ );
         auto delay = ( now - task->queueTime_ ) / TOOLS_NANOSECONDS_PER_MILLISECOND;
@@ -2376,8 +2510,12 @@ TaskSchedImpl::threadEntry( void )
 	annotation->setScheduler( this );
 	TaskLocalStat stat;
 	TaskLocalQueue * queue = new TaskLocalQueue( &stat );
-	size_t peerOffset = peersUsed_++;
+	size_t peerOffset = peersUsed_;
 	peers_[ peerOffset ] = std::unique_ptr< TaskLocalQueue >( queue );
+    timers_[ peerOffset ] = std::unique_ptr< TaskTimers >( new TaskTimers( *idleCvar_, *idleLock_ ));
+    TaskTimers & timers = *timers_[ peerOffset ];
+    // Only now can other workers see this one.
+    atomicIncrement( &peersUsed_ );
 	localScheduler_->queue_ = queue;
 	l.reset();
     atomicIncrement( &awake_ );  // This thread is running!
@@ -2402,6 +2540,10 @@ TaskSchedImpl::threadEntry( void )
         } else {
             // Quick recycle
             prototype->touch();
+        }
+        // Local timers first, seeing whether any are due costs next to nothing.
+        if( TOOLS_UNLIKELY( !!atomicRead( &timers.kicked_ ) || ( impl::getCoarseTime() >= atomicRead( &timers.due_ )))) {
+            timers.eval();
         }
 		// Let's find some work! Start with spawn all.
 		if( Task * t = queue->popQueueAll() ) {
@@ -2517,6 +2659,14 @@ TaskSchedImpl::threadEntry( void )
 		} else {
 			externalStat_->idle();
 		}
+        // Fire what is due before sleeping, it may have made more work.
+        if( timers.eval() ) {
+            continue;
+        }
+        // Then what is due on workers stuck in a task, which would otherwise wait until it ends.
+        if( stealTimers( &timers )) {
+            continue;
+        }
         // Drop the phantom before trying to sleep
         phantomEntry.reset();
         measure.sleep();
@@ -2529,13 +2679,22 @@ TaskSchedImpl::threadEntry( void )
 		preIdle(); // make sure we'll get woken up eventually
         {
 		    AutoDispose<> lIdle( idleLock_->enter() );
-		    idleCvar_->wait();
+            atomicSet( &timers.busy_, 0U );
+            // Sleep until the next timer this may fire, unless one has been armed since it was last looked at.
+            if( !atomicRead( &timers.kicked_ )) {
+		        idleCvar_->wait( idleNap( &timers ));
+            }
         }
+        atomicSet( &timers.busy_, 1U );
         atomicIncrement( &awake_ );
         measure.wake();
+        // Anything queued while every worker slept is measured against this.
+        impl::tickCoarseTime( impl::getHighResTime() );
 	}
     annotation->reset();
     detector->disarm();
+    // Cancellations run completions, so do this before taking the lock.
+    timers.close();
 	// synchronize shutdown
 	l = peersLock_->enter();
 	// I am not the scheduler for this thread anymore.
@@ -2554,6 +2713,7 @@ TaskSchedImpl::runAndReport(
     auto callSite = task->callSite_;
     task->execute();
     auto after = impl::getHighResTime();
+    impl::tickCoarseTime( after );
     detector->noteExecFinish();
     reportRunTime( callSite, before, after, item, awake_ );
     if( !!annotation ) {
@@ -2568,6 +2728,39 @@ TaskSchedImpl::peek( void )
     return ( atomicRead( &awake_ ) >= peekThreshold_ );
 }
 
+bool
+TaskSchedImpl::stealTimers(
+    TaskTimers * self )
+{
+    uint64 now = impl::getHighResTime();
+    size_t sz = atomicRead( &peersUsed_ );
+    bool ret = false;
+    for( size_t i=0; i!=sz; ++i ) {
+        TaskTimers * t = timers_[ i ].get();
+        if( t == self || !t->overdue( now )) {
+            continue;
+        }
+        ret |= t->eval();
+    }
+    return ret;
+}
+
+// Until the worker's own next timer, or the next of a busy worker, which this one may need to fire.
+uint64
+TaskSchedImpl::idleNap(
+    TaskTimers * self )
+{
+    uint64 nap = self->nap();
+    size_t sz = atomicRead( &peersUsed_ );
+    for( size_t i=0; i!=sz; ++i ) {
+        TaskTimers * t = timers_[ i ].get();
+        if( t != self && !!atomicRead( &t->busy_ )) {
+            nap = std::min( nap, t->nap() );
+        }
+    }
+    return nap;
+}
+
 void
 TaskSchedImpl::notifyKick(
 	Error * err )
@@ -2595,7 +2788,11 @@ TaskSchedImpl::preIdle( void )
 		if( !!kick_ || atomicRead( &shutdown_ )) {
 			return;
 		}
-		kick_ = std::move( timer_.timer( kickTimeout ) );
+		// The kick backs up every worker, so it goes to the timer thread rather than this worker's queue.
+		TimerQueueOwner * local = impl::timerQueueLocal();
+		impl::timerQueueBindLocal( nullptr );
+		kick_ = std::move( timer_.timer( kickTimeout, nullptr, kickSlack ) );
+		impl::timerQueueBindLocal( local );
 	}
 	kick_->start( toCompletion< &TaskSchedImpl::notifyKick >() );
 }
@@ -3356,6 +3553,8 @@ ThreadScheduler::fork(
 #include <tools/Interface.h>
 #include <tools/Timing.h>
 
+#include <vector>
+
 //////////
 // Testing
 //////////
@@ -3376,6 +3575,30 @@ namespace {
         unsigned volatile flag1_;
         unsigned volatile flag2_;
     };
+
+    struct ScalableTestImpl
+        : Notifiable< ScalableTestImpl >
+    {
+        enum : unsigned {
+            incrementsPerThread = 1000000U,
+        };
+
+        ScalableTestImpl( Threading &, Timing & );
+
+        // Runs the support method on this many threads at once, returning how long until all are done.
+        uint64 timed( Thunk const &, unsigned );
+
+        // support methods
+        void counterSupport( void );
+        void atomicSupport( void );
+        void histogramSupport( void );
+
+        Threading & threading_;
+        Timing & timing_;
+        ScalableCounter counter_;
+        ScalableHistogram histogram_;
+        uint64 volatile shared_;
+    };
 };  // anonymous namespace
 
 ////////
@@ -3442,6 +3665,95 @@ TOOLS_TEST_CASE("threading.trivial.single", "environment isn't disposing things
     TOOLS_ASSERTR(!!state.flag2_);
 });
 
+TOOLS_TEST_CASE("ScalableCounter.basic", [](Test &)
+{
+    ScalableCounter counter;
+    TOOLS_ASSERTR( static_cast< uint64 >( counter ) == 0U );
+    counter += 10U;
+    counter -= 3U;
+    TOOLS_ASSERTR( static_cast< uint64 >( counter ) == 7U );
+});
+
+TOOLS_TEST_CASE("ScalableCounter.concurrent", testParamValues({ 1U, 2U, 4U, 8U, 16U }), [](Test & test, unsigned threads)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    auto timing = test.environment().unmockNow<Timing>();
+    AutoDispose<> lifetime;
+    ScalableTestImpl * state;
+    lifetime = anyDisposableAllocNew< AllocStatic< Platform >>( &state, *threading, *timing );
+    uint64 scalable = state->timed( state->toThunk< &ScalableTestImpl::counterSupport >(), threads );
+    uint64 shared = state->timed( state->toThunk< &ScalableTestImpl::atomicSupport >(), threads );
+    uint64 total = static_cast< uint64 >( threads ) * ScalableTestImpl::incrementsPerThread;
+    TOOLS_ASSERTR( static_cast< uint64 >( state->counter_ ) == total );
+    TOOLS_ASSERTR( state->shared_ == total );
+    if( testTimingsReported() ) {
+        fprintf( stderr, "ScalableCounter %u threads: %.2f ns/increment, shared atomic: %.2f ns/increment\n", threads,
+            static_cast< double >( scalable * threads ) / static_cast< double >( total ),
+            static_cast< double >( shared * threads ) / static_cast< double >( total ));
+    }
+    if( ( threads >= 2U ) && ( threads <= tools::impl::cpuCount() )) {
+        // Threads running at once fight over the shared atomic's cache line, and not over the counter's.
+        TOOLS_ASSERTR( scalable < shared );
+    }
+});
+
+TOOLS_TEST_CASE("ScalableHistogram.buckets", [](Test &)
+{
+    // Buckets are contiguous, ordered, and their bounds agree with bucketOf
+    TOOLS_ASSERTR( ScalableHistogram::bucketLow( 0U ) == 0U );
+    for( unsigned b = 0U; b != ScalableHistogram::bucketCount; ++b ) {
+        uint64 low = ScalableHistogram::bucketLow( b );
+        uint64 high = ScalableHistogram::bucketHigh( b );
+        TOOLS_ASSERTR( low <= high );
+        TOOLS_ASSERTR( ScalableHistogram::bucketOf( low ) == b );
+        TOOLS_ASSERTR( ScalableHistogram::bucketOf( high ) == b );
+        if( b != 0U ) {
+            TOOLS_ASSERTR( ScalableHistogram::bucketHigh( b - 1U ) + 1U == low );
+        }
+        // Relative error is bounded by the sub-bucket count
+        TOOLS_ASSERTR( ( high - low ) <= ( low / ScalableHistogram::subBuckets ));
+    }
+    TOOLS_ASSERTR( ScalableHistogram::bucketOf( ~static_cast< uint64 >( 0U )) == ( ScalableHistogram::bucketCount - 1U ));
+});
+
+TOOLS_TEST_CASE("ScalableHistogram.quantile", [](Test &)
+{
+    ScalableHistogram histogram;
+    TOOLS_ASSERTR( histogram.quantile( 0.5 ) == 0U );
+    for( uint64 i = 1U; i <= 1000U; ++i ) {
+        histogram.record( i * 1000U );
+    }
+    uint64 median = histogram.quantile( 0.5 );
+    TOOLS_ASSERTR( ( median >= 500000U ) && ( median <= 500000U + ( 500000U / ScalableHistogram::subBuckets )));
+    uint64 p99 = histogram.quantile( 0.99 );
+    TOOLS_ASSERTR( ( p99 >= 990000U ) && ( p99 <= 990000U + ( 990000U / ScalableHistogram::subBuckets )));
+    std::vector< uint64 > buckets( ScalableHistogram::bucketCount );
+    TOOLS_ASSERTR( histogram.collect( buckets.data() ) == 1000U );
+});
+
+TOOLS_TEST_CASE("ScalableHistogram.concurrent", testParamValues({ 1U, 4U, 16U }), [](Test & test, unsigned threads)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    auto timing = test.environment().unmockNow<Timing>();
+    AutoDispose<> lifetime;
+    ScalableTestImpl * state;
+    lifetime = anyDisposableAllocNew< AllocStatic< Platform >>( &state, *threading, *timing );
+    uint64 single = state->timed( state->toThunk< &ScalableTestImpl::histogramSupport >(), 1U );
+    uint64 elapsed = state->timed( state->toThunk< &ScalableTestImpl::histogramSupport >(), threads );
+    std::vector< uint64 > buckets( ScalableHistogram::bucketCount );
+    uint64 total = static_cast< uint64 >( threads + 1U ) * ScalableTestImpl::incrementsPerThread;
+    TOOLS_ASSERTR( state->histogram_.collect( buckets.data() ) == total );
+    if( testTimingsReported() ) {
+        fprintf( stderr, "ScalableHistogram %u threads: %.2f ns/record, alone: %.2f ns/record\n", threads,
+            static_cast< double >( elapsed ) / static_cast< double >( ScalableTestImpl::incrementsPerThread ),
+            static_cast< double >( single ) / static_cast< double >( ScalableTestImpl::incrementsPerThread ));
+    }
+    if( ( threads >= 4U ) && ( threads <= tools::impl::cpuCount() )) {
+        // Recording on separate slots, threads running at once take well under their serial time.
+        TOOLS_ASSERTR( ( 2U * elapsed ) < ( threads * single ));
+    }
+});
+
 ////////////////////
 // ThreadingTestImpl
 ////////////////////
@@ -3476,4 +3788,55 @@ ThreadingTestImpl::singleThreadSupport( void )
     atomicIncrement( &flag2_ );
 }
 
+///////////////////
+// ScalableTestImpl
+///////////////////
+
+ScalableTestImpl::ScalableTestImpl(
+    Threading & threading,
+    Timing & timing)
+    : threading_( threading )
+    , timing_( timing )
+    , shared_( 0U )
+{
+}
+
+uint64
+ScalableTestImpl::timed( Thunk const & entry, unsigned threads )
+{
+    std::vector< AutoDispose< Thread >> forked;
+    uint64 start = timing_.mark();
+    for( unsigned i = 0U; i != threads; ++i ) {
+        forked.push_back( threading_.fork( "scalableTesting", entry ));
+    }
+    for( auto && thr : forked ) {
+        thr->waitSync();
+    }
+    return timing_.mark( start );
+}
+
+void
+ScalableTestImpl::counterSupport( void )
+{
+    for( unsigned i = 0U; i != incrementsPerThread; ++i ) {
+        counter_ += 1U;
+    }
+}
+
+void
+ScalableTestImpl::atomicSupport( void )
+{
+    for( unsigned i = 0U; i != incrementsPerThread; ++i ) {
+        atomicIncrement( &shared_ );
+    }
+}
+
+void
+ScalableTestImpl::histogramSupport( void )
+{
+    for( unsigned i = 0U; i != incrementsPerThread; ++i ) {
+        histogram_.record( i );
+    }
+}
+
 #endif // TOOLS_UNIT_TETS
@@ -3,8 +3,11 @@
 #include <tools/Algorithms.h>
 #include <tools/Environment.h>
 #include <tools/Async.h>
+#include <tools/StartupProfile.h>
 // #include <tools/Notification.h>
 
+#include <algorithm>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -29,12 +32,67 @@ namespace {
         CycleTest * volatile root_;
     };
 
-  struct SimpleEnvironment
+  // The part of an environment that makes it usable from any thread. Services that have started are
+  // found in the published snapshot without locking. Everything else happens under a Writer, which
+  // serializes factorying (the thread that owns it may re-enter, as factories get their dependencies).
+  // Services are added to the snapshot in place, once started. It only gets replaced when it fills up, by
+  // one twice the size, so the snapshots kept for readers that may still be looking at them add up to less
+  // than the current one. When the outermost Writer leaves, the current snapshot is (re)published.
+  struct SnapshotEnvironment
     : Environment
+  {
+    struct Writer
+    {
+      Writer( SnapshotEnvironment & );
+      ~Writer( void );
+
+      bool outermost( void ) const { return outermost_; }
+
+      SnapshotEnvironment & env_;
+      bool outermost_;  // only the outermost Writer on a thread holds the monitor
+    };
+
+    // Lets go of the monitor for a while, from under any Writer. A start may get services from another
+    // thread, so none runs while the monitor is held.
+    struct Unlocked
+    {
+      Unlocked( SnapshotEnvironment & env ) : env_( env ) { env_.unlock(); }
+      ~Unlocked( void ) { env_.lock(); }
+
+      SnapshotEnvironment & env_;
+    };
+
+    SnapshotEnvironment( void );
+    ~SnapshotEnvironment( void );
+
+    Unknown * find( StringId const & );
+    void add( StringId const &, Unknown * );
+    void flush( void );
+    void withdraw( void );
+    void lock( void );
+    void unlock( void );
+    // Under a Writer, wait for the next start to finish on another thread.
+    void waitStarted( void );
+    // Outside any Writer, once a start has finished.
+    void notifyStarted( void );
+
+    AutoDispose< Monitor > monitor_;
+    AutoDispose<> lock_;  // monitor_, entered by the outermost Writer
+    ThreadCycle * volatile owner_;
+    AutoDispose< ConditionVar > startedCvar_;
+    AutoDispose< Monitor > startedLock_;
+    unsigned volatile starts_;  // starts finished
+    impl::ServiceSnapshot * current_;  // newest snapshot, the head of the retired_ chain
+    size_t count_;  // services in current_
+  };
+
+  struct SimpleEnvironment
+    : SnapshotEnvironment
     , StandardDisposable< SimpleEnvironment >
   {
-    typedef std::unordered_map< StringId, AutoDispose< Service > > ServiceMap;
+    typedef std::unordered_map< StringId, AutoDispose< Service >, StringIdHash, StringIdEqual > ServiceMap;
     typedef std::vector< StringId > ServiceVec;
+    typedef std::vector< std::pair< StringId, ThreadCycle * >> PendingVec;
 
     SimpleEnvironment( StringId const & );
     ~SimpleEnvironment( void );
@@ -45,17 +103,22 @@ namespace {
 
     ServiceMap services_;
     ServiceVec order_;
+    PendingVec pending_;  // being factoried or started, and by which thread
     StringId name_;
   };
 
+  // Services are started and stopped along the dependency graph discovered while factorying them: whatever
+  // a service gets from the environment during its construction is one of its dependencies. So that every
+  // such get reaches the environment, no snapshot is published while a factory is running.
   struct TwoStageEnvironment
-    : Environment
+    : SnapshotEnvironment
     , impl::Service
     , StandardDisposable< TwoStageEnvironment >
     , StandardUnknown< TwoStageEnvironment, boost::mpl::list< impl::Service > >
   {
-    typedef std::unordered_map< StringId, AutoDispose< tools::Service > > ServiceMap;
+    typedef std::unordered_map< StringId, AutoDispose< tools::Service >, StringIdHash, StringIdEqual > ServiceMap;
     typedef std::vector< StringId > ServiceVec;
+    typedef std::unordered_map< StringId, ServiceVec, StringIdHash, StringIdEqual > DependencyMap;
 
     TwoStageEnvironment( StringId const & );
     ~TwoStageEnvironment( void );
@@ -69,16 +132,94 @@ namespace {
     AutoDispose< Request > start( void ) throw();
     AutoDispose< Request > stop( void ) throw();
 
+    // local methods
+    void startDeferred( std::vector< size_t > const & );
+
     ServiceMap services_;
-    ServiceVec order_;
+    ServiceVec order_;  // factory order, which is also a dependency order
+    DependencyMap depends_;
+    ServiceVec creating_;  // services under construction, innermost last
+    std::vector< bool > started_;  // by order_
+    std::vector< size_t > unstarted_;  // indexes in order_ to start once the outermost get leaves
     StringId name_;
+    bool running_;
     bool allStopped_;
   };
 
+  // Starts (or stops) the services of a TwoStageEnvironment. Each service is launched as soon as
+  // everything it waits on has finished, so independent services overlap and startup takes about as long
+  // as the slowest chain of dependencies. Starting, a service waits on its dependencies; stopping, on its
+  // dependents. A failed start skips whatever depends on it, but unrelated services still start. That way
+  // which services run, and which error is reported (that of the earliest factoried service to fail), do
+  // not depend on how the starts interleave.
+  struct ServiceGraphRequest
+    : StandardRequest< ServiceGraphRequest >
+  {
+    struct Node
+      : Completable< Node >
+    {
+      Node( void );
+
+      void notifyDone( Error * );
+
+      ServiceGraphRequest * parent_;
+      tools::Service * service_;
+      std::vector< unsigned > waiters_;
+      unsigned volatile pending_;  // what this waits on, plus one held by launchAll
+      bool volatile skip_;
+      bool ran_;
+      AutoDispose< Request > request_;
+      AutoDispose< Error::Reference > error_;
+      void * profile_;  // startup profile frame, if recording
+    };
+
+    ServiceGraphRequest( TwoStageEnvironment &, bool );
+
+    // StandardRequest
+    RequestStep start( void );
+
+    // local methods
+    void launchAll( void );
+    void release( Node & );
+    void launch( Node & );
+    void done( Node & );
+    void finished( void );
+
+    TwoStageEnvironment & env_;
+    bool starting_;
+    size_t count_;
+    std::unique_ptr< Node[] > nodes_;
+    unsigned volatile remaining_;
+  };
+
   // static tools::notification::Category envCat( tools::StaticStringId( L"Environment" ), tools::StringIdNull() );
 };  // anonymous namespace
 
 static StandardThreadLocalHandle< ThreadCycle > cycleRoot_;
+static uint64 volatile snapshotSerial_ = 0U;
+
+///////////////////////
+// Non-member Functions
+///////////////////////
+
+static tools::Service *
+factoryProfiled( impl::FactoryEnvironment & factory, Environment & env, StringId const & svc )
+{
+    StartupProfileScope profile( "factory", svc );
+    return factory.factory( env );
+}
+
+// Start a service, waiting for it.
+static void
+startProfiled( tools::Service & service, StringId const & svc )
+{
+    StartupProfileScope profile( "start", svc );
+    AutoDispose< Request > srvStart( service.start() );
+    if( !!srvStart ) {
+        AutoDispose< Error::Reference > err( runRequestSynchronously( srvStart ));
+        TOOLS_ASSERT( !err );
+    }
+}
 
 ////////////
 // CycleTest
@@ -116,6 +257,150 @@ CycleTest::~CycleTest( void )
     TOOLS_ASSERT( old == this );  // if this fails something weird happened in the get stack
 }
 
+//////////////////////////////
+// SnapshotEnvironment::Writer
+//////////////////////////////
+
+SnapshotEnvironment::Writer::Writer( SnapshotEnvironment & env )
+    : env_( env )
+    , outermost_( false )
+{
+    if( atomicRead( &env_.owner_ ) != cycleRoot_.get() ) {
+        env_.lock();
+        outermost_ = true;
+    }
+}
+
+SnapshotEnvironment::Writer::~Writer( void )
+{
+    if( !outermost_ ) {
+        return;
+    }
+    env_.flush();
+    env_.unlock();
+}
+
+//////////////////////
+// SnapshotEnvironment
+//////////////////////
+
+SnapshotEnvironment::SnapshotEnvironment( void )
+    : monitor_( monitorStaticNew() )
+    , owner_( nullptr )
+    , startedCvar_( conditionVarNew() )
+    , startedLock_( startedCvar_->monitorNew() )
+    , starts_( 0U )
+    , current_( nullptr )
+    , count_( 0U )
+{
+}
+
+SnapshotEnvironment::~SnapshotEnvironment( void )
+{
+    TOOLS_ASSERT( !snapshot_ );
+    while( !!current_ ) {
+        impl::ServiceSnapshot * retired = current_->retired_;
+        delete current_;
+        current_ = retired;
+    }
+}
+
+Unknown *
+SnapshotEnvironment::find( StringId const & svc )
+{
+    impl::ServiceSnapshot const * snapshot = atomicRead( &snapshot_ );
+    if( !snapshot ) {
+        return nullptr;
+    }
+    impl::ServiceSnapshot::Slot const * slot = snapshot->find( svc );
+    return !!slot ? slot->service_ : nullptr;
+}
+
+void
+SnapshotEnvironment::add( StringId const & svc, Unknown * service )
+{
+    // Keep the table at most half full, so misses stop early.
+    if( !current_ || (( ( count_ + 1U ) * 2U ) > current_->slots_.size() )) {
+        size_t size = !!current_ ? ( current_->slots_.size() * 2U ) : 8U;
+        TOOLS_ASSERT( size <= 0x1000000U );  // slots must fit in a call cache ticket
+        std::unique_ptr< impl::ServiceSnapshot > next( new impl::ServiceSnapshot );
+        next->serial_ = atomicAdd( &snapshotSerial_, 1U ) + 1U;
+        next->mask_ = size - 1U;
+        next->slots_.resize( size );
+        if( !!current_ ) {
+            for( auto && entry : current_->slots_ ) {
+                if( !!entry.service_ ) {
+                    size_t i = entry.name_.hash() & next->mask_;
+                    while( !!next->slots_[ i ].service_ ) {
+                        i = ( i + 1U ) & next->mask_;
+                    }
+                    next->slots_[ i ].name_ = entry.name_;
+                    next->slots_[ i ].service_ = entry.service_;
+                }
+            }
+        }
+        // Readers may still be looking at the older snapshots, keep them until the environment goes.
+        next->retired_ = current_;
+        current_ = next.release();
+    }
+    size_t i = svc.hash() & current_->mask_;
+    while( !!current_->slots_[ i ].service_ ) {
+        i = ( i + 1U ) & current_->mask_;
+    }
+    // The snapshot may already be published, readers only look at the name once the service is there.
+    current_->slots_[ i ].name_ = svc;
+    atomicSet( &current_->slots_[ i ].service_, service );
+    ++count_;
+}
+
+void
+SnapshotEnvironment::flush( void )
+{
+    atomicSet( &snapshot_, current_ );
+}
+
+void
+SnapshotEnvironment::withdraw( void )
+{
+    atomicSet( &snapshot_, static_cast< impl::ServiceSnapshot * >( nullptr ));
+}
+
+void
+SnapshotEnvironment::lock( void )
+{
+    lock_ = monitor_->enter();
+    atomicSet( &owner_, cycleRoot_.get() );
+}
+
+void
+SnapshotEnvironment::unlock( void )
+{
+    atomicSet( &owner_, static_cast< ThreadCycle * >( nullptr ));
+    lock_.reset();
+}
+
+void
+SnapshotEnvironment::waitStarted( void )
+{
+    // Read under the monitor, so a start finishing after whatever the caller saw still bumps it.
+    unsigned seen = atomicRead( &starts_ );
+    Unlocked unlocked( *this );
+    AutoDispose<> l_( startedLock_->enter() );
+    while( atomicRead( &starts_ ) == seen ) {
+        startedCvar_->wait();
+    }
+}
+
+void
+SnapshotEnvironment::notifyStarted( void )
+{
+    {
+        AutoDispose<> l_( startedLock_->enter() );
+        atomicIncrement( &starts_ );
+    }
+    startedCvar_->signal( true );
+}
+
 ////////////////////
 // SimpleEnvironment
 ////////////////////
@@ -127,6 +412,7 @@ SimpleEnvironment::SimpleEnvironment( StringId const & name )
 
 SimpleEnvironment::~SimpleEnvironment( void )
 {
+  withdraw();
   for( auto i=order_.rbegin(); i!=order_.rend(); ++i ) {
     auto item=services_.find( *i );
     TOOLS_ASSERT( item != services_.end() );
@@ -150,37 +436,53 @@ SimpleEnvironment::name( void )
 Unknown *
 SimpleEnvironment::get( StringId const & svc )
 {
+    Unknown * ret = find( svc );
+    if( !!ret ) {
+        return ret;
+    }
+    Writer writer( *this );
     CycleTest noCycles( svc );
-    Unknown * ret = nullptr;
+    ThreadCycle * self = cycleRoot_.get();
+    for(;;) {
+        auto pending = std::find_if( pending_.begin(), pending_.end(), [&]( PendingVec::value_type const & entry ) {
+            return entry.first == svc;
+        });
+        if( ( pending == pending_.end() ) || ( pending->second == self )) {
+            // A service getting itself as it starts is handed what there is.
+            break;
+        }
+        // Another thread is factorying or starting it.
+        waitStarted();
+    }
     auto item=services_.find( svc );
     if( item != services_.end() ) {
-        ret = item->second.get();
-    } else {
-        impl::FactoryEnvironment * factory = registryFetch< impl::FactoryEnvironment >( svc );
-        if( !factory ) {
-            TOOLS_ASSERT( !"Unknown service" );
-            return nullptr;
-        }
-        //impl::FactoryEnvironment::Desc const & desc = factory->describe();
-        AutoDispose< Service > service( factory->factory( *this ));
-        TOOLS_ASSERT( !!service );
-
-        //AutoDispose<> l_( serviceLock->enter() );
-        //item = services.find( svc );
-        //if( item != services.end() ) {
-        //    TOOLS_ASSERT( !!item->second );
-        //    ret = item->second.get();
-        //} else {
-        // Since this is a single-stage environment, we start services as we create them
-        AutoDispose< Request > srvStart( service->start() );
-        if( !!srvStart ) {
-	        AutoDispose< Error::Reference > err( runRequestSynchronously( srvStart ));
-	        TOOLS_ASSERT( !err );
-        }
-        ret = service.get();
-        services_[ svc ] = std::move( service );
-        order_.push_back( svc );
-        //}
+        return item->second.get();
+    }
+    impl::FactoryEnvironment * factory = registryFetch< impl::FactoryEnvironment >( svc );
+    if( !factory ) {
+        TOOLS_ASSERT( !"Unknown service" );
+        return nullptr;
+    }
+    pending_.push_back( std::make_pair( svc, self ));
+    //impl::FactoryEnvironment::Desc const & desc = factory->describe();
+    AutoDispose< Service > service( factoryProfiled( *factory, *this, svc ));
+    TOOLS_ASSERT( !!service );
+    Service * created = service.get();
+    ret = created;
+    services_[ svc ] = std::move( service );
+    order_.push_back( svc );
+    {
+        // Since this is a single-stage environment, we start services as we create them, so even a factory
+        // getting this as a dependency is handed it started.
+        Unlocked unlocked( *this );
+        startProfiled( *created, svc );
+    }
+    pending_.erase( std::find( pending_.begin(), pending_.end(), std::make_pair( svc, self )));
+    add( svc, ret );
+    flush();
+    {
+        Unlocked unlocked( *this );
+        notifyStarted();
     }
     return ret;
 }
@@ -191,12 +493,16 @@ SimpleEnvironment::get( StringId const & svc )
 
 TwoStageEnvironment::TwoStageEnvironment( StringId const & name )
   : name_( name )
+  , running_( false )
   , allStopped_( false )
 {
+  add( ServiceName< impl::Service >(), static_cast< Unknown * >( this ));
+  flush();
 }
 
 TwoStageEnvironment::~TwoStageEnvironment()
 {
+  withdraw();
   TOOLS_ASSERT( allStopped_ );
   for( auto i=order_.rbegin(); i!=order_.rend(); ++i ) {
     auto item=services_.find( *i );
@@ -216,36 +522,69 @@ TwoStageEnvironment::name( void )
 Unknown *
 TwoStageEnvironment::get( StringId const & svc )
 {
-  CycleTest noCycles( svc );
+  Unknown * ret = find( svc );
+  if( !!ret ) {
+      return ret;
+  }
   if( ServiceName< impl::Service >() == svc ) {
       return static_cast< Unknown * >( this );
   }
-  Unknown * ret = nullptr;
-  auto item=services_.find( svc );
-  if( item != services_.end() ) {
-    ret = item->second.get();
-  } else {
-      impl::FactoryEnvironment * factory = registryFetch< impl::FactoryEnvironment >( svc );
-      if( !factory ) {
-          TOOLS_ASSERT( !"Unknown service" );
+  std::vector< size_t > starting;
+  {
+      Writer writer( *this );
+      CycleTest noCycles( svc );
+      auto item=services_.find( svc );
+      if( ( item == services_.end() ) && ( std::find( creating_.begin(), creating_.end(), svc ) != creating_.end() )) {
+          // svc is still being constructed further up the stack, so there is nothing to hand back. The
+          // factory asking would only go on to dereference nullptr.
+          // TODO: convert this to logging
+          fprintf( stderr, "Environment factory failed, service dependency cycle:\n" );
+          for( auto i = std::find( creating_.begin(), creating_.end(), svc ); i != creating_.end(); ++i ) {
+              fprintf( stderr, "\t%s\n", i->c_str() );
+          }
+          fprintf( stderr, "\t%s\n", svc.c_str() );
+          TOOLS_ASSERTR( !"Service dependency cycle" );
           return nullptr;
       }
-      //impl::FactoryEnvironment::Desc const & desc = factory->describe();
-      AutoDispose< tools::Service > service( factory->factory( *this ));
-      TOOLS_ASSERT( !!service );
-
-      //AutoDispose<> l_( serviceLock->enter() );
-      //item = services.find( svc );
-      //if( item != services.end() ) {
-      //    TOOLS_ASSERT( !!item->second );
-      //    return item->second.get();
-      //} else
-      // For this kind of environment, services will be started as a seperate pass.
-      ret = service.get();
-      services_[ svc ] = std::move( service );
-      order_.push_back( svc );
-      //}
+      if( !creating_.empty() ) {
+          ServiceVec & deps = depends_[ creating_.back() ];
+          if( std::find( deps.begin(), deps.end(), svc ) == deps.end() ) {
+              deps.push_back( svc );
+          }
+      }
+      if( item != services_.end() ) {
+          ret = item->second.get();
+      } else if( impl::FactoryEnvironment * factory = registryFetch< impl::FactoryEnvironment >( svc )) {
+          //impl::FactoryEnvironment::Desc const & desc = factory->describe();
+          if( creating_.empty() ) {
+              withdraw();
+          }
+          creating_.push_back( svc );
+          AutoDispose< tools::Service > service( factoryProfiled( *factory, *this, svc ));
+          creating_.pop_back();
+          TOOLS_ASSERT( !!service );
+          // For this kind of environment, services will be started as a seperate pass. Any factoried after
+          // that pass are started as they are created (their dependencies were created, and so started,
+          // first). A start may itself get services, so that waits until the monitor is released.
+          if( running_ ) {
+              unstarted_.push_back( order_.size() );
+          }
+          ret = service.get();
+          services_[ svc ] = std::move( service );
+          order_.push_back( svc );
+          started_.push_back( false );
+          if( creating_.empty() ) {
+              // Let others find the started services again. This one is added once it starts.
+              flush();
+          }
+      } else {
+          TOOLS_ASSERT( !"Unknown service" );
+      }
+      if( writer.outermost() ) {
+          starting.swap( unstarted_ );
+      }
   }
+  startDeferred( starting );
   return ret;
 }
 
@@ -258,17 +597,204 @@ TwoStageEnvironment::bindEnv(
 AutoDispose< Request >
 TwoStageEnvironment::start( void ) throw()
 {
-  // TODO: implement this
-  TOOLS_ASSERT( !"Not implemented" );
-  return static_cast< Request * >( nullptr );
+  return new ServiceGraphRequest( *this, true );
 }
 
 AutoDispose< Request >
 TwoStageEnvironment::stop( void ) throw()
 {
-  // TODO: implement this
-  TOOLS_ASSERT( !"Not implemented" );
-  return static_cast< Request * >( nullptr );
+  return new ServiceGraphRequest( *this, false );
+}
+
+// Start services (by index in order_) in the given order, without holding the monitor while they start.
+void
+TwoStageEnvironment::startDeferred( std::vector< size_t > const & indexes )
+{
+    for( size_t i : indexes ) {
+        StringId svc;
+        tools::Service * service;
+        {
+            Writer writer( *this );
+            svc = order_[ i ];
+            service = services_.find( svc )->second.get();
+        }
+        startProfiled( *service, svc );
+        Writer writer( *this );
+        started_[ i ] = true;
+        add( svc, service );
+    }
+}
+
+////////////////////////////
+// ServiceGraphRequest::Node
+////////////////////////////
+
+ServiceGraphRequest::Node::Node( void )
+    : parent_( nullptr )
+    , service_( nullptr )
+    , pending_( 1U )
+    , skip_( false )
+    , ran_( false )
+    , profile_( nullptr )
+{
+}
+
+void
+ServiceGraphRequest::Node::notifyDone( Error * err )
+{
+    if( !!err ) {
+        error_ = err->ref();
+    } else {
+        ran_ = true;
+    }
+    if( !!profile_ ) {
+        impl::startupProfileLeave( profile_ );
+    }
+    parent_->done( *this );
+}
+
+//////////////////////
+// ServiceGraphRequest
+//////////////////////
+
+ServiceGraphRequest::ServiceGraphRequest( TwoStageEnvironment & env, bool starting )
+    : env_( env )
+    , starting_( starting )
+    , count_( 0U )
+    , remaining_( 0U )
+{
+    // Other threads may be factorying while the graph is taken, anything they add later is left to
+    // finished().
+    TwoStageEnvironment::Writer writer( env_ );
+    count_ = env_.order_.size();
+    nodes_.reset( new Node[ count_ ] );
+    std::unordered_map< StringId, unsigned, StringIdHash, StringIdEqual > indexOf;
+    for( unsigned i = 0U; i != count_; ++i ) {
+        indexOf[ env_.order_[ i ]] = i;
+        nodes_[ i ].parent_ = this;
+        auto service = env_.services_.find( env_.order_[ i ]);
+        TOOLS_ASSERT( service != env_.services_.end() );
+        nodes_[ i ].service_ = service->second.get();
+    }
+    for( unsigned i = 0U; i != count_; ++i ) {
+        auto deps = env_.depends_.find( env_.order_[ i ]);
+        if( deps == env_.depends_.end() ) {
+            continue;
+        }
+        for( auto && dep : deps->second ) {
+            auto j = indexOf.find( dep );
+            if( j == indexOf.end() ) {
+                continue;
+            }
+            Node & before = starting_ ? nodes_[ j->second ] : nodes_[ i ];
+            Node & after = starting_ ? nodes_[ i ] : nodes_[ j->second ];
+            before.waiters_.push_back( static_cast< unsigned >( &after - nodes_.get() ));
+            ++after.pending_;
+        }
+    }
+}
+
+RequestStep
+ServiceGraphRequest::start( void )
+{
+    remaining_ = static_cast< unsigned >( count_ ) + 1U;
+    return suspend< &ServiceGraphRequest::launchAll >();
+}
+
+void
+ServiceGraphRequest::launchAll( void )
+{
+    for( size_t i = 0U; i != count_; ++i ) {
+        release( nodes_[ i ]);
+    }
+    finished();
+}
+
+void
+ServiceGraphRequest::release( Node & node )
+{
+    if( !atomicDeref( &node.pending_ )) {
+        launch( node );
+    }
+}
+
+void
+ServiceGraphRequest::launch( Node & node )
+{
+    size_t index = &node - nodes_.get();
+    if( node.skip_ || ( !starting_ && !env_.started_[ index ] )) {
+        done( node );
+        return;
+    }
+    if( starting_ && impl::startupProfileRecording() ) {
+        node.profile_ = impl::startupProfileEnter( "start", env_.order_[ index ], StringIdNull() );
+    }
+    void * profile = node.profile_;
+    node.request_ = starting_ ? node.service_->start() : node.service_->stop();
+    if( !node.request_ ) {
+        node.notifyDone( nullptr );
+        return;
+    }
+    node.request_->start( node.toCompletion< &Node::notifyDone >() );
+    // The start goes on asynchronously, but this thread is done with it.
+    if( !!profile ) {
+        impl::startupProfileDetach( profile );
+    }
+}
+
+void
+ServiceGraphRequest::done( Node & node )
+{
+    for( auto && waiter : node.waiters_ ) {
+        if( starting_ && !node.ran_ ) {
+            nodes_[ waiter ].skip_ = true;
+        }
+        release( nodes_[ waiter ]);
+    }
+    finished();
+}
+
+void
+ServiceGraphRequest::finished( void )
+{
+    if( !!atomicDeref( &remaining_ )) {
+        return;
+    }
+    // Report the error of the earliest factoried service, however the starts happened to interleave.
+    Error * first = nullptr;
+    std::vector< size_t > late;
+    {
+        TwoStageEnvironment::Writer writer( env_ );
+        for( size_t i = 0U; i != count_; ++i ) {
+            Node & node = nodes_[ i ];
+            if( !first && !!node.error_ ) {
+                first = node.error_.get();
+            }
+            bool started = starting_ && node.ran_;
+            if( started && !env_.started_[ i ] ) {
+                env_.add( env_.order_[ i ], node.service_ );
+            }
+            env_.started_[ i ] = started;
+        }
+        if( starting_ ) {
+            env_.running_ = !first;
+            // Services factoried while the graph was starting missed it. From here on get() starts them as
+            // they are factoried, but these have to be started here.
+            if( env_.running_ ) {
+                for( size_t i = count_; i != env_.order_.size(); ++i ) {
+                    if( !env_.started_[ i ] ) {
+                        late.push_back( i );
+                    }
+                }
+            }
+        } else {
+            env_.running_ = false;
+            env_.allStopped_ = true;
+        }
+    }
+    // Factory order is a dependency order.
+    env_.startDeferred( late );
+    resumeFinish( first );
 }
 
 namespace tools {
@@ -299,6 +825,7 @@ namespace tools {
 
 #include <tools/UnitTest.h>
 #if TOOLS_UNIT_TEST
+#include <tools/Timing.h>
 
 namespace {
     struct EnvTestService {
@@ -325,6 +852,227 @@ namespace {
     };
 
     static RegisterEnvironment< EnvTestService, EnvTestImpl > regEnvTest;
+
+    // Services for the dependency graph tests. What each depends on, and how its start behaves, is set
+    // by the test before it factories any of them.
+    struct EnvGraphService {
+        virtual unsigned began(void) = 0;  // ticks of envGraphClock_, 0 if never
+        virtual unsigned started(void) = 0;
+        virtual unsigned stopped(void) = 0;
+    };
+
+    template< unsigned idT >
+    struct EnvGraph : SpecifyService< EnvGraphService > {};
+
+    struct EnvGraphConfig
+    {
+        unsigned deps_[ 4 ];  // ids + 1, 0 terminated
+        uint64 delay_;  // on the timer
+        Error * fail_;
+        unsigned late_;  // id + 1 of a service to factory from the start, 0 if none
+    };
+
+    enum : unsigned {
+        envGraphServices = 5U,
+    };
+
+    struct EnvGraphError
+        : StandardStaticReferenced< EnvGraphError, Error >
+    {
+    };
+
+    static EnvGraphConfig envGraphConfig_[ envGraphServices ];
+    static Timing * envGraphTiming_ = nullptr;
+    static unsigned volatile envGraphClock_ = 0U;
+    static EnvGraphError envGraphErrors_[ 2 ];
+
+    unsigned envGraphTick(void)
+    {
+        return atomicAdd( &envGraphClock_, 1U ) + 1U;
+    }
+
+    StringId const & envGraphName( unsigned id )
+    {
+        static StringId const names[ envGraphServices ] = {
+            nameOf< EnvGraph< 0 >>(), nameOf< EnvGraph< 1 >>(), nameOf< EnvGraph< 2 >>(), nameOf< EnvGraph< 3 >>(), nameOf< EnvGraph< 4 >>(),
+        };
+        return names[ id ];
+    }
+
+    template< unsigned idT >
+    struct EnvGraphImpl
+        : EnvGraphService
+        , tools::detail::StandardNoBindService< EnvGraphImpl< idT >, boost::mpl::list< EnvGraphService >::type >
+    {
+        struct StartReq
+            : StandardRequest< StartReq >
+        {
+            StartReq( EnvGraphImpl & parent ) : parent_( parent ) {}
+
+            // StandardRequest
+            RequestStep start( void ) {
+                parent_.began_ = envGraphTick();
+                if( unsigned late = envGraphConfig_[ idT ].late_ ) {
+                    parent_.env_.get( envGraphName( late - 1U ));
+                }
+                if( !envGraphConfig_[ idT ].delay_ ) {
+                    return delayed();
+                }
+                timer_ = envGraphTiming_->timer( envGraphConfig_[ idT ].delay_ );
+                return this->template wait< &StartReq::delayed >( *timer_ );
+            }
+
+            // local methods
+            RequestStep delayed( void ) {
+                if( Error * fail = envGraphConfig_[ idT ].fail_ ) {
+                    return this->finish( *fail );
+                }
+                parent_.started_ = envGraphTick();
+                return this->finish();
+            }
+
+            EnvGraphImpl & parent_;
+            AutoDispose< Request > timer_;
+        };
+
+        EnvGraphImpl( Environment & env )
+            : env_( env )
+            , began_( 0U )
+            , started_( 0U )
+            , stopped_( 0U )
+        {
+            for( unsigned const * dep = envGraphConfig_[ idT ].deps_; !!*dep; ++dep ) {
+                env.get( envGraphName( *dep - 1U ));
+            }
+        }
+
+        // Service
+        AutoDispose< Request > serviceStart( void ) {
+            return new StartReq( *this );
+        }
+        AutoDispose< Request > serviceStop( void ) {
+            stopped_ = envGraphTick();
+            return nullptr;
+        }
+
+        // EnvGraphService
+        unsigned began( void ) { return began_; }
+        unsigned started( void ) { return started_; }
+        unsigned stopped( void ) { return stopped_; }
+
+        Environment & env_;
+        unsigned began_;
+        unsigned started_;
+        unsigned stopped_;
+    };
+
+    static RegisterEnvironment< EnvGraph< 0 >, EnvGraphImpl< 0 >> regEnvGraph0;
+    static RegisterEnvironment< EnvGraph< 1 >, EnvGraphImpl< 1 >> regEnvGraph1;
+    static RegisterEnvironment< EnvGraph< 2 >, EnvGraphImpl< 2 >> regEnvGraph2;
+    static RegisterEnvironment< EnvGraph< 3 >, EnvGraphImpl< 3 >> regEnvGraph3;
+    static RegisterEnvironment< EnvGraph< 4 >, EnvGraphImpl< 4 >> regEnvGraph4;
+
+    // Factory every graph service in id order, then start them.
+    AutoDispose< Error::Reference > envGraphStart( Environment & env, EnvGraphService ** services )
+    {
+        for( unsigned i = 0U; i != envGraphServices; ++i ) {
+            Unknown * svc = env.get( envGraphName( i ));
+            services[ i ] = !!svc ? svc->getInterface< EnvGraphService >() : nullptr;
+        }
+        AutoDispose< Request > startReq( env.get< impl::Service >()->start() );
+        return runRequestSynchronously( startReq );
+    }
+
+    void envGraphStop( Environment & env )
+    {
+        AutoDispose< Request > stopReq( env.get< impl::Service >()->stop() );
+        AutoDispose< Error::Reference > err( runRequestSynchronously( stopReq ));
+        TOOLS_ASSERTR( !err );
+    }
+
+    // Many threads resolving services from one environment at once.
+    struct EnvSnapshotStress
+        : Notifiable< EnvSnapshotStress >
+    {
+        enum : unsigned {
+            lookups = 1U << 20,
+        };
+
+        EnvSnapshotStress( Environment & env, Timing & timing, unsigned threads )
+            : env_( env )
+            , timing_( timing )
+            , threads_( threads )
+            , started_( false )
+            , ready_( 0U )
+            , mismatches_( 0U )
+            , typed_( 0U )
+            , named_( 0U )
+            , locked_( 0U )
+            , lock_( monitorStaticNew() )
+        {
+            std::fill( seen_, seen_ + envGraphServices, static_cast< Unknown * >( nullptr ));
+        }
+
+        // Line everyone up, so they start together.
+        void rendezvous( void ) {
+            atomicIncrement( &ready_ );
+            while( atomicRead( &ready_ ) < threads_ ) {
+            }
+        }
+        // Every thread must get the same instance of each service, however the factorying interleaves.
+        void race( void ) {
+            rendezvous();
+            for( unsigned i = 0U; i != envGraphServices; ++i ) {
+                Unknown * svc = env_.get( envGraphName( i ));
+                Unknown * prev = atomicCas( &seen_[ i ], static_cast< Unknown * >( nullptr ), svc );
+                if( !svc || ( !!prev && ( prev != svc ))) {
+                    atomicIncrement( &mismatches_ );
+                } else if( started_ && !svc->getInterface< EnvGraphService >()->started() ) {
+                    atomicIncrement( &mismatches_ );
+                }
+            }
+        }
+        void benchmark( void ) {
+            EnvTestService * expected = env_.get< EnvTestService >();
+            Unknown * expectedUnknown = env_.get( nameOf< EnvTestService >() );
+            unsigned misses = 0U;
+            rendezvous();
+            uint64 start = timing_.mark();
+            for( unsigned i = 0U; i != lookups; ++i ) {
+                misses += ( env_.get< EnvTestService >() != expected ) ? 1U : 0U;
+            }
+            uint64 typed = timing_.mark( start );
+            start = timing_.mark();
+            for( unsigned i = 0U; i != lookups; ++i ) {
+                misses += ( env_.get( nameOf< EnvTestService >() ) != expectedUnknown ) ? 1U : 0U;
+            }
+            uint64 named = timing_.mark( start );
+            // What a get used to be: a map lookup under the environment's monitor.
+            start = timing_.mark();
+            for( unsigned i = 0U; i != lookups; ++i ) {
+                AutoDispose<> l_( lock_->enter() );
+                misses += ( services_.find( nameOf< EnvTestService >() )->second != expectedUnknown ) ? 1U : 0U;
+            }
+            uint64 locked = timing_.mark( start );
+            atomicAdd( &typed_, typed );
+            atomicAdd( &named_, named );
+            atomicAdd( &locked_, locked );
+            atomicAdd( &mismatches_, misses );
+        }
+
+        Environment & env_;
+        Timing & timing_;
+        unsigned threads_;
+        bool started_;  // whether every get must be handed a started service
+        unsigned volatile ready_;
+        unsigned volatile mismatches_;
+        uint64 volatile typed_;
+        uint64 volatile named_;
+        uint64 volatile locked_;
+        AutoDispose< Monitor > lock_;
+        std::unordered_map< StringId, Unknown *, StringIdHash, StringIdEqual > services_;
+        Unknown * volatile seen_[ envGraphServices ];
+    };
 }; // anonymous namespace
 
 //////////////
@@ -381,4 +1129,206 @@ TOOLS_TEST_CASE("Environment.factory", [](Test & test)
     TOOLS_ASSERTR(svc->haveStarted());
     TOOLS_ASSERTR(!svc->haveStopped());
 });
+
+TOOLS_TEST_CASE("Environment.graph", [](Test & test)
+{
+    static uint64 const delay = 20_ms;
+    auto timing = test.environment().unmockNow<Timing>();
+    envGraphTiming_ = timing;
+    // 0 needs 1 and 2, which both need 3. 4 stands alone. The critical path is 3, 1, 0.
+    EnvGraphConfig config[ envGraphServices ] = {
+        { { 2U, 3U, 0U }, delay, nullptr },
+        { { 4U, 0U }, delay, nullptr },
+        { { 4U, 0U }, delay, nullptr },
+        { { 0U }, delay, nullptr },
+        { { 0U }, delay, nullptr },
+    };
+    std::copy(config, config + envGraphServices, envGraphConfig_);
+    AutoDispose<> lifetime;
+    Environment * env = NewTwoStageEnvironment(lifetime, "EnvGraphTest");
+    EnvGraphService * services[ envGraphServices ];
+    uint64 start = timing->mark();
+    AutoDispose<Error::Reference> err(envGraphStart(*env, services));
+    uint64 elapsed = timing->mark(start);
+    TOOLS_ASSERTR(!err);
+    for (auto && svc : services) {
+        TOOLS_ASSERTR(!!svc->started());
+    }
+    TOOLS_ASSERTR(services[1]->began() > services[3]->started());
+    TOOLS_ASSERTR(services[2]->began() > services[3]->started());
+    TOOLS_ASSERTR(services[0]->began() > services[1]->started());
+    TOOLS_ASSERTR(services[0]->began() > services[2]->started());
+    // Started one after another this would take 5 delays, the critical path is 3.
+    if (testTimingsReported()) {
+        fprintf(stderr, "Environment graph start: %.1f ms, critical path %.1f ms, serial %.1f ms\n",
+            static_cast<double>(elapsed) / TOOLS_NANOSECONDS_PER_MILLISECOND, static_cast<double>(3U * delay) / TOOLS_NANOSECONDS_PER_MILLISECOND,
+            static_cast<double>(envGraphServices * delay) / TOOLS_NANOSECONDS_PER_MILLISECOND);
+    }
+    TOOLS_ASSERTR(elapsed < (envGraphServices * delay));
+    envGraphStop(*env);
+    TOOLS_ASSERTR(services[1]->stopped() < services[3]->stopped());
+    TOOLS_ASSERTR(services[2]->stopped() < services[3]->stopped());
+    TOOLS_ASSERTR(services[0]->stopped() < services[1]->stopped());
+    TOOLS_ASSERTR(services[0]->stopped() < services[2]->stopped());
+    TOOLS_ASSERTR(!!services[4]->stopped());
+});
+
+TOOLS_TEST_CASE("Environment.graph.error", [](Test & test)
+{
+    auto timing = test.environment().unmockNow<Timing>();
+    envGraphTiming_ = timing;
+    // 0 fails late and 1 fails at once. 0 was factoried first, so its error is the one reported. 2 needs 1
+    // and never starts, while 3 and 4 do.
+    EnvGraphConfig config[ envGraphServices ] = {
+        { { 0U }, 20_ms, &envGraphErrors_[ 0 ] },
+        { { 0U }, 0U, &envGraphErrors_[ 1 ] },
+        { { 2U, 0U }, 0U, nullptr },
+        { { 0U }, 0U, nullptr },
+        { { 4U, 0U }, 0U, nullptr },
+    };
+    std::copy(config, config + envGraphServices, envGraphConfig_);
+    AutoDispose<> lifetime;
+    Environment * env = NewTwoStageEnvironment(lifetime, "EnvGraphTest");
+    EnvGraphService * services[ envGraphServices ];
+    AutoDispose<Error::Reference> err(envGraphStart(*env, services));
+    TOOLS_ASSERTR(!!err);
+    TOOLS_ASSERTR(static_cast<Error *>(err.get()) == static_cast<Error *>(&envGraphErrors_[ 0 ]));
+    err.reset();
+    TOOLS_ASSERTR(!services[0]->started());
+    TOOLS_ASSERTR(!services[1]->started());
+    TOOLS_ASSERTR(!services[2]->began());
+    TOOLS_ASSERTR(!!services[3]->started());
+    TOOLS_ASSERTR(!!services[4]->started());
+    // Only what started gets stopped.
+    envGraphStop(*env);
+    TOOLS_ASSERTR(!services[0]->stopped());
+    TOOLS_ASSERTR(!services[1]->stopped());
+    TOOLS_ASSERTR(!services[2]->stopped());
+    TOOLS_ASSERTR(services[4]->stopped() < services[3]->stopped());
+});
+
+TOOLS_TEST_CASE("Environment.graph.late", [](Test & test)
+{
+    auto timing = test.environment().unmockNow<Timing>();
+    envGraphTiming_ = timing;
+    // 1 factories 3 (which needs 4) while the graph is starting, so neither is part of it.
+    EnvGraphConfig config[ envGraphServices ] = {
+        { { 0U }, 0U, nullptr, 0U },
+        { { 0U }, 20_ms, nullptr, 4U },
+        { { 0U }, 0U, nullptr, 0U },
+        { { 5U, 0U }, 0U, nullptr, 0U },
+        { { 0U }, 0U, nullptr, 0U },
+    };
+    std::copy(config, config + envGraphServices, envGraphConfig_);
+    AutoDispose<> lifetime;
+    Environment * env = NewTwoStageEnvironment(lifetime, "EnvGraphTest");
+    for (unsigned i = 0U; i != 3U; ++i) {
+        TOOLS_ASSERTR(!!env->get(envGraphName(i)));
+    }
+    AutoDispose<Request> startReq(env->get<impl::Service>()->start());
+    AutoDispose<Error::Reference> err(runRequestSynchronously(startReq));
+    TOOLS_ASSERTR(!err);
+    // Both were still started, dependency first, before the start finished.
+    EnvGraphService * late = env->get(envGraphName(3U))->getInterface<EnvGraphService>();
+    EnvGraphService * dep = env->get(envGraphName(4U))->getInterface<EnvGraphService>();
+    TOOLS_ASSERTR(!!dep->started());
+    TOOLS_ASSERTR(late->began() > dep->started());
+    envGraphStop(*env);
+    TOOLS_ASSERTR(!!late->stopped());
+    TOOLS_ASSERTR(late->stopped() < dep->stopped());
+});
+
+TOOLS_TEST_CASE("Environment.simple.late", [](Test & test)
+{
+    auto timing = test.environment().unmockNow<Timing>();
+    envGraphTiming_ = timing;
+    // Starting 1 factories 3 (which needs 4), so services get factoried from within a start.
+    EnvGraphConfig config[ envGraphServices ] = {
+        { { 0U }, 0U, nullptr, 0U },
+        { { 0U }, 0U, nullptr, 4U },
+        { { 0U }, 0U, nullptr, 0U },
+        { { 5U, 0U }, 0U, nullptr, 0U },
+        { { 0U }, 0U, nullptr, 0U },
+    };
+    std::copy(config, config + envGraphServices, envGraphConfig_);
+    AutoDispose<> lifetime;
+    Environment * env = NewSimpleEnvironment(lifetime, "EnvGraphTest");
+    EnvGraphService * first = env->get(envGraphName(1U))->getInterface<EnvGraphService>();
+    TOOLS_ASSERTR(!!first->started());
+    EnvGraphService * late = env->get(envGraphName(3U))->getInterface<EnvGraphService>();
+    EnvGraphService * dep = env->get(envGraphName(4U))->getInterface<EnvGraphService>();
+    TOOLS_ASSERTR(late->began() > dep->started());
+    TOOLS_ASSERTR(first->started() > late->started());
+});
+
+TOOLS_TEST_CASE("Environment.snapshot.race", testParamValues({ 0U, 1U }), [](Test & test, unsigned twoStage)
+{
+    static unsigned const threads = 32U;
+    auto threading = test.environment().unmockNow<Threading>();
+    auto timing = test.environment().unmockNow<Timing>();
+    // Nested factories: 0 needs 1 and 2, which both need 3.
+    EnvGraphConfig config[ envGraphServices ] = {
+        { { 2U, 3U, 0U }, 0U, nullptr },
+        { { 4U, 0U }, 0U, nullptr },
+        { { 4U, 0U }, 0U, nullptr },
+        { { 0U }, 0U, nullptr },
+        { { 0U }, 0U, nullptr },
+    };
+    std::copy(config, config + envGraphServices, envGraphConfig_);
+    AutoDispose<> lifetime;
+    Environment * env = !!twoStage ? NewTwoStageEnvironment(lifetime, "EnvSnapshotTest") : NewSimpleEnvironment(lifetime, "EnvSnapshotTest");
+    EnvSnapshotStress state(*env, *timing, threads);
+    state.started_ = !twoStage;
+    std::vector< AutoDispose< Thread >> workers;
+    for (unsigned i = 0U; i != threads; ++i) {
+        workers.push_back(threading->fork("envSnapshotRace", state.toThunk< &EnvSnapshotStress::race >()));
+    }
+    for (auto && worker : workers) {
+        worker->waitSync();
+    }
+    TOOLS_ASSERTR(state.mismatches_ == 0U);
+    for (unsigned i = 0U; i != envGraphServices; ++i) {
+        TOOLS_ASSERTR(env->get(envGraphName(i)) == state.seen_[ i ]);
+    }
+    if (!!twoStage) {
+        // Dependencies were recorded however the gets interleaved.
+        EnvGraphService * services[ envGraphServices ];
+        AutoDispose<Error::Reference> err(envGraphStart(*env, services));
+        TOOLS_ASSERTR(!err);
+        TOOLS_ASSERTR(services[1]->began() > services[3]->started());
+        TOOLS_ASSERTR(services[0]->began() > services[2]->started());
+        envGraphStop(*env);
+    }
+});
+
+TOOLS_TEST_CASE("Environment.snapshot.benchmark", testParamValues({ 1U, 32U, 64U }), [](Test & test, unsigned threads)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    auto timing = test.environment().unmockNow<Timing>();
+    AutoDispose<> lifetime;
+    Environment * env = NewSimpleEnvironment(lifetime, "EnvSnapshotTest");
+    TOOLS_ASSERTR(!!env->get<EnvTestService>());
+    EnvSnapshotStress state(*env, *timing, threads);
+    state.services_[ nameOf<EnvTestService>() ] = env->get(nameOf<EnvTestService>());
+    std::vector< AutoDispose< Thread >> workers;
+    for (unsigned i = 0U; i != threads; ++i) {
+        workers.push_back(threading->fork("envSnapshotBenchmark", state.toThunk< &EnvSnapshotStress::benchmark >()));
+    }
+    for (auto && worker : workers) {
+        worker->waitSync();
+    }
+    TOOLS_ASSERTR(state.mismatches_ == 0U);
+    if (testTimingsReported()) {
+        double count = static_cast<double>(threads) * EnvSnapshotStress::lookups;
+        fprintf(stderr, "Environment get over %u threads: typed %.1f ns, by name %.1f ns, locked map %.1f ns\n", threads,
+            static_cast<double>(state.typed_) / count, static_cast<double>(state.named_) / count,
+            static_cast<double>(state.locked_) / count);
+    }
+    // A typed get is a get by name and an interface lookup, and the snapshot takes no lock for either.
+    TOOLS_ASSERTR(state.typed_ < (2U * state.named_));
+    if (threads >= 2U) {
+        // Every thread takes the same monitor on the locked path.
+        TOOLS_ASSERTR(state.named_ < state.locked_);
+    }
+});
 #endif /* TOOLS_UNIT_TEST */
@@ -3,6 +3,7 @@
 #include <tools/Algorithms.h>
 #include <tools/Concurrency.h>
 #include <tools/Interface.h>
+#include <tools/InterfaceTools.h>
 #include <tools/String.h>
 #include <tools/Threading.h>
 #include <tools/Tools.h>
@@ -32,7 +33,7 @@ namespace tools {
     namespace impl {
         AutoDispose< Monitor > monitorPlatformNew( void );
         bool memoryTrack( void );
-        void stringIdGetMemoryTracking( uint64 &, uint64 &, uint64 & );
+        void stringIdGetMemoryTracking( uint64 &, uint64 &, uint64 &, uint64 & );
         unsigned platformStackCount( void );
         size_t platformStackBytes( void );
         void logUntrackedMemory( void );
@@ -67,11 +68,11 @@ namespace {
 
         // allocation
         void * operator new( size_t ) {
-            resourceTraceImplsAllocated += 1;
+            allocated() += 1;
             return impl::affinityInstance< PlatformUntracked >().alloc( sizeof( ResourceTraceImpl ));
         }
         void operator delete( void * site ) {
-            resourceTraceImplsAllocated -= 1;
+            allocated() -= 1;
             impl::affinityInstance< PlatformUntracked >().free( site );
         }
 
@@ -82,7 +83,12 @@ namespace {
         impl::ResourceTrace * target_; // "name -> target" in logging
         size_t volatile currAllocated_;
         StringId mutable name_;  // cached
-        static ScalableCounter resourceTraceImplsAllocated;
+        // Traces are created during static initialization, and freed during static destruction. The counter
+        // therefore is constructed on first use and never destroyed.
+        static ScalableCounter & allocated( void ) {
+            static ScalableCounter * counter = new( impl::safeMalloc( sizeof( ScalableCounter ))) ScalableCounter;
+            return *counter;
+        }
     private:
         // Not impossible to implement, just really annoying
         void * operator new[]( size_t );
@@ -93,7 +99,6 @@ namespace {
 static size_t const resourceTraceTableSize = 65536U;
 static ResourceTraceImpl * volatile resourceTraces_[ resourceTraceTableSize ];
 static size_t const resourceTraceDumpMinSize = 65536U;
-ScalableCounter ResourceTraceImpl::resourceTraceImplsAllocated;
 
 struct SymbolCache {
     SymbolCache(
@@ -530,6 +535,7 @@ impl::resourceTraceDump(
     }
     size_t total = 0;
     size_t elided = 0;
+    size_t saved = 0;  // reported, but not memory in use
     for( size_t i=0; i!=resourceTraceTableSize; ++i ) {
         for( ResourceTraceImpl * j=resourceTraces_[ i ]; !!j; j=j->next_ ) {
             size_t count = j->currAllocated_ * j->interval_;
@@ -545,7 +551,7 @@ impl::resourceTraceDump(
     }
     // Tracking of the traces is handled elsewhere. As such they don't count towards assertNoAlloc.
     if( !assertNoAlloc ) {
-        size_t count = static_cast< uint64 >( ResourceTraceImpl::resourceTraceImplsAllocated );
+        size_t count = static_cast< uint64 >( ResourceTraceImpl::allocated() );
         size_t size = sizeof( ResourceTraceImpl );
         size_t bytes = size * count;
         static StringId trackingName = StaticStringId( "ResourceTraceImpls used by internal memory tracking" );
@@ -556,11 +562,16 @@ impl::resourceTraceDump(
         uint64 totalIds;
         uint64 totalStaticIds;
         uint64 totalIdBytes;
-        impl::stringIdGetMemoryTracking( totalIds, totalStaticIds, totalIdBytes );
+        uint64 totalIdBytesSaved;
+        impl::stringIdGetMemoryTracking( totalIds, totalStaticIds, totalIdBytes, totalIdBytesSaved );
         static StringId stringIdTrackingName = StaticStringId( "StringIds" );
         static StringId staticStringIdTrackingName = StaticStringId( "Static StringIds" );
-        sum.push_back( ResourceTraceSum( totalIdBytes, totalIdBytes / totalIds, totalIds, stringIdTrackingName ));
+        static StringId stringIdSavedName = StaticStringId( "StringId bytes saved by the string arena (not in use)" );
+        sum.push_back( ResourceTraceSum( totalIdBytes, ( totalIds == 0 ) ? 0 : ( totalIdBytes / totalIds ), totalIds, stringIdTrackingName ));
         sum.push_back( ResourceTraceSum( totalStaticIds, 1, totalStaticIds, staticStringIdTrackingName ));
+        // Per StringId, like the row above.
+        saved = static_cast< size_t >( totalIdBytesSaved );
+        sum.push_back( ResourceTraceSum( saved, ( totalIds == 0 ) ? 0 : ( saved / totalIds ), totalIds, stringIdSavedName ));
     }
     // Tracking of flight-data-recorders. When assertNoAlloc, exactly 1 is allowed to be allocated (for
     // the main thread).
@@ -592,6 +603,7 @@ impl::resourceTraceDump(
         return left + right.total_;
     });
     total += elided;
+    total -= saved;
     // This represents an ideal view of tracked memory. That means we don't have a window into fragmentation
     // (internal or external), opportunistic buffering within types, etc.
     // TODO: log total, platformVsize, platformRsize, platformPoolMemory
@@ -626,12 +638,52 @@ NullDisposable::dispose( void )
     // Nothing to do, this is static
 }
 
+///////////////////////
+// impl::InterfaceTable
+///////////////////////
+
+impl::InterfaceTable::InterfaceTable( InterfaceEntry const * entries, size_t count )
+    : entries_( entries, entries + count )
+{
+    // Order by hash, keeping the listing order within a hash, so that each run's first entry is the one the
+    // table holds.
+    std::vector< std::pair< uint32, InterfaceEntry const * >> byHash;
+    for( auto && entry : entries_ ) {
+        byHash.push_back( std::make_pair( static_cast< uint32 >( entry.name_->hash() ), &entry ));
+    }
+    std::stable_sort( byHash.begin(), byHash.end(), []( std::pair< uint32, InterfaceEntry const * > const & l, std::pair< uint32, InterfaceEntry const * > const & r )->bool {
+        return l.first < r.first;
+    });
+    std::vector< uint32 > hashes;
+    std::vector< InterfaceEntry const * > firsts;
+    for( size_t i = 0U; i != byHash.size(); ++i ) {
+        if( !!i && ( byHash[ i ].first == byHash[ i - 1U ].first )) {
+            // Another name with this hash, unless it is listed again.
+            if( *byHash[ i ].second->name_ != *firsts.back()->name_ ) {
+                collided_.push_back( byHash[ i ].second );
+            }
+            continue;
+        }
+        hashes.push_back( byHash[ i ].first );
+        firsts.push_back( byHash[ i ].second );
+    }
+    std::vector< uint32 > slotOf;
+    tools::impl::perfectHashBuild( hashes.data(), hashes.size(), buckets_, slots_, displacements_, slotOf );
+    table_.assign( slots_, nullptr );
+    for( size_t i = 0U; i != firsts.size(); ++i ) {
+        table_[ slotOf[ i ]] = firsts[ i ];
+    }
+}
+
 ////////
 // Tests
 ////////
 
 #include <tools/UnitTest.h>
 #if TOOLS_UNIT_TEST
+#include <tools/Timing.h>
+
+#include <boost/mpl/push_front.hpp>
 
 namespace {
     struct Dummy
@@ -691,6 +743,139 @@ namespace {
         AutoDispose<Test1> local(std::move(r));
         return local->func();
     }
+
+    struct ItfA { virtual int a(void) const = 0; };
+    struct ItfB { virtual int b(void) const = 0; };
+    struct ItfC { virtual int c(void) const = 0; };
+    struct ItfDynamic {};
+
+    // ItfA is listed twice, the first listing wins.
+    struct MultiUnknown
+        : StandardUnknown<MultiUnknown, boost::mpl::list<ItfA, ItfB, ItfA, ItfC>>
+        , ItfA
+        , ItfB
+        , ItfC
+        , ItfDynamic
+    {
+        int a(void) const override { return 1; }
+        int b(void) const override { return 2; }
+        int c(void) const override { return 3; }
+        void * getInterfaceDynamic(StringId const & name) const throw() {
+            if (name == nameOf<ItfDynamic>()) {
+                return static_cast<ItfDynamic *>(const_cast<MultiUnknown *>(this));
+            }
+            return nullptr;
+        }
+    };
+
+    template<unsigned i>
+    struct BenchInterface
+    {
+        virtual unsigned index(void) const = 0;
+    };
+
+    // Interfaces n - 1 down to 0, in that order.
+    template<unsigned n>
+    struct BenchInterfaces
+        : BenchInterface<n - 1U>
+        , BenchInterfaces<n - 1U>
+    {
+        typedef typename boost::mpl::push_front<typename BenchInterfaces<n - 1U>::Sequence, BenchInterface<n - 1U>>::type Sequence;
+    };
+
+    template<>
+    struct BenchInterfaces<0U>
+    {
+        typedef boost::mpl::list<> Sequence;
+    };
+
+    template<unsigned i>
+    struct BenchNames
+    {
+        static void fill(StringId const ** names) {
+            *names = &nameOf<BenchInterface<i - 1U>>();
+            BenchNames<i - 1U>::fill(names + 1);
+        }
+    };
+
+    template<>
+    struct BenchNames<0U>
+    {
+        static void fill(StringId const **) {}
+    };
+
+    struct EmptyUnknown
+        : StandardUnknown<EmptyUnknown>
+    {
+    };
+
+    template<unsigned n>
+    struct BenchUnknown
+        : StandardUnknown<BenchUnknown<n>, typename BenchInterfaces<n>::Sequence>
+        , BenchInterfaces<n>
+    {
+        unsigned index(void) const override { return n; }
+    };
+
+    // Out of line, so that the loops below cannot see through to the implementation.
+    TOOLS_NO_INLINE void * interfaceLookup(Unknown const & unknown, StringId const & name)
+    {
+        return unknown.getInterface(name);
+    }
+
+    TOOLS_NO_INLINE bool interfaceLinear(StringId const * const * names, unsigned count, StringId const & name)
+    {
+        for (unsigned i = 0U; i != count; ++i) {
+            if (*names[i] == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The last listed interface (what a linear search finds last), and a miss, through getInterface and
+    // through comparing each name in turn as lookups used to.
+    template<unsigned n>
+    void interfaceBenchmark(Timing & timing)
+    {
+        static unsigned const lookups = 1000000U;
+        BenchUnknown<n> impl;
+        Unknown const & unknown = impl;
+        StringId const * names[n];
+        BenchNames<n>::fill(names);
+        StringId last(nameOf<BenchInterface<0U>>());
+        StringId miss("InterfaceBenchmarkMiss");
+        TOOLS_ASSERTR(unknown.getInterface<BenchInterface<0U>>()->index() == n);
+        TOOLS_ASSERTR(!unknown.getInterface(miss));
+        // Read through these each time around, so that no lookup can be hoisted out of its loop.
+        StringId const * volatile hitName = &last;
+        StringId const * volatile missName = &miss;
+        uintptr_t sum = 0U;
+        uint64 start = timing.mark();
+        for (unsigned i = 0U; i != lookups; ++i) {
+            sum += reinterpret_cast<uintptr_t>(interfaceLookup(unknown, *hitName));
+        }
+        uint64 hit = timing.mark(start);
+        start = timing.mark();
+        for (unsigned i = 0U; i != lookups; ++i) {
+            sum += reinterpret_cast<uintptr_t>(interfaceLookup(unknown, *missName));
+        }
+        uint64 missed = timing.mark(start);
+        start = timing.mark();
+        for (unsigned i = 0U; i != lookups; ++i) {
+            sum += interfaceLinear(names, n, *hitName) ? 1U : 0U;
+        }
+        uint64 linear = timing.mark(start);
+        TOOLS_ASSERTR(sum != 0U);
+        if (testTimingsReported()) {
+            fprintf(stderr, "getInterface over %u interfaces: hit %.1f ns, miss %.1f ns, linear hit %.1f ns\n", n,
+                static_cast<double>(hit) / lookups, static_cast<double>(missed) / lookups, static_cast<double>(linear) / lookups);
+        }
+        if (n >= 32U) {
+            // Comparing every name to find the last is what the table is there to avoid
+            TOOLS_ASSERTR(hit < linear);
+        }
+    }
 }; // anonymous namespace
 
 TOOLS_TEST_CASE("AutoDispose.basic", [](Test &)
@@ -880,4 +1065,31 @@ TOOLS_TEST_CASE("AutoDispose.equals", [](Test &)
     disp.release();
 });
 
+TOOLS_TEST_CASE("StandardUnknown.dispatch", [](Test &)
+{
+    MultiUnknown impl;
+    Unknown const & unknown = impl;
+    TOOLS_ASSERTR(unknown.getInterface<ItfA>()->a() == 1);
+    TOOLS_ASSERTR(unknown.getInterface<ItfB>()->b() == 2);
+    TOOLS_ASSERTR(unknown.getInterface<ItfC>()->c() == 3);
+    TOOLS_ASSERTR(unknown.getInterface<ItfA>() == static_cast<ItfA *>(&impl));
+    TOOLS_ASSERTR(unknown.getInterface<ItfC>() == static_cast<ItfC *>(&impl));
+    TOOLS_ASSERTR(unknown.getInterface<ItfDynamic>() == static_cast<ItfDynamic *>(&impl));
+    TOOLS_ASSERTR(!unknown.getInterface<Test3>());
+    TOOLS_ASSERTR(!unknown.getInterface(StringIdNull()));
+    // Nothing listed leaves only the dynamic lookup.
+    EmptyUnknown empty;
+    TOOLS_ASSERTR(!static_cast<Unknown const &>(empty).getInterface<ItfA>());
+});
+
+TOOLS_TEST_CASE("StandardUnknown.benchmark", testParamValues({ 1U, 8U, 32U }), [](Test & test, unsigned interfaces)
+{
+    auto timing = test.environment().unmockNow<Timing>();
+    switch (interfaces) {
+    case 1U: interfaceBenchmark<1U>(*timing); break;
+    case 8U: interfaceBenchmark<8U>(*timing); break;
+    default: interfaceBenchmark<32U>(*timing); break;
+    }
+});
+
 #endif // TOOLS_UNIT_TEST
@@ -6,6 +6,7 @@
 #include <tools/Threading.h>
 #include <tools/Tools.h>
 
+#include <algorithm>
 #include <vector>
 
 using namespace tools;
@@ -18,13 +19,12 @@ namespace {
     struct PubBase;
 
 	struct SubscrItem
-		: AllocStatic<>
+		: StandardPhantom< SubscrItem >
 	{
         enum : unsigned {
             CallingFlag = 0x1U,
             DisposedFlag = 0x2U,
             DirtyFlag = 0x4U,
-            InitializingFlag = 0x8U,
             AllocatedFlag = 0x10U,
         };
 
@@ -35,12 +35,29 @@ namespace {
 		Thunk thunk_;
         Thunk dead_;
 		unsigned flags_;
-		SubscrItem * volatile next_;
 	};
 
+    // A snapshot of the subscribers of a publisher. Slots are only ever appended (under the publisher
+    // lock), and used_ is advanced after the slot is written, so invalidate can walk [0, used_) while
+    // cloaked without taking the lock. Compaction copies the live slots into a new table and retires the
+    // old one (and any freed items) through the phantom.
+    struct SubscrTable
+        : StandardPhantom< SubscrTable >
+    {
+        SubscrTable( size_t );
+
+        std::vector< SubscrItem * > slots_;
+        unsigned volatile used_;
+    };
+
 	struct PubBase
 		: Publisher
 	{
+        enum : unsigned {
+            MinCapacity = 8U,
+            MinCompact = 8U,  // Don't bother compacting for fewer free items than this
+        };
+
 		PubBase( void );
 		~PubBase( void );
 
@@ -49,14 +66,16 @@ namespace {
 		void invalidate( void );
 
         // local methods
-        void prune( void );
+        void retire( SubscrItem * );
+        void release( SubscrItem * );
+        void compact( void );
         virtual void makeCall( SubscrItem * ) = 0;
         virtual void makeDeadCall( SubscrItem * ) = 0;
 
-		SubscrItem * volatile head_;
-		unsigned volatile capacity_;
-		unsigned volatile size_;
-        unsigned volatile dead_;
+        AutoDispose< Monitor > lock_;  // Serializes growing and compacting table_
+		SubscrTable * volatile table_;
+		unsigned volatile size_;  // Subscriptions that have not yet made their dead call
+        unsigned volatile dead_;  // Released items still taking up a slot in table_
 	};
 
 	struct SubItemDisp
@@ -151,7 +170,6 @@ SubscrItem::SubscrItem( PubBase * p, Thunk const & t, Thunk const & d, unsigned
     , thunk_( t )
     , dead_( d )
     , flags_( f )
-    , next_( nullptr )
 {
 }
 
@@ -160,13 +178,23 @@ SubscrItem::~SubscrItem( void )
     TOOLS_ASSERT( flags_ == 0U );
 }
 
+//////////////
+// SubscrTable
+//////////////
+
+SubscrTable::SubscrTable( size_t capacity )
+    : slots_( capacity, nullptr )
+    , used_( 0U )
+{
+}
+
 //////////
 // PubBase
 //////////
 
 PubBase::PubBase( void )
-	: head_( nullptr )
-	, capacity_( 0U )
+    : lock_( monitorStaticNew() )
+	, table_( nullptr )
 	, size_( 0U )
     , dead_( 0U )
 {
@@ -174,14 +202,14 @@ PubBase::PubBase( void )
 
 PubBase::~PubBase( void )
 {
-    prune();
 	TOOLS_ASSERT( size_ == 0U );
-	SubscrItem * current = head_;
-	while( current != nullptr ) {
-		SubscrItem * next = current->next_;
-		delete current;
-		current = next;
-	}
+    if( SubscrTable * table = table_ ) {
+        // Everything left is released, and no one else can be looking at this publisher any more
+        for( unsigned i = 0U; i != table->used_; ++i ) {
+            delete table->slots_[ i ];
+        }
+        delete table;
+    }
 }
 
 AutoDispose<>
@@ -191,67 +219,44 @@ PubBase::newSubscription( Thunk const & thunk, Thunk const & dead )
 		// no one to tell, so don't bother
 		return static_cast< Disposable * >( nullptr );
 	}
-	SubItemDisp * ret = nullptr;
-	while( true ) {
-		if( size_ == capacity_ ) {
-			// all nodes in use, make a new one
-			SubscrItem * item = new SubscrItem( this, thunk, dead, SubscrItem::AllocatedFlag );
-			ret = new SubItemDisp( item );
-			SubscrItem * oldHead;
-			do {
-				oldHead = head_;
-				item->next_ = head_;
-			} while( atomicCas( &head_, oldHead, item ) != oldHead );
-			atomicIncrement( &size_ );
-			atomicIncrement( &capacity_ );
-			break;
-		}
-		// try to find one to use
-		SubscrItem * volatile current = head_;
-		while( current != nullptr ) {
-			unsigned flags = atomicRead( &current->flags_ );
-			if( flags == 0U ) {
-				// Disposed but not being called, perfect
-				if( atomicCas( &current->flags_, flags, ( SubscrItem::AllocatedFlag | SubscrItem::InitializingFlag ) ) == flags ) {
-					ret = new SubItemDisp( current );
-                    current->thunk_ = thunk;
-                    current->dead_ = dead;
-					atomicIncrement( &size_ );
-                    // clear the initializing flag, we should be the only one modifying this now
-                    atomicTryUpdate( &current->flags_, []( unsigned & prev )->bool {
-                        bool ret = (( prev & SubscrItem::InitializingFlag ) != 0U );
-                        if( ret ) {
-                            prev = prev & ~SubscrItem::InitializingFlag;
-                        }
-                        return ret;
-                    });
-					break;
-				}
-			}
-			current = current->next_;
-		}
-		if( !!ret ) {
-			break;
-		}
-	}
-	return std::move(ret);
+    SubscrItem * item = new SubscrItem( this, thunk, dead, SubscrItem::AllocatedFlag );
+    {
+        AutoDispose<> l( lock_->enter() );
+        atomicIncrement( &size_ );
+        SubscrTable * table = table_;
+        if( !table || ( table->used_ == table->slots_.size() )) {
+            // Out of room, drop anything released and make space for more
+            compact();
+            table = table_;
+        }
+        table->slots_[ table->used_ ] = item;
+        // Only now may invalidate see the slot
+        atomicSet( &table->used_, table->used_ + 1U );
+    }
+	return new SubItemDisp( item );
 }
 
 void
 PubBase::invalidate( void )
 {
-	SubscrItem * volatile current = head_;
-	while( current != nullptr ) {
+    AutoDispose<> cloak( phantomTryBindPrototype< PhantomUniversal >() );
+    SubscrTable * table = atomicRead( &table_ );
+    if( !table ) {
+        return;
+    }
+    unsigned used = atomicRead( &table->used_ );
+    for( unsigned i = 0U; i != used; ++i ) {
+        SubscrItem * current = table->slots_[ i ];
         unsigned oldFlags, newFlags;
         oldFlags = atomicRead( &current->flags_ );
         bool done = false;
         do {
             if( ( oldFlags & SubscrItem::AllocatedFlag ) == 0U ) {
-                // not in use, move on
+                // released, move on
                 break;
             }
-            if( ( oldFlags & ( SubscrItem::CallingFlag | SubscrItem::DisposedFlag | SubscrItem::InitializingFlag )) == 0U ) {
-                // not currently being called or initialized, let's try to set the calling flag
+            if( ( oldFlags & ( SubscrItem::CallingFlag | SubscrItem::DisposedFlag )) == 0U ) {
+                // not currently being called, let's try to set the calling flag
                 newFlags = oldFlags | SubscrItem::CallingFlag;
                 if( atomicCas( &current->flags_, oldFlags, newFlags ) == oldFlags ) {
                     // If this test failed, something else is going on this this node and it can be ignored
@@ -261,7 +266,7 @@ PubBase::invalidate( void )
             } else {
                 // try to mark this node as dirty
                 do {
-                    if( ( oldFlags & ( SubscrItem::DisposedFlag | SubscrItem::InitializingFlag )) != 0U ) {
+                    if( ( oldFlags & SubscrItem::DisposedFlag ) != 0U ) {
                         done = true;
                         break;
                     } else if( ( oldFlags & SubscrItem::CallingFlag ) == 0U ) {
@@ -271,30 +276,73 @@ PubBase::invalidate( void )
                 } while( atomicCas( &current->flags_, oldFlags, newFlags ) != oldFlags );
             }
         } while( !done );
-		// on to the next target
-		current = current->next_;
 	}
-    this->prune();
 }
 
 void
-PubBase::prune( void )
+PubBase::retire( SubscrItem * item )
 {
-    SubscrItem * volatile current = head_;
-    while( current != nullptr ) {
-        if( dead_ == 0 ) {
-            return;
+    unsigned oldFlags, newFlags;
+    do {
+        oldFlags = atomicRead( &item->flags_ );
+        TOOLS_ASSERT( ( oldFlags & ( SubscrItem::AllocatedFlag | SubscrItem::DisposedFlag )) == SubscrItem::AllocatedFlag );
+        // Claim the node for the dead call.  If a call is already in progress, it still holds CallingFlag
+        // and will make the dead call itself once it sees DisposedFlag.
+        newFlags = oldFlags | SubscrItem::DisposedFlag | SubscrItem::CallingFlag;
+    } while( atomicCas( &item->flags_, oldFlags, newFlags ) != oldFlags );
+    if( ( oldFlags & SubscrItem::CallingFlag ) == 0U ) {
+        this->makeDeadCall( item );
+    }
+}
+
+void
+PubBase::release( SubscrItem * item )
+{
+    // Count the item before it shows as released, so compact never drops an item it can't account for.
+    atomicIncrement( &dead_ );
+    atomicDecrement( &size_ );
+    atomicUpdate( &item->flags_, []( unsigned )->unsigned { return 0U; });
+    // The item may be reclaimed from here on.  Compact once the garbage outweighs the live subscriptions,
+    // which keeps both invalidate and unsubscribe proportional to the live count.
+    unsigned dead = atomicRead( &dead_ );
+    if( ( dead >= MinCompact ) && ( dead > atomicRead( &size_ ))) {
+        AutoDispose<> l( lock_->enter() );
+        if( ( dead_ >= MinCompact ) && ( dead_ > size_ )) {
+            compact();
+        }
+    }
+}
+
+void
+PubBase::compact( void )
+{
+    // Called under lock_
+    AutoDispose<> cloak( phantomTryBindPrototype< PhantomUniversal >() );
+    PhantomCloak & phantom = phantomLocal< PhantomUniversal >();
+    SubscrTable * prev = table_;
+    unsigned used = !!prev ? prev->used_ : 0U;
+    unsigned live = 0U;
+    for( unsigned i = 0U; i != used; ++i ) {
+        if( atomicRead( &prev->slots_[ i ]->flags_ ) != 0U ) {
+            ++live;
         }
-        unsigned oldFlags, oldAltFlags, newFlags;
-        oldFlags = oldAltFlags = newFlags = ( SubscrItem::AllocatedFlag | SubscrItem::DisposedFlag );
-        newFlags |= SubscrItem::CallingFlag;
-        oldAltFlags |= SubscrItem::DirtyFlag;
-        if( atomicCas( &current->flags_, oldFlags, newFlags ) == oldFlags ) {
-            this->makeDeadCall( current );
-        } else if( atomicCas( &current->flags_, oldAltFlags, newFlags ) == oldAltFlags ) {
-            this->makeDeadCall( current );
+    }
+    // Items only ever go from live to released, so the second pass can't find more than we counted.
+    SubscrTable * next = new SubscrTable( std::max< size_t >( MinCapacity, ( live + 1U ) * 2U ));
+    unsigned kept = 0U;
+    for( unsigned i = 0U; i != used; ++i ) {
+        SubscrItem * item = prev->slots_[ i ];
+        if( atomicRead( &item->flags_ ) != 0U ) {
+            next->slots_[ kept++ ] = item;
+        } else {
+            phantom.finalize( AutoDispose< Weakling >( item ));
         }
-        current = current->next_;
+    }
+    next->used_ = kept;
+    atomicSet( &table_, next );
+    atomicSubtract( &dead_, used - kept );
+    if( !!prev ) {
+        phantom.finalize( AutoDispose< Weakling >( prev ));
     }
 }
 
@@ -311,14 +359,7 @@ SubItemDisp::~SubItemDisp( void )
 {
     PubBase * base = node_->parent_;
     TOOLS_ASSERT( !!base );
-    unsigned oldFlags, newFlags;
-    do {
-        oldFlags = atomicRead( &node_->flags_ );
-        newFlags = oldFlags | SubscrItem::DisposedFlag;
-        TOOLS_ASSERT( ( oldFlags & ( SubscrItem::AllocatedFlag | SubscrItem::InitializingFlag | SubscrItem::DisposedFlag )) == SubscrItem::AllocatedFlag );
-    } while( atomicCas( &node_->flags_, oldFlags, newFlags ) != oldFlags );
-    atomicIncrement( &node_->parent_->dead_ );
-    base->prune();  // kick off releasing things
+    base->retire( node_ );
 }
 
 ////////////////
@@ -346,9 +387,13 @@ SimplePubImpl::makeCall( SubscrItem * item )
             item->thunk_();
             newFlags = ( oldFlags & ~( SubscrItem::CallingFlag | SubscrItem::DirtyFlag ));
         } else {
-            newFlags = ( oldFlags & ~( SubscrItem::CallingFlag ));
+            // disposed while we were calling, keep the calling flag as the dead call falls to us
+            newFlags = ( oldFlags & ~( SubscrItem::DirtyFlag ));
         }
     } while( atomicCas( &item->flags_, oldFlags, newFlags ) != oldFlags );
+    if( ( newFlags & SubscrItem::DisposedFlag ) != 0U ) {
+        makeDeadCall( item );
+    }
 }
 
 void
@@ -357,9 +402,7 @@ SimplePubImpl::makeDeadCall( SubscrItem * item )
     if( !!item->dead_ ) {
         item->dead_();
     }
-    atomicDecrement( &dead_ );
-    atomicUpdate( &item->flags_, []( unsigned )->unsigned { return 0U; });
-    atomicDecrement( &size_ );
+    release( item );
 }
 
 //////////////
@@ -408,15 +451,11 @@ TaskPubTask::TaskPubTask( SubscrItem * node, bool dead )
 void
 TaskPubTask::execute( void )
 {
+    // The node may be reclaimed once it is released, so hold on to the parent.
+    PubBase * parent = node_->parent_;
+    bool deadCall = deadCall_;
     // The node is already maked Calling, so we mostly just need to do that
-    if( deadCall_ ) {
-        if( !!node_->dead_ ) {
-            node_->dead_();
-        }
-        atomicDecrement( &node_->parent_->dead_ );
-        atomicUpdate( &node_->flags_, []( unsigned )->unsigned { return 0U; });
-        atomicDecrement( &node_->parent_->size_ );
-    } else {
+    if( !deadCall ) {
         unsigned oldFlags, newFlags;
         // Loop here so that we catch if a node gets marked dirty
         // while we are calling.
@@ -435,12 +474,20 @@ TaskPubTask::execute( void )
                 node_->thunk_();
                 newFlags = ( oldFlags & ~( SubscrItem::CallingFlag | SubscrItem::DirtyFlag ));
             } else {
-                newFlags = ( oldFlags & ~( SubscrItem::CallingFlag ));
+                // disposed while we were calling, the dead call falls to us
+                newFlags = ( oldFlags & ~( SubscrItem::DirtyFlag ));
             }
             // If this fails, something happened while we were calling
         } while( atomicCas( &node_->flags_, oldFlags, newFlags ) != oldFlags );
+        deadCall = (( newFlags & SubscrItem::DisposedFlag ) != 0U );
     }
-    node_->parent_->dispose();  // deref
+    if( deadCall ) {
+        if( !!node_->dead_ ) {
+            node_->dead_();
+        }
+        parent->release( node_ );
+    }
+    parent->dispose();  // deref
 	delete this;
 }
 
@@ -469,3 +516,264 @@ ReqAdaptor::onDeath( void )
 {
     finish();
 }
+
+#include <tools/UnitTest.h>
+#if TOOLS_UNIT_TEST
+#include <tools/Timing.h>
+#include <tools/WeakPointer.h>
+
+//////////
+// Testing
+//////////
+
+namespace {
+    struct InvalidationCounter
+        : Notifiable< InvalidationCounter >
+    {
+        InvalidationCounter( void ) : count_( 0U ), dead_( 0U ) {}
+
+        void onInvalidate( void ) { atomicIncrement( &count_ ); }
+        void onDead( void ) { atomicIncrement( &dead_ ); }
+
+        unsigned volatile count_;
+        unsigned volatile dead_;
+    };
+
+    // Unsubscribes itself from inside its own invalidation.
+    struct InvalidationSelfDisposer
+        : Notifiable< InvalidationSelfDisposer >
+    {
+        InvalidationSelfDisposer( void ) : count_( 0U ), dead_( 0U ) {}
+
+        void onInvalidate( void ) { ++count_; subscription_ = nullptr; }
+        void onDead( void ) { ++dead_; }
+
+        AutoDispose<> subscription_;
+        unsigned count_;
+        unsigned dead_;
+    };
+
+    unsigned
+    publisherSlots( Publisher & pub )
+    {
+        SubscrTable * table = static_cast< PubBase & >( pub ).table_;
+        return !!table ? table->used_ : 0U;
+    }
+
+    // Nanoseconds for this many invalidates of a publisher.
+    uint64
+    publisherTimeInvalidate( Timing & timing, Publisher & pub, unsigned rounds )
+    {
+        uint64 start = timing.mark();
+        for( unsigned i = 0U; i != rounds; ++i ) {
+            pub.invalidate();
+        }
+        return timing.mark( start );
+    }
+
+    struct SeqLockedPair
+    {
+        uint64 first_;
+        uint64 second_;
+    };
+
+    // A writer keeps both halves of the pair equal, so any torn read shows up as a mismatch.
+    struct SeqLockedStressImpl
+        : Notifiable< SeqLockedStressImpl >
+    {
+        enum : uint64 {
+            writes = 100000U,
+        };
+
+        SeqLockedStressImpl( void ) : done_( 0U ), torn_( 0U ), reads_( 0U ) {}
+
+        void writer( void ) {
+            for( uint64 i = 1U; i <= writes; ++i ) {
+                SeqLockedPair next = { i, i };
+                item_.set( next );
+            }
+            atomicSet( &done_, 1U );
+        }
+        void reader( void ) {
+            uint64 last = 0U;
+            uint64 reads = 0U;
+            while( !atomicRead( &done_ )) {
+                SeqLockedPair sample = item_.get();
+                if( ( sample.first_ != sample.second_ ) || ( sample.first_ < last )) {
+                    atomicIncrement( &torn_ );
+                }
+                last = sample.first_;
+                ++reads;
+            }
+            atomicAdd( &reads_, reads );
+        }
+
+        SeqLocked< SeqLockedPair > item_;
+        unsigned volatile done_;
+        unsigned volatile torn_;
+        uint64 volatile reads_;
+    };
+};  // anonymous namespace
+
+TOOLS_TEST_CASE("SeqLocked.basic", [](Test &)
+{
+    SeqLocked< uint64 > item( 5U );
+    TOOLS_ASSERTR( item.get() == 5U );
+    uint32 version = item.version();
+    TOOLS_ASSERTR( ( version & 1U ) == 0U );
+    InvalidationCounter counter;
+    {
+        AutoDispose<> subscription( item.newSubscription( counter.toThunk< &InvalidationCounter::onInvalidate >(), Thunk() ));
+        item.set( 7U );
+        TOOLS_ASSERTR( item.get() == 7U );
+        TOOLS_ASSERTR( item.version() != version );
+        TOOLS_ASSERTR( counter.count_ == 1U );
+        item.update( []( uint64 & ref )->void {
+            ref += 3U;
+        });
+        TOOLS_ASSERTR( item.get() == 10U );
+        TOOLS_ASSERTR( counter.count_ == 2U );
+    }
+    // No longer subscribed
+    item.set( 1U );
+    TOOLS_ASSERTR( counter.count_ == 2U );
+});
+
+TOOLS_TEST_CASE("SeqLocked.throw", [](Test &)
+{
+    SeqLocked< uint64 > item( 5U );
+    uint32 version = item.version();
+    InvalidationCounter counter;
+    AutoDispose<> subscription( item.newSubscription( counter.toThunk< &InvalidationCounter::onInvalidate >(), Thunk() ));
+    bool thrown = false;
+    try {
+        item.update( []( uint64 & ref )->void {
+            ref = 6U;
+            throw 1;
+        });
+    } catch( int ) {
+        thrown = true;
+    }
+    TOOLS_ASSERTR( thrown );
+    // The write side was released and the partial change published
+    TOOLS_ASSERTR( item.version() == version + 2U );
+    TOOLS_ASSERTR( counter.count_ == 1U );
+    TOOLS_ASSERTR( item.get() == 6U );
+    item.set( 8U );
+    TOOLS_ASSERTR( item.get() == 8U );
+});
+
+TOOLS_TEST_CASE("SeqLocked.concurrent", testParamValues({ 1U, 4U }), [](Test & test, unsigned readers)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    SeqLockedStressImpl state;
+    std::vector< AutoDispose< Thread >> threads;
+    for( unsigned i = 0U; i != readers; ++i ) {
+        threads.push_back( threading->fork( "seqLockedReader", state.toThunk< &SeqLockedStressImpl::reader >() ));
+    }
+    threads.push_back( threading->fork( "seqLockedWriter", state.toThunk< &SeqLockedStressImpl::writer >() ));
+    for( auto && thr : threads ) {
+        thr->waitSync();
+    }
+    TOOLS_ASSERTR( state.torn_ == 0U );
+    TOOLS_ASSERTR( state.item_.get().first_ == SeqLockedStressImpl::writes );
+});
+
+TOOLS_TEST_CASE("VersionedPtr.basic", [](Test &)
+{
+    AutoDispose<> cloak( phantomTryBindPrototype< PhantomUniversal >() );
+    VersionedPtr< std::vector< unsigned >> item;
+    TOOLS_ASSERTR( !item.peek() );
+    TOOLS_ASSERTR( item.version() == 0U );
+    InvalidationCounter counter;
+    AutoDispose<> subscription( item.newSubscription( counter.toThunk< &InvalidationCounter::onInvalidate >(), Thunk() ));
+    item.set( std::vector< unsigned >( 3U, 1U ));
+    std::vector< unsigned > const * first = item.peek();
+    TOOLS_ASSERTR( !!first && ( first->size() == 3U ));
+    TOOLS_ASSERTR( item.version() == 1U );
+    TOOLS_ASSERTR( counter.count_ == 1U );
+    item.update( []( std::vector< unsigned > const * prev )->std::vector< unsigned > {
+        std::vector< unsigned > ret( *prev );
+        ret.push_back( 2U );
+        return ret;
+    });
+    std::vector< unsigned > const * second = item.peek();
+    TOOLS_ASSERTR( second != first );
+    TOOLS_ASSERTR( second->size() == 4U );
+    TOOLS_ASSERTR( item.version() == 2U );
+    TOOLS_ASSERTR( counter.count_ == 2U );
+    // The retired snapshot stays readable for as long as we are cloaked.
+    TOOLS_ASSERTR( first->size() == 3U );
+    subscription = nullptr;
+});
+
+TOOLS_TEST_CASE("Publisher.unsubscribe", [](Test &)
+{
+    AutoDispose< Publisher > pub( simplePublisherNew() );
+    InvalidationCounter counter;
+    std::vector< AutoDispose<> > subscriptions;
+    for( unsigned i = 0U; i != 100U; ++i ) {
+        subscriptions.push_back( pub->newSubscription( counter.toThunk< &InvalidationCounter::onInvalidate >(), counter.toThunk< &InvalidationCounter::onDead >() ));
+    }
+    pub->invalidate();
+    TOOLS_ASSERTR( counter.count_ == 100U );
+    // The dead call is made before the unsubscribe returns.
+    subscriptions.resize( 10U );
+    TOOLS_ASSERTR( counter.dead_ == 90U );
+    pub->invalidate();
+    TOOLS_ASSERTR( counter.count_ == 110U );
+    // Released entries have been compacted away.
+    TOOLS_ASSERTR( publisherSlots( *pub ) < 40U );
+    // Unsubscribing from within the call still gets exactly one dead call, made once the call returns.
+    InvalidationSelfDisposer self;
+    self.subscription_ = pub->newSubscription( self.toThunk< &InvalidationSelfDisposer::onInvalidate >(), self.toThunk< &InvalidationSelfDisposer::onDead >() );
+    pub->invalidate();
+    pub->invalidate();
+    TOOLS_ASSERTR( self.count_ == 1U );
+    TOOLS_ASSERTR( self.dead_ == 1U );
+    TOOLS_ASSERTR( counter.count_ == 130U );
+    subscriptions.clear();
+    TOOLS_ASSERTR( counter.dead_ == 100U );
+});
+
+TOOLS_TEST_CASE("Publisher.churn", testParamValues({ 64U, 1024U }), [](Test & test, unsigned live)
+{
+    static unsigned const churn = 100000U;
+    // About 4M subscriber calls per timing, which takes milliseconds.
+    unsigned const rounds = ( 1U << 22 ) / live;
+    auto timing = test.environment().unmockNow<Timing>();
+    InvalidationCounter counter;
+    Thunk thunk( counter.toThunk< &InvalidationCounter::onInvalidate >() );
+    // A publisher that only ever had the live subscribers, for reference.
+    AutoDispose< Publisher > steady( simplePublisherNew() );
+    std::vector< AutoDispose<> > steadySubs;
+    for( unsigned i = 0U; i != live; ++i ) {
+        steadySubs.push_back( steady->newSubscription( thunk, Thunk() ));
+    }
+    uint64 steadyNs = publisherTimeInvalidate( *timing, *steady, rounds );
+    // The same live set, after a long history of subscribers coming and going.
+    AutoDispose< Publisher > churned( simplePublisherNew() );
+    std::vector< AutoDispose<> > churnedSubs;
+    for( unsigned i = 0U; i != live; ++i ) {
+        churnedSubs.push_back( churned->newSubscription( thunk, Thunk() ));
+    }
+    uint64 start = timing->mark();
+    for( unsigned i = 0U; i != churn; ++i ) {
+        // Replace a live subscriber, and have a short lived one come and go.
+        AutoDispose<> transient( churned->newSubscription( thunk, Thunk() ));
+        churnedSubs[ i % live ] = churned->newSubscription( thunk, Thunk() );
+    }
+    uint64 churnNs = timing->mark( start );
+    unsigned slots = publisherSlots( *churned );
+    TOOLS_ASSERTR( slots <= ( 2U * ( live + 1U ) + PubBase::MinCompact ));
+    uint64 churnedNs = publisherTimeInvalidate( *timing, *churned, rounds );
+    if( testTimingsReported() ) {
+        fprintf( stderr, "Publisher churn %u live: %.2f ns/invalidate steady, %.2f ns/invalidate after %u churns (%u slots), %.2f ns/churn\n", live,
+            static_cast< double >( steadyNs ) / rounds, static_cast< double >( churnedNs ) / rounds, churn, slots,
+            static_cast< double >( churnNs ) / churn );
+    }
+    // Compaction keeps the history from slowing down an invalidate.
+    TOOLS_ASSERTR( churnedNs < ( 2U * steadyNs ));
+});
+
+#endif /* TOOLS_UNIT_TEST */
@@ -3,6 +3,7 @@
 #include <tools/Algorithms.h>
 #include <tools/Concurrency.h>
 #include <tools/InterfaceTools.h>
+#include <tools/StartupProfile.h>
 #include <tools/Threading.h>
 #include <tools/Timing.h>
 
@@ -483,11 +484,12 @@ namespace {
         unsigned value_;
     };
 
-    static ScalableCounter totalTrackedMemory;
-
+    // Tracked allocations happen during static initialization and destruction, so construct this on first use
+    // and never destroy it.
     static ScalableCounter &
     getTotalTrackedMemory( void ) {
-        return totalTrackedMemory;
+        static ScalableCounter * totalTrackedMemory = new( impl::safeMalloc( sizeof( ScalableCounter ))) ScalableCounter;
+        return *totalTrackedMemory;
     }
 
     template< typename InterfaceT >
@@ -517,6 +519,7 @@ namespace {
         {
             HeapPrefix * prefix;
             uint8 * body;
+            impl::startupProfileNoteAlloc( size );
             size_t userSize = size - phase;
             if( hasSuffix( userSize )) {
                 prefix = static_cast< HeapPrefix * >( inner_->map( size + sizeof( HeapPrefix )
@@ -2103,6 +2106,28 @@ namespace tools
             return ret;
         }
 
+        void *
+        cpuSlotsAlloc(
+            size_t size )
+        {
+            // Over allocate to align to a cache line, stashing the original pointer just before the result.
+            uint8 * raw = static_cast< uint8 * >( safeMalloc( size + 64U + sizeof( void * )));
+            uint8 * ret = raw + sizeof( void * );
+            ret += ( 64U - ( reinterpret_cast< size_t >( ret ) & 63U )) & 63U;
+            reinterpret_cast< void ** >( ret )[ -1 ] = raw;
+            ::memset( ret, 0, size );
+            return ret;
+        }
+
+        void
+        cpuSlotsFree(
+            void * site )
+        {
+            if( !!site ) {
+                free( static_cast< void ** >( site )[ -1 ] );
+            }
+        }
+
         bool
         leakProtect( void )
         {
@@ -2916,6 +2941,7 @@ AffinityInherentBase::map(
     impl::ResourceSample const & sample,
     size_t phase )
 {
+    impl::startupProfileNoteAlloc( size );
     AlignSpec spec;
     alignSpecOf( &spec, size + sizeof( Unmapper * ), phase + sizeof( Unmapper * ));
     void * site = nullptr;
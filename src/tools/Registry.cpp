@@ -53,6 +53,26 @@ namespace {
         key.itf_ = nullptr;
     }
 
+    inline uint32
+    registryHash( RegistryKey const & key ) {
+        return tools::HashAnyOf< RegistryKey >()( key );
+    }
+
+    // An immutable perfect hash over the (service, type) pairs in the sealed bucket chains. A slot holds the
+    // newest key of the one pair that hashes there. Older keys, and other pairs with the very same hash, are
+    // still found in the sealed chains.
+    struct RegistryFrozen
+    {
+        RegistryFrozen( std::vector< RegistryKey * > const & );
+
+        RegistryKey * slotOf( uint32 ) const;
+
+        uint32 buckets_;
+        uint32 slots_;
+        std::vector< uint32 > displacements_;
+        std::vector< RegistryKey * > table_;
+    };
+
     struct RegistryEnumerationRoot
         : RegistryEnumeration
     {
@@ -67,20 +87,32 @@ namespace {
         RegistryKey * volatile typeRoot_;
     };
 
+    // Services live in bucket chains until the registry is frozen. Freezing seals every chain (flagging
+    // its head) and indexes what they hold in a RegistryFrozen. Keys inserted after that go to the small
+    // overflow table, where they shadow older keys for the same pair. Few ever land there, so lookups only
+    // walk it once overflowed_ says it may hold something.
     struct RegistryGlobal
     {
         static size_t const registryMapBucketsUsed = 65536U;
+        static size_t const registryOverflowBucketsUsed = 1024U;
 
         RegistryGlobal( void );
         ~RegistryGlobal( void );
 
-        RegistryKey * findService( RegistryKey const &, RegistryKey * );
-        RegistryKey * volatile * bucketOf( RegistryKey const & );
+        static RegistryKey * findChain( RegistryKey const &, RegistryKey * );
+        RegistryKey * findSealed( RegistryKey const &, uint32 );
+        RegistryKey * findService( RegistryKey const & );
         void * peekService( RegistryKey const &, FactoryRegistry ** );
         void insertService( RegistryKey * );
+        RegistryKey * raceService( RegistryKey * );
         void * pokeFactoryService( RegistryKey const &, AutoDispose<> &, void *, FactoryRegistry & );
+        void freeze( void );
 
-        RegistryKey * volatile services_[ registryMapBucketsUsed ];
+        FlagPointer< RegistryKey > volatile services_[ registryMapBucketsUsed ];
+        RegistryKey * volatile overflow_[ registryOverflowBucketsUsed ];
+        RegistryFrozen * volatile frozen_;
+        uint32 volatile freezing_;
+        uint32 volatile overflowed_;  // counted before each key goes into the overflow table
     };
 
     struct AutoRegisterImpl
@@ -185,6 +217,7 @@ namespace tools {
         if( !factory ) {
             return nullptr;
         }
+        StartupProfileScope profile( "registry", serviceName, typeName );
         void * newService;
         AutoDispose<> newServiceDisp( factory->link( &newService, typeName ));
         if( !newService ) {
@@ -194,6 +227,11 @@ namespace tools {
         TOOLS_ASSERT( !!newServiceDisp );
         return r.pokeFactoryService( k, newServiceDisp, newService, *factory );
     }
+
+    void
+    registryFreeze( void ) {
+        registryMapGlobal().freeze();
+    }
 };  // tools namespace
 
 //////////
@@ -234,28 +272,75 @@ RegistryEnumerationRoot::post( RegistryKey * key )
     atomicPush( &typeRoot_, key, &RegistryKey::nextService_ );
 }
 
+/////////////////
+// RegistryFrozen
+/////////////////
+
+RegistryFrozen::RegistryFrozen( std::vector< RegistryKey * > const & keys )
+{
+    // keys are in chain order, newest first, so the first key with a given hash is the newest key of its
+    // pair.
+    std::vector< std::pair< uint32, RegistryKey * >> firsts;
+    for( auto && key : keys ) {
+        firsts.push_back( std::make_pair( registryHash( *key ), key ));
+    }
+    std::stable_sort( firsts.begin(), firsts.end(), []( std::pair< uint32, RegistryKey * > const & l, std::pair< uint32, RegistryKey * > const & r )->bool {
+        return l.first < r.first;
+    });
+    firsts.erase( std::unique( firsts.begin(), firsts.end(), []( std::pair< uint32, RegistryKey * > const & l, std::pair< uint32, RegistryKey * > const & r )->bool {
+        return l.first == r.first;
+    }), firsts.end() );
+    std::vector< uint32 > hashes;
+    for( auto && first : firsts ) {
+        hashes.push_back( first.first );
+    }
+    std::vector< uint32 > slotOf;
+    tools::impl::perfectHashBuild( hashes.data(), hashes.size(), buckets_, slots_, displacements_, slotOf );
+    table_.assign( slots_, nullptr );
+    for( uint32 i = 0U; i != firsts.size(); ++i ) {
+        table_[ slotOf[ i ]] = firsts[ i ].second;
+    }
+}
+
+RegistryKey *
+RegistryFrozen::slotOf( uint32 hash ) const
+{
+    return table_[ tools::impl::perfectHashSlot( hash, displacements_[ hash & ( buckets_ - 1U )], slots_ )];
+}
+
 /////////////////
 // RegistryGlobal
 /////////////////
 
 RegistryGlobal::RegistryGlobal( void )
+    : frozen_( nullptr )
+    , freezing_( 0U )
+    , overflowed_( 0U )
 {
-    std::fill( services_, services_ + registryMapBucketsUsed, static_cast< RegistryKey * >( nullptr ));
+    for( auto && bucket : services_ ) {
+        bucket.reset( nullptr );
+    }
+    std::fill( overflow_, overflow_ + registryOverflowBucketsUsed, static_cast< RegistryKey * >( nullptr ));
 }
 
 RegistryGlobal::~RegistryGlobal( void )
 {
-    std::for_each( services_, services_ + registryMapBucketsUsed, []( RegistryKey * bucket )->void {
+    auto release = []( RegistryKey * bucket )->void {
         while( RegistryKey * i = bucket ) {
             bucket = i->nextMap_;
             TOOLS_ASSERT( isEnd( *i ));
             delete i;
         }
-    });
+    };
+    for( auto && bucket : services_ ) {
+        release( bucket.get() );
+    }
+    std::for_each( overflow_, overflow_ + registryOverflowBucketsUsed, release );
+    delete frozen_;
 }
 
 RegistryKey *
-RegistryGlobal::findService( RegistryKey const & key, RegistryKey * bucket )
+RegistryGlobal::findChain( RegistryKey const & key, RegistryKey * bucket )
 {
     while( RegistryKey * i = bucket ) {
         if( ( i->typeName_ == key.typeName_ ) && ( i->serviceName_ == key.serviceName_ ) && !isEnd( *i )) {
@@ -266,22 +351,52 @@ RegistryGlobal::findService( RegistryKey const & key, RegistryKey * bucket )
     return nullptr;
 }
 
-RegistryKey * volatile *
-RegistryGlobal::bucketOf( RegistryKey const & key )
+RegistryKey *
+RegistryGlobal::findSealed( RegistryKey const & key, uint32 hash )
 {
-    return &services_[ tools::HashAnyOf< RegistryKey >()( key ) % registryMapBucketsUsed ];
+    if( RegistryFrozen const * frozen = atomicRead( &frozen_ )) {
+        RegistryKey * i = frozen->slotOf( hash );
+        if( !i ) {
+            return nullptr;
+        }
+        if( *i == key ) {
+            if( !isEnd( *i )) {
+                return i;
+            }
+        } else if( registryHash( *i ) != hash ) {
+            return nullptr;
+        }
+        // Either the newest key for the pair was removed, or another pair with the same hash holds the
+        // slot. The sealed chain has every key.
+    }
+    return findChain( key, services_[ hash % registryMapBucketsUsed ].get() );
+}
+
+RegistryKey *
+RegistryGlobal::findService( RegistryKey const & key )
+{
+    uint32 hash = registryHash( key );
+    RegistryKey * sealed = findSealed( key, hash );
+    if( !atomicRead( &overflowed_ )) {
+        return sealed;
+    }
+    // A newer key for the pair in the overflow table shadows the sealed one.
+    if( RegistryKey * existing = findChain( key, atomicRead( &overflow_[ hash % registryOverflowBucketsUsed ] ))) {
+        return existing;
+    }
+    return sealed;
 }
 
 void *
 RegistryGlobal::peekService( RegistryKey const & key, FactoryRegistry ** factory )
 {
-    if( RegistryKey * existing = findService( key, *bucketOf( key ))) {
+    if( RegistryKey * existing = findService( key )) {
         return existing->itf_;
     }
     RegistryKey factoryKey;
     factoryKey.serviceName_ = nameOf< FactoryRegistry >();
     factoryKey.typeName_ = key.serviceName_;
-    if( RegistryKey * factoryReg = findService( factoryKey, *bucketOf( factoryKey ))) {
+    if( RegistryKey * factoryReg = findService( factoryKey )) {
         *factory = static_cast< FactoryRegistry * >( factoryReg->itf_ );
     } else {
         *factory = nullptr;
@@ -292,27 +407,70 @@ RegistryGlobal::peekService( RegistryKey const & key, FactoryRegistry ** factory
 void
 RegistryGlobal::insertService( RegistryKey * key )
 {
-    atomicPush( bucketOf( *key ), key, &RegistryKey::nextMap_ );
+    uint32 hash = registryHash( *key );
+    bool pushed = atomicTryUpdate( &services_[ hash % registryMapBucketsUsed ], [key]( FlagPointer< RegistryKey > & ref )->bool {
+        if( isEnd( ref )) {
+            return false;
+        }
+        key->nextMap_ = ref.get();
+        ref.reset( key );
+        return true;
+    });
+    if( !pushed ) {
+        atomicIncrement( &overflowed_ );
+        atomicPush( &overflow_[ hash % registryOverflowBucketsUsed ], key, &RegistryKey::nextMap_ );
+    }
 }
 
-void *
-RegistryGlobal::pokeFactoryService( RegistryKey const & key, AutoDispose<> & serviceDisp, void * service, FactoryRegistry & factory )
+RegistryKey *
+RegistryGlobal::raceService( RegistryKey * key )
 {
-    RegistryKey * i = new RegistryKey;
-    *i = key;
-    i->itf_ = service;
-    // Race to insert
-    RegistryKey * ret;
-    atomicTryUpdate( bucketOf( key ), [&]( RegistryKey *& ref )->bool {
-        if( RegistryKey * existing = findService( key, ref )) {
+    // Race to insert, returning whichever key for the pair won. Once the bucket chain is sealed, what it
+    // holds will not change, so the race moves to the overflow bucket.
+    uint32 hash = registryHash( *key );
+    RegistryKey * ret = nullptr;
+    bool sealed = false;
+    atomicTryUpdate( &services_[ hash % registryMapBucketsUsed ], [&]( FlagPointer< RegistryKey > & ref )->bool {
+        sealed = isEnd( ref );
+        if( sealed ) {
+            return false;
+        }
+        if( RegistryKey * existing = findChain( *key, ref.get() )) {
             ret = existing;
             return false;
         }
-        ret = i;
-        i->nextMap_ = ref;
-        ref = i;
+        ret = key;
+        key->nextMap_ = ref.get();
+        ref.reset( key );
         return true;
     });
+    if( !sealed ) {
+        return ret;
+    }
+    atomicIncrement( &overflowed_ );
+    atomicTryUpdate( &overflow_[ hash % registryOverflowBucketsUsed ], [&]( RegistryKey *& ref )->bool {
+        ret = findChain( *key, ref );
+        if( !ret ) {
+            ret = findSealed( *key, hash );
+        }
+        if( !!ret ) {
+            return false;
+        }
+        ret = key;
+        key->nextMap_ = ref;
+        ref = key;
+        return true;
+    });
+    return ret;
+}
+
+void *
+RegistryGlobal::pokeFactoryService( RegistryKey const & key, AutoDispose<> & serviceDisp, void * service, FactoryRegistry & factory )
+{
+    RegistryKey * i = new RegistryKey;
+    *i = key;
+    i->itf_ = service;
+    RegistryKey * ret = raceService( i );
     if( ret != i ) {
         // Collision
         serviceDisp.release();
@@ -329,6 +487,28 @@ RegistryGlobal::pokeFactoryService( RegistryKey const & key, AutoDispose<> & ser
     return ret->itf_;
 }
 
+void
+RegistryGlobal::freeze( void )
+{
+    if( atomicCas( &freezing_, 0U, 1U ) != 0U ) {
+        return;
+    }
+    // Seal each chain, after which inserts go to the overflow table and the chain is immutable. Lookups
+    // keep walking the sealed chains until the frozen table is published.
+    std::vector< RegistryKey * > keys;
+    for( auto && bucket : services_ ) {
+        atomicTryUpdate( &bucket, []( FlagPointer< RegistryKey > & ref )->bool {
+            setEnd( ref );
+            return true;
+        });
+        for( RegistryKey * i = bucket.get(); !!i; i = i->nextMap_ ) {
+            keys.push_back( i );
+        }
+    }
+    RegistryFrozen * frozen = new RegistryFrozen( keys );
+    atomicSet( &frozen_, frozen );
+}
+
 ///////////////////
 // AutoRegisterImpl
 ///////////////////
@@ -406,3 +586,147 @@ AnyServiceImpl::get( StringId const & serviceName )
 {
     return registryFetch( serviceName, typeName_ );
 }
+
+#include <tools/UnitTest.h>
+#if TOOLS_UNIT_TEST
+#include <tools/Environment.h>
+#include <tools/Timing.h>
+
+#include <memory>
+
+namespace {
+    RegistryKey *
+    registryTestInsert( RegistryGlobal & registry, StringId const & serviceName, StringId const & typeName, void * itf )
+    {
+        RegistryKey * i = new RegistryKey;
+        i->serviceName_ = serviceName;
+        i->typeName_ = typeName;
+        i->itf_ = itf;
+        i->nextService_ = nullptr;
+        registry.insertService( i );
+        return i;
+    }
+
+    void *
+    registryTestFetch( RegistryGlobal & registry, StringId const & serviceName, StringId const & typeName )
+    {
+        RegistryKey k;
+        k.serviceName_ = serviceName;
+        k.typeName_ = typeName;
+        FactoryRegistry * factory;
+        return registry.peekService( k, &factory );
+    }
+
+    StringId
+    registryTestType( unsigned i )
+    {
+        char buf[ 64 ];
+        sprintf( buf, "TestRegistryFreeze type %u", i );
+        return StringId( buf );
+    }
+};  // anonymous namespace
+
+////////
+// Tests
+////////
+
+TOOLS_TEST_CASE("Registry.freeze", [](Test &)
+{
+    static unsigned const count = 1000U;
+    // The registry is large, and this one must not be confused with the global one.
+    std::unique_ptr< RegistryGlobal > registry( new RegistryGlobal );
+    StringId serviceName( "TestRegistryFreeze" );
+    StringId shadowName( "TestRegistryFreeze.shadow" );
+    int values[ count + 2U ];
+    std::vector< RegistryKey * > keys;
+    for( unsigned i = 0U; i != count; ++i ) {
+        keys.push_back( registryTestInsert( *registry, serviceName, registryTestType( i ), &values[ i ] ));
+    }
+    // The newer of two registrations for a pair shadows the older one until it is removed.
+    RegistryKey * older = registryTestInsert( *registry, shadowName, serviceName, &values[ count ] );
+    RegistryKey * newer = registryTestInsert( *registry, shadowName, serviceName, &values[ count + 1U ] );
+    keys[ 0 ]->dispose();
+    registry->freeze();
+    TOOLS_ASSERTR( !!registry->frozen_ );
+    TOOLS_ASSERTR( !registryTestFetch( *registry, serviceName, registryTestType( 0U )));
+    for( unsigned i = 1U; i != count; ++i ) {
+        TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( i )) == &values[ i ] );
+    }
+    TOOLS_ASSERTR( !registryTestFetch( *registry, serviceName, StringId( "TestRegistryFreeze absent" )));
+    TOOLS_ASSERTR( registryTestFetch( *registry, shadowName, serviceName ) == &values[ count + 1U ] );
+    newer->dispose();
+    TOOLS_ASSERTR( registryTestFetch( *registry, shadowName, serviceName ) == &values[ count ] );
+    older->dispose();
+    TOOLS_ASSERTR( !registryTestFetch( *registry, shadowName, serviceName ));
+    // Removal after freezing
+    keys[ 1 ]->dispose();
+    TOOLS_ASSERTR( !registryTestFetch( *registry, serviceName, registryTestType( 1U )));
+    // Later inserts land in the overflow table, and shadow frozen pairs just as before.
+    RegistryKey * late = registryTestInsert( *registry, serviceName, registryTestType( 2U ), &values[ 0 ] );
+    TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( 2U )) == &values[ 0 ] );
+    late->dispose();
+    TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( 2U )) == &values[ 2 ] );
+    RegistryKey * fresh = registryTestInsert( *registry, serviceName, registryTestType( count ), &values[ 0 ] );
+    TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( count )) == &values[ 0 ] );
+    // Factory races lose to frozen and overflow keys alike.
+    RegistryKey * race = new RegistryKey;
+    *race = *keys[ 3 ];
+    TOOLS_ASSERTR( registry->raceService( race ) == keys[ 3 ] );
+    *race = *fresh;
+    TOOLS_ASSERTR( registry->raceService( race ) == fresh );
+    race->typeName_ = registryTestType( count + 1U );
+    TOOLS_ASSERTR( registry->raceService( race ) == race );
+    TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( count + 1U )) == &values[ 0 ] );
+    // Only the first freeze has any effect.
+    RegistryFrozen * frozen = registry->frozen_;
+    registry->freeze();
+    TOOLS_ASSERTR( registry->frozen_ == frozen );
+    TOOLS_ASSERTR( registryTestFetch( *registry, serviceName, registryTestType( 5U )) == &values[ 5 ] );
+    for( auto && key : keys ) {
+        key->dispose();
+    }
+    fresh->dispose();
+    race->dispose();
+});
+
+TOOLS_TEST_CASE("Registry.freeze.benchmark", testParamValues({ 262144U, 524288U }), [](Test & test, unsigned count)
+{
+    // Four and eight keys per bucket, so finding one in the chains means walking a few.
+    TOOLS_ASSERTR( count >= ( 4U * RegistryGlobal::registryMapBucketsUsed ));
+    static unsigned const iterations = 1U << 22;
+    auto timing = test.environment().unmockNow< Timing >();
+    std::unique_ptr< RegistryGlobal > registry( new RegistryGlobal );
+    StringId serviceName( "TestRegistryFreeze" );
+    std::vector< RegistryKey > lookups( count );
+    std::vector< RegistryKey * > keys;
+    for( unsigned i = 0U; i != count; ++i ) {
+        lookups[ i ].serviceName_ = serviceName;
+        lookups[ i ].typeName_ = registryTestType( i );
+        keys.push_back( registryTestInsert( *registry, serviceName, lookups[ i ].typeName_, &lookups[ i ] ));
+    }
+    auto run = [&]( void )->uint64 {
+        FactoryRegistry * factory;
+        void * volatile sink = nullptr;
+        uint64 start = timing->mark();
+        for( unsigned i = 0U; i != iterations; ++i ) {
+            // Stride through the keys (count is a power of 2) so consecutive lookups do not share cache lines.
+            sink = registry->peekService( lookups[ ( i * 2654435761U ) & ( count - 1U ) ], &factory );
+        }
+        uint64 elapsed = timing->mark( start );
+        TOOLS_ASSERTR( !!sink );
+        return elapsed;
+    };
+    uint64 chained = run();
+    registry->freeze();
+    uint64 frozen = run();
+    if( testTimingsReported() ) {
+        fprintf( stderr, "Registry fetch over %u pairs: chained %.1f ns, frozen %.1f ns\n", count,
+            static_cast< double >( chained ) / iterations, static_cast< double >( frozen ) / iterations );
+    }
+    // One probe of the sealed table, where chains must be walked.
+    TOOLS_ASSERTR( frozen < chained );
+    for( auto && key : keys ) {
+        key->dispose();
+    }
+});
+#endif /* TOOLS_UNIT_TEST */
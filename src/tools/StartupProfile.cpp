@@ -0,0 +1,494 @@
+#include "toolsprecompiled.h"
+
+#include <tools/Concurrency.h>
+#include <tools/StartupProfile.h>
+#include <tools/Threading.h>
+
+#include "TimingImpl.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace tools;
+
+////////
+// Types
+////////
+
+namespace {
+    struct ProfileFrame;
+
+    // What the profile keeps for each thread. Only the owning thread touches it.
+    struct ProfileThread
+    {
+        ProfileThread( void ) : top_( nullptr ), allocs_( 0U ), bytes_( 0U ) {}
+
+        ProfileFrame * top_;  // innermost attached frame
+        uint64 allocs_;
+        uint64 bytes_;
+    };
+
+    // Frames are never freed while recording, so they may be finished from any thread.
+    struct ProfileFrame
+    {
+        ProfileFrame( char const *, StringId const &, StringId const &, ProfileThread * );
+
+        void detach( void );
+
+        char const * kind_;
+        StringId name_;
+        StringId detail_;
+        ProfileFrame * parent_;
+        ProfileFrame * next_;  // all frames, newest first
+        ProfileThread * volatile thread_;  // while attached
+        uint64 begin_;
+        uint64 end_;
+        uint64 cpu_;
+        uint64 allocs_;
+        uint64 bytes_;
+        uint64 cpuMark_;
+        // Detaching and leaving may happen on different threads, in either order. Each takes one from this,
+        // and the frame is complete once both have, so the second publishes what the first wrote.
+        unsigned volatile pending_;
+    };
+
+    enum : unsigned {
+        profileUnknown = 0U,  // the environment variable has not been looked at yet
+        profileOff,
+        profileOn,
+    };
+};  // anonymous namespace
+
+//////////
+// Statics
+//////////
+
+// These are all constant initialized, as frames may be recorded during static initialization.
+static unsigned volatile profileState_ = profileUnknown;
+static ProfileFrame * volatile profileFrames_ = nullptr;
+// Set once the handle has been constructed; allocations made while constructing it are not counted.
+static StandardThreadLocalHandle< ProfileThread > * volatile profileThreads_ = nullptr;
+
+///////////////////////
+// Non-member Functions
+///////////////////////
+
+static ProfileThread *
+profileThreadGet( void )
+{
+    static StandardThreadLocalHandle< ProfileThread > threads;
+    atomicSet( &profileThreads_, &threads );
+    return threads.get();
+}
+
+static ProfileThread *
+profileThreadPeek( void )
+{
+    StandardThreadLocalHandle< ProfileThread > * threads = atomicRead( &profileThreads_ );
+    if( !threads || threads->isDead() ) {
+        return nullptr;
+    }
+    return threads->peek();
+}
+
+static StartupProfileSort
+profileSortConfigured( void )
+{
+    char const * sort = getenv( "TOOLS_STARTUP_PROFILE_SORT" );
+    if( !sort ) {
+        return StartupProfileSortWall;
+    }
+    if( strcmp( sort, "self" ) == 0 ) {
+        return StartupProfileSortSelf;
+    }
+    if( strcmp( sort, "cpu" ) == 0 ) {
+        return StartupProfileSortCpu;
+    }
+    if( strcmp( sort, "allocs" ) == 0 ) {
+        return StartupProfileSortAllocs;
+    }
+    if( strcmp( sort, "bytes" ) == 0 ) {
+        return StartupProfileSortBytes;
+    }
+    return StartupProfileSortWall;
+}
+
+static uint64
+profileSortKey( StartupProfileEntry const & entry, StartupProfileSort sort )
+{
+    switch( sort ) {
+    case StartupProfileSortSelf: return entry.self_;
+    case StartupProfileSortCpu: return entry.cpu_;
+    case StartupProfileSortAllocs: return entry.allocs_;
+    case StartupProfileSortBytes: return entry.bytes_;
+    default: return entry.wall_;
+    }
+}
+
+static std::string
+profileLabel( StartupProfileEntry const & entry )
+{
+    std::string ret( entry.kind_ );
+    ret += ' ';
+    ret += entry.name_.c_str();
+    if( !IsNullOrEmptyStringId( entry.detail_ )) {
+        ret += '/';
+        ret += entry.detail_.c_str();
+    }
+    return ret;
+}
+
+// Folded stacks: each frame's path from its outermost ancestor, and its self time in microseconds.
+static void
+profileWriteFolded( FILE * file, std::vector< StartupProfileEntry > const & entries )
+{
+    for( auto && entry : entries ) {
+        uint64 micros = entry.self_ / TOOLS_NANOSECONDS_PER_MICROSECOND;
+        if( !micros ) {
+            continue;
+        }
+        std::vector< size_t > path;
+        for( size_t i = static_cast< size_t >( &entry - entries.data() ); i != SIZE_MAX; i = entries[ i ].parent_ ) {
+            path.push_back( i );
+        }
+        std::string line;
+        for( auto i = path.rbegin(); i != path.rend(); ++i ) {
+            if( !line.empty() ) {
+                line += ';';
+            }
+            line += profileLabel( entries[ *i ]);
+        }
+        fprintf( file, "%s %llu\n", line.c_str(), static_cast< unsigned long long >( micros ));
+    }
+}
+
+///////////////
+// ProfileFrame
+///////////////
+
+ProfileFrame::ProfileFrame( char const * kind, StringId const & name, StringId const & detail, ProfileThread * thread )
+    : kind_( kind )
+    , name_( name )
+    , detail_( detail )
+    , parent_( thread->top_ )
+    , next_( nullptr )
+    , thread_( thread )
+    , begin_( impl::getHighResTime() )
+    , end_( 0U )
+    , cpu_( 0U )
+    , allocs_( thread->allocs_ )
+    , bytes_( thread->bytes_ )
+    , cpuMark_( impl::getThreadCpuTime() )
+    , pending_( 2U )
+{
+}
+
+void
+ProfileFrame::detach( void )
+{
+    ProfileThread * thread = thread_;
+    TOOLS_ASSERT( thread->top_ == this );
+    cpu_ += impl::getThreadCpuTime() - cpuMark_;
+    allocs_ = thread->allocs_ - allocs_;
+    bytes_ = thread->bytes_ - bytes_;
+    thread->top_ = parent_;
+    thread_ = nullptr;
+    atomicDecrement( &pending_ );
+}
+
+namespace tools {
+    namespace impl {
+        bool
+        startupProfileRecording( void )
+        {
+            unsigned state = atomicRead( &profileState_ );
+            if( TOOLS_UNLIKELY( state == profileUnknown )) {
+                atomicCas( &profileState_, profileUnknown, !!getenv( "TOOLS_STARTUP_PROFILE" ) ? profileOn : profileOff );
+                state = atomicRead( &profileState_ );
+            }
+            return state == profileOn;
+        }
+
+        void *
+        startupProfileEnter( char const * kind, StringId const & name, StringId const & detail )
+        {
+            ProfileThread * thread = profileThreadGet();
+            ProfileFrame * frame = new ProfileFrame( kind, name, detail, thread );
+            thread->top_ = frame;
+            atomicPush( &profileFrames_, frame, &ProfileFrame::next_ );
+            return frame;
+        }
+
+        void
+        startupProfileDetach( void * site )
+        {
+            ProfileFrame * frame = static_cast< ProfileFrame * >( site );
+            if( !!frame->thread_ ) {
+                frame->detach();
+            }
+        }
+
+        void
+        startupProfileLeave( void * site )
+        {
+            ProfileFrame * frame = static_cast< ProfileFrame * >( site );
+            // Only the thread it is attached to may detach it. An asynchronous frame may finish elsewhere
+            // before its launcher gets around to detaching it; it does not count as done until then.
+            ProfileThread * self = profileThreadPeek();
+            if( !!self && ( atomicRead( &frame->thread_ ) == self )) {
+                frame->detach();
+            }
+            frame->end_ = impl::getHighResTime();
+            atomicDecrement( &frame->pending_ );
+        }
+
+        void
+        startupProfileNoteAlloc( size_t size )
+        {
+            if( TOOLS_LIKELY( atomicRead( &profileState_ ) != profileOn )) {
+                return;
+            }
+            ProfileThread * thread = profileThreadPeek();
+            if( !thread ) {
+                return;
+            }
+            ++thread->allocs_;
+            thread->bytes_ += size;
+        }
+
+        void
+        startupProfileReset( bool on )
+        {
+            atomicSet( &profileState_, on ? profileOn : profileOff );
+            ProfileFrame * frames = atomicExchange( &profileFrames_, static_cast< ProfileFrame * >( nullptr ));
+            while( !!frames ) {
+                ProfileFrame * next = frames->next_;
+                delete frames;
+                frames = next;
+            }
+        }
+    };  // impl namespace
+
+    std::vector< StartupProfileEntry >
+    startupProfileEntries( StartupProfileSort sort )
+    {
+        std::vector< ProfileFrame * > frames;
+        for( ProfileFrame * frame = atomicRead( &profileFrames_ ); !!frame; frame = frame->next_ ) {
+            if( atomicRead( &frame->pending_ ) == 0U ) {
+                frames.push_back( frame );
+            }
+        }
+        std::reverse( frames.begin(), frames.end() );
+        std::unordered_map< ProfileFrame *, size_t > indexOf;
+        std::vector< StartupProfileEntry > entries( frames.size() );
+        for( size_t i = 0U; i != frames.size(); ++i ) {
+            ProfileFrame & frame = *frames[ i ];
+            StartupProfileEntry & entry = entries[ i ];
+            indexOf[ &frame ] = i;
+            entry.kind_ = frame.kind_;
+            entry.name_ = frame.name_;
+            entry.detail_ = frame.detail_;
+            entry.wall_ = frame.end_ - frame.begin_;
+            entry.self_ = entry.wall_;
+            entry.cpu_ = frame.cpu_;
+            entry.allocs_ = frame.allocs_;
+            entry.bytes_ = frame.bytes_;
+        }
+        for( size_t i = 0U; i != frames.size(); ++i ) {
+            auto parent = indexOf.find( frames[ i ]->parent_ );
+            entries[ i ].parent_ = ( parent == indexOf.end() ) ? SIZE_MAX : parent->second;
+            if( parent != indexOf.end() ) {
+                StartupProfileEntry & up = entries[ parent->second ];
+                up.needs_.push_back( i );
+                // Asynchronous work may overlap its parent's, so self time only goes down to 0.
+                up.self_ -= std::min( up.self_, entries[ i ].wall_ );
+            }
+        }
+        // Order, largest first, then renumber the references to match.
+        std::vector< size_t > order( entries.size() );
+        for( size_t i = 0U; i != order.size(); ++i ) {
+            order[ i ] = i;
+        }
+        std::stable_sort( order.begin(), order.end(), [&]( size_t l, size_t r )->bool {
+            return profileSortKey( entries[ l ], sort ) > profileSortKey( entries[ r ], sort );
+        });
+        std::vector< size_t > rank( order.size() );
+        for( size_t i = 0U; i != order.size(); ++i ) {
+            rank[ order[ i ]] = i;
+        }
+        std::vector< StartupProfileEntry > ret;
+        ret.reserve( entries.size() );
+        for( auto i : order ) {
+            StartupProfileEntry & entry = entries[ i ];
+            if( entry.parent_ != SIZE_MAX ) {
+                entry.parent_ = rank[ entry.parent_ ];
+            }
+            for( auto && need : entry.needs_ ) {
+                need = rank[ need ];
+            }
+            ret.push_back( std::move( entry ));
+        }
+        return ret;
+    }
+
+    void
+    startupProfileReport( FILE * file, StartupProfileSort sort )
+    {
+        static char const * const sortNames[] = { "wall", "self", "cpu", "allocs", "bytes" };
+        std::vector< StartupProfileEntry > entries( startupProfileEntries( sort ));
+        fprintf( file, "Startup profile, %u frames by %s:\n", static_cast< unsigned >( entries.size() ), sortNames[ sort ]);
+        fprintf( file, "%10s %10s %10s %9s %12s  frame\n", "wall ms", "self ms", "cpu ms", "allocs", "bytes" );
+        for( auto && entry : entries ) {
+            std::string line( profileLabel( entry ));
+            if( !entry.needs_.empty() ) {
+                line += "  needs:";
+                for( auto && need : entry.needs_ ) {
+                    line += ' ';
+                    line += profileLabel( entries[ need ]);
+                }
+            }
+            fprintf( file, "%10.3f %10.3f %10.3f %9llu %12llu  %s\n",
+                static_cast< double >( entry.wall_ ) / TOOLS_NANOSECONDS_PER_MILLISECOND,
+                static_cast< double >( entry.self_ ) / TOOLS_NANOSECONDS_PER_MILLISECOND,
+                static_cast< double >( entry.cpu_ ) / TOOLS_NANOSECONDS_PER_MILLISECOND,
+                static_cast< unsigned long long >( entry.allocs_ ), static_cast< unsigned long long >( entry.bytes_ ),
+                line.c_str() );
+        }
+    }
+
+    void
+    startupProfileFinish( void )
+    {
+        if( !impl::startupProfileRecording() ) {
+            return;
+        }
+        atomicSet( &profileState_, profileOff );
+        startupProfileReport( stderr, profileSortConfigured() );
+        char const * path = getenv( "TOOLS_STARTUP_PROFILE" );
+        if( !path || !*path || ( strcmp( path, "1" ) == 0 )) {
+            return;
+        }
+        FILE * file = fopen( path, "w" );
+        if( !file ) {
+            // TODO: convert this to logging
+            fprintf( stderr, "Startup profile: could not open %s\n", path );
+            return;
+        }
+        profileWriteFolded( file, startupProfileEntries( StartupProfileSortWall ));
+        fclose( file );
+    }
+};  // tools namespace
+
+#include <tools/UnitTest.h>
+#if TOOLS_UNIT_TEST
+#include <tools/InterfaceTools.h>
+
+namespace {
+    size_t startupProfileFind( std::vector< StartupProfileEntry > const & entries, char const * name )
+    {
+        for( size_t i = 0U; i != entries.size(); ++i ) {
+            if( entries[ i ].name_ == name ) {
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    // Finishes a frame from another thread, as an asynchronous start does.
+    struct StartupProfileLeaver
+        : Notifiable< StartupProfileLeaver >
+    {
+        StartupProfileLeaver( void * site ) : site_( site ) {}
+
+        void leave( void ) {
+            impl::startupProfileLeave( site_ );
+        }
+
+        void * site_;
+    };
+};  // anonymous namespace
+
+////////
+// Tests
+////////
+
+TOOLS_TEST_CASE("StartupProfile.frames", [](Test &)
+{
+    // Should the whole run be profiled, leave its frames be.
+    bool wasRecording = impl::startupProfileRecording();
+    if( !wasRecording ) {
+        impl::startupProfileReset( true );
+    }
+    {
+        StartupProfileScope outer( "test", StringId( "StartupProfileOuter" ));
+        {
+            StartupProfileScope inner( "test", StringId( "StartupProfileInner" ), StringId( "detail" ));
+            for( unsigned i = 0U; i != 16U; ++i ) {
+                impl::startupProfileNoteAlloc( 256U );
+            }
+        }
+        // Launched here, finished later (as an asynchronous start would be).
+        void * async = impl::startupProfileEnter( "test", StringId( "StartupProfileAsync" ), StringIdNull() );
+        impl::startupProfileDetach( async );
+        impl::startupProfileNoteAlloc( 64U );
+        impl::startupProfileLeave( async );
+    }
+    std::vector< StartupProfileEntry > entries( startupProfileEntries( StartupProfileSortWall ));
+    if( !wasRecording ) {
+        impl::startupProfileReset( false );
+    }
+    size_t outer = startupProfileFind( entries, "StartupProfileOuter" );
+    size_t inner = startupProfileFind( entries, "StartupProfileInner" );
+    size_t async = startupProfileFind( entries, "StartupProfileAsync" );
+    TOOLS_ASSERTR( ( outer != SIZE_MAX ) && ( inner != SIZE_MAX ) && ( async != SIZE_MAX ));
+    TOOLS_ASSERTR( entries[ inner ].parent_ == outer );
+    TOOLS_ASSERTR( entries[ async ].parent_ == outer );
+    TOOLS_ASSERTR( entries[ outer ].needs_.size() == 2U );
+    TOOLS_ASSERTR( entries[ inner ].detail_ == "detail" );
+    // Allocations count toward every frame attached when they happen.
+    TOOLS_ASSERTR( entries[ inner ].allocs_ >= 16U );
+    TOOLS_ASSERTR( entries[ inner ].bytes_ >= 16U * 256U );
+    TOOLS_ASSERTR( entries[ outer ].allocs_ >= entries[ inner ].allocs_ + 1U );
+    TOOLS_ASSERTR( entries[ async ].allocs_ < 16U );
+    TOOLS_ASSERTR( entries[ outer ].wall_ >= entries[ inner ].wall_ );
+    TOOLS_ASSERTR( entries[ outer ].self_ <= entries[ outer ].wall_ - entries[ inner ].wall_ );
+    for( size_t i = 1U; i < entries.size(); ++i ) {
+        TOOLS_ASSERTR( entries[ i - 1U ].wall_ >= entries[ i ].wall_ );
+    }
+});
+
+TOOLS_TEST_CASE("StartupProfile.async", [](Test & test)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    bool wasRecording = impl::startupProfileRecording();
+    if( !wasRecording ) {
+        impl::startupProfileReset( true );
+    }
+    // Left elsewhere before the launcher detaches: not done until it does.
+    StartupProfileLeaver early( impl::startupProfileEnter( "test", StringId( "StartupProfileEarly" ), StringIdNull() ));
+    threading->fork( "startupProfileLeaver", early.toThunk< &StartupProfileLeaver::leave >() )->waitSync();
+    TOOLS_ASSERTR( startupProfileFind( startupProfileEntries( StartupProfileSortWall ), "StartupProfileEarly" ) == SIZE_MAX );
+    impl::startupProfileNoteAlloc( 64U );
+    impl::startupProfileDetach( early.site_ );
+    // Detached first, then left elsewhere.
+    StartupProfileLeaver late( impl::startupProfileEnter( "test", StringId( "StartupProfileLate" ), StringIdNull() ));
+    impl::startupProfileDetach( late.site_ );
+    TOOLS_ASSERTR( startupProfileFind( startupProfileEntries( StartupProfileSortWall ), "StartupProfileLate" ) == SIZE_MAX );
+    threading->fork( "startupProfileLeaver", late.toThunk< &StartupProfileLeaver::leave >() )->waitSync();
+    std::vector< StartupProfileEntry > entries( startupProfileEntries( StartupProfileSortWall ));
+    if( !wasRecording ) {
+        impl::startupProfileReset( false );
+    }
+    size_t earlyAt = startupProfileFind( entries, "StartupProfileEarly" );
+    size_t lateAt = startupProfileFind( entries, "StartupProfileLate" );
+    TOOLS_ASSERTR( ( earlyAt != SIZE_MAX ) && ( lateAt != SIZE_MAX ));
+    // Counted up to the detach, wherever the frame was left.
+    TOOLS_ASSERTR( entries[ earlyAt ].allocs_ >= 1U );
+});
+
+#endif /* TOOLS_UNIT_TEST */
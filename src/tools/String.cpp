@@ -4,7 +4,7 @@
 // #include <tools/Buffer.h>
 #include <tools/Concurrency.h>
 // #include <tools/Helpers.h>
-// #include <tools/Memory.h>
+#include <tools/Memory.h>
 #include <tools/String.h>
 #include <tools/Tools.h>
 #include <tools/WeakPointer.h>
@@ -15,6 +15,7 @@
 #include <wctype.h>
 
 #include <unordered_set>
+#include <vector>
 
 using namespace tools;
 using boost::numeric_cast;
@@ -23,6 +24,7 @@ namespace {
     static uint64 volatile totalStringIds_ = 0ULL;
     static uint64 volatile totalStaticStringIds_ = 0ULL;
     static uint64 volatile totalStringBytes_ = 0ULL;
+    static uint64 volatile totalStringBytesSaved_ = 0ULL;
 };  // anonymous namespace
 
 namespace tools {
@@ -30,33 +32,204 @@ namespace tools {
         void stringIdGetMemoryTracking(
             uint64 & retSidCount,
             uint64 & retStaticSidCount,
-            uint64 & retSidBytes )
+            uint64 & retSidBytes,
+            uint64 & retSidBytesSaved )
         {
             retSidCount = atomicRead( &totalStringIds_ );
             retStaticSidCount = atomicRead( &totalStaticStringIds_ );
             retSidBytes = atomicRead( &totalStringBytes_ );
+            retSidBytesSaved = atomicRead( &totalStringBytesSaved_ );
         }
+
+        void const * platformMapFile( char const *, size_t * );
+        void platformUnmapFile( void const *, size_t );
+        bool platformWriteFile( char const *, void const *, size_t );
     };  // impl namespace
 };  // tools namespace
 
 namespace {
     TOOLS_FORCE_INLINE size_t stringHash( char const * str, uint32 size )
     {
-        size_t ret = 0;
-        char const * end = str + size;
-        for( ; str != end; ++str ) {
-            ret = ret ^ ( ( ret << 10 ) + ( ret >> 3 ) + *str );
-        }
-        return ret;
+        return tools::impl::stringIdHash( str, size );
     }
 
-    TOOLS_FORCE_INLINE char const * copyStringContents( char const * inStr, uint32 copyChars )
+    // Storage for string records. Records (with their characters inline, for non-static strings) are carved
+    // from large append-only chunks. Reclaimed blocks go to a free list per 16 byte size class, and are never
+    // returned to the Platform. Blocks too large for any class are mapped directly.
+    struct StringArena
+        : AllocStatic<Platform>
     {
-        char * ret = new char[ copyChars + 1 ];
-        memcpy( ret, inStr, copyChars * sizeof( char ) );
-        ret[ copyChars ] = '\0';
-        return ret;
+        enum : size_t {
+            granularity = 16U,
+            classCount = 32U,
+            maxClassBytes = granularity * classCount,
+            chunkBytes = 64U * 1024U,
+            // The old layout held non-static characters in a separate allocation. This is a conservative
+            // estimate of the header and alignment that allocation cost.
+            separateOverhead = 16U,
+        };
+
+        // Precedes each block, keeping the record 8 byte aligned.
+        struct Prefix
+        {
+            uint32 bytes_;  // Of the whole block, which selects the size class
+            uint32 saved_;
+        };
+
+        struct FreeBlock
+        {
+            FreeBlock * next_;
+        };
+
+        // A size class's free list. Blocks are never handed back to the Platform, so a pop may read the next_
+        // of a block that another thread has just taken. The tag, bumped on each pop, fails the CAS then, and
+        // when the block has been pushed back on top meanwhile (ABA).
+        struct FreeHead
+        {
+            FreeBlock * first_;
+            uintptr_t tag_;
+        };
+
+        // The unused part of the current chunk.
+        struct Carve
+        {
+            uint8 * next_;
+            uint8 * end_;
+        };
+
+        // The free lists and carve_ start out zeroed.
+        StringArena(void)
+            : chunks_(0U)
+        {
+        }
+
+        static TOOLS_FORCE_INLINE size_t roundUp(size_t bytes)
+        {
+            return (bytes + granularity - 1U) & ~static_cast<size_t>(granularity - 1U);
+        }
+
+        // Map a record of recordBytes, followed by inlineBytes of characters.
+        void * map(size_t recordBytes, size_t inlineBytes)
+        {
+            size_t total = roundUp(sizeof(Prefix) + recordBytes + inlineBytes);
+            Prefix * prefix;
+            if (total > maxClassBytes) {
+                prefix = static_cast<Prefix *>(tools::impl::affinityInstance<Platform>().map(total));
+            } else {
+                size_t cls = (total / granularity) - 1U;
+                FreeBlock * block = nullptr;
+                atomicTryUpdate(&free_[cls], [&](FreeHead & head)->bool {
+                    block = head.first_;
+                    if (!block) {
+                        return false;
+                    }
+                    head.first_ = block->next_;
+                    ++head.tag_;
+                    return true;
+                });
+                prefix = !!block ? reinterpret_cast<Prefix *>(block) : carve(total);
+            }
+            prefix->bytes_ = static_cast<uint32>(total);
+            // Savings are relative to a record and a separate character allocation.
+            size_t separate = roundUp(recordBytes) + ((inlineBytes != 0U) ? roundUp(inlineBytes + separateOverhead) : 0U);
+            prefix->saved_ = static_cast<uint32>((separate > total) ? (separate - total) : 0U);
+            atomicIncrement(&totalStringIds_);
+            atomicAdd(&totalStringBytes_, total);
+            atomicAdd(&totalStringBytesSaved_, prefix->saved_);
+            return prefix + 1;
+        }
+
+        // Take a block from the current chunk, starting another once it runs out.
+        Prefix * carve(size_t total)
+        {
+            uint8 * chunk = nullptr;
+            uint8 * ret = nullptr;
+            for (;;) {
+                atomicTryUpdate(&carve_, [&](Carve & c)->bool {
+                    if (static_cast<size_t>(c.end_ - c.next_) >= total) {
+                        ret = c.next_;
+                        c.next_ += total;
+                        return true;
+                    }
+                    ret = nullptr;
+                    if (!chunk) {
+                        return false;
+                    }
+                    // The remainder of the old chunk (less than maxClassBytes) is abandoned.
+                    ret = chunk;
+                    c.next_ = chunk + total;
+                    c.end_ = chunk + chunkBytes;
+                    return true;
+                });
+                if (!!ret) {
+                    break;
+                }
+                // Mapped with nothing held, racing threads may each map one.
+                chunk = static_cast<uint8 *>(tools::impl::affinityInstance<Platform>().map(chunkBytes));
+            }
+            if (ret == chunk) {
+                atomicIncrement(&chunks_);
+            } else if (!!chunk) {
+                // Another thread's chunk went in first.
+                tools::impl::affinityRef<Platform>().unmap(chunk);
+            }
+            return reinterpret_cast<Prefix *>(ret);
+        }
+
+        void unmap(void * site)
+        {
+            Prefix * prefix = static_cast<Prefix *>(site) - 1;
+            size_t total = prefix->bytes_;
+            atomicDecrement(&totalStringIds_);
+            atomicSubtract(&totalStringBytes_, total);
+            atomicSubtract(&totalStringBytesSaved_, prefix->saved_);
+            if (total > maxClassBytes) {
+                tools::impl::affinityRef<Platform>().unmap(prefix);
+                return;
+            }
+            size_t cls = (total / granularity) - 1U;
+            FreeBlock * block = reinterpret_cast<FreeBlock *>(prefix);
+            atomicUpdate(&free_[cls], [&](FreeHead head)->FreeHead {
+                block->next_ = head.first_;
+                head.first_ = block;
+                return head;
+            });
+        }
+
+        AtomicAny<FreeHead, true> free_[classCount];
+        AtomicAny<Carve, true> carve_;
+        unsigned volatile chunks_;
+    };
+
+    static StringArena & stringArena(void)
+    {
+        // Never destroyed, static StringIds may outlive any ordering we could impose here.
+        static StringArena * arena = new StringArena();
+        return *arena;
     }
+
+    // Allocation policy for records. The tail carries inline characters.
+    struct StringArenaAlloc
+    {
+        void * operator new(size_t size, size_t tailBytes)
+        {
+            return stringArena().map(size, tailBytes);
+        }
+        void * operator new(size_t size)
+        {
+            return stringArena().map(size, 0U);
+        }
+        void operator delete(void * site)
+        {
+            stringArena().unmap(site);
+        }
+        // Only used if construction throws
+        void operator delete(void * site, size_t)
+        {
+            stringArena().unmap(site);
+        }
+    };
+
 	struct NewStringIdData
 		: tools::impl::StringIdData
         , Referenced<NewStringIdData>
@@ -83,26 +256,57 @@ namespace {
 	};
 
 	struct NewRealStringId
-		: StandardReferenced< NewRealStringId, NewStringIdData, AllocStatic< Platform >>
+		: StandardReferenced< NewRealStringId, NewStringIdData, StringArenaAlloc >
 	{
+        // Tag for records which copy their characters inline, immediately after the record. These must be
+        // allocated with new(length + 1) to reserve the space.
+        struct InlineCopy {};
+
         NewRealStringId(void) = default;
         TOOLS_FORCE_INLINE NewRealStringId(char const * str, size_t hsh, size_t len, bool stat, uint64 gen)
         {
             populate(str, hsh, len, stat, gen);
+            countStatic(1);
         }
         TOOLS_FORCE_INLINE NewRealStringId(tools::impl::StringIdData const & data, bool stat, uint64 gen)
         {
             populate(data, stat, gen);
+            countStatic(1);
+        }
+        TOOLS_FORCE_INLINE NewRealStringId(tools::impl::StringIdData const & data, InlineCopy)
+        {
+            char * chars = reinterpret_cast<char *>(this + 1);
+            memcpy(chars, data.string_, data.length_);
+            chars[data.length_] = '\0';
+            populate(chars, data.hash_, data.length_, false, 0);
+        }
+        ~NewRealStringId(void)
+        {
+            countStatic(-1);
+        }
+
+        TOOLS_FORCE_INLINE void countStatic(sint64 delta)
+        {
+            if (isStatic_) {
+                atomicAdd(&totalStaticStringIds_, static_cast<uint64>(delta));
+            }
+        }
+
+        // Racy snapshot of the reference count. Only meaningful to a caller which itself holds a
+        // reference, and even then only as a hint.
+        TOOLS_FORCE_INLINE unsigned refCount(void) const
+        {
+            return atomicRead(&refs_);
         }
     };
 
 	struct StringPhantom
 		: StandardPhantomSlistElement< StringPhantom, StandardPhantom< StringPhantom, AllocStatic< Platform >>>
 	{
-        StringPhantom(AutoDispose<NewRealStringId::Reference> & r, uint64 c = 1U) : data_(r->ref()), count_(c) {}
+        // The table holds exactly one reference to each interned record. StringIds hold the rest.
+        StringPhantom(AutoDispose<NewRealStringId::Reference> const & r) : data_(r->ref()) {}
 
 		AutoDispose<NewRealStringId::Reference> data_;
-        uint64 count_;
 	};
 
 	TOOLS_FORCE_INLINE tools::impl::StringIdData const &
@@ -116,45 +320,236 @@ namespace {
 		return static_cast<uint32>(nsid.hash_ & 0xFFFFFFFF);
 	}
 
-	typedef PhantomHashMap< StringPhantom, tools::impl::StringIdData, PhantomUniversal > NewStringTable;
+    // Epoch cloaks, as every intern, lookup and unintern takes one: they only touch a per-thread record, and a
+    // worker stuck in a long task does not hold up reclaiming the table's elements.
+	typedef PhantomHashMap< StringPhantom, tools::impl::StringIdData, PhantomEpoch > NewStringTable;
 
     struct TablePair
-        : AllocStatic< Platform >
     {
         NewStringTable * table_;
         uint64 generation_;
     };
 
+    static NewStringTable * stringTable(void) throw()
+    {
+        // Leaked, like stringArena().
+        static NewStringTable * table = new NewStringTable();
+        return table;
+    }
+
+    static uint64 volatile stringTableGeneration_ = 0ULL;
+
+    // Table access for the interning paths. Each call returns a new generation, so this is not for use on
+    // paths which want to scale (copy, destroy).
 	static TOOLS_FORCE_INLINE TablePair getNewStringTable(void) throw()
 	{
-        static AtomicAny<TablePair, true> table;
-        // First make sure the table exists.
-        atomicTryUpdate(&table, [](TablePair & element)->bool {
-            bool result = !element.table_;
-            if (result) {
-                element.table_ = new NewStringTable();
-            }
-            return result;
-        });
-        // Next increment the generation
         TablePair ret;
-        atomicUpdate(&table, [&ret](TablePair element)->TablePair {
-            ++element.generation_;
-            ret = element;
-            return element;
-        });
+        ret.table_ = stringTable();
+        ret.generation_ = atomicAdd(&stringTableGeneration_, 1U) + 1U;
         return ret;
 	}
 
-    TOOLS_FORCE_INLINE AutoDispose<NewRealStringId::Reference> createRecord(
-        char const * str,
-        uint32 len,
-        uint32 alloc,
-        bool isStatic)
+    static size_t volatile stringTableSweepNext_ = 0U;
+
+    // Remove every interned record for which the table holds the only reference. Copies and destroys only
+    // touch the record reference count, and only opportunistically unintern. Races in that path (two last
+    // holders releasing at once, or a record replaced by a static promotion) can leave a record with no
+    // outstanding StringIds in the table. This sweeps those up, the given number of buckets at a time,
+    // carrying on from where the last sweep stopped.
+    static size_t stringTableSweep(size_t buckets) throw()
+    {
+        NewStringTable * table = stringTable();
+        // Racing sweeps take distinct buckets.
+        size_t first = atomicAdd(&stringTableSweepNext_, buckets);
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+        size_t ret = 0U;
+        for (size_t i = 0U; i != buckets; ++i) {
+            // More than this in one bucket is left for the next pass.
+            StringPhantom * unused[16];
+            size_t count = 0U;
+            table->forEachInBucket(first + i, [&](StringPhantom const & element)->bool {
+                if (static_cast<NewRealStringId const *>(element.data_.get())->refCount() == 1U) {
+                    unused[count++] = const_cast<StringPhantom *>(&element);
+                }
+                return (count != 16U);
+            });
+            for (size_t j = 0U; j != count; ++j) {
+                StringPhantom * element = unused[j];
+                // The element (and thus its record) is kept alive by our cloak.
+                table->update(*element->data_, [&](StringPhantom *& old)->void {
+                    if ((old == element) && (static_cast<NewRealStringId *>(old->data_.get())->refCount() == 1U)) {
+                        old = nullptr;
+                        ++ret;
+                    }
+                });
+            }
+        }
+        return ret;
+    }
+
+    // Sweep a slice of the table once per this many newly interned strings. The whole table is covered once
+    // per 4096 interns, as a few microseconds of work each time rather than a full walk.
+    static const uint64 stringTableSweepPeriod = 64U;
+    static const size_t stringTableSweepBuckets = NewStringTable::bucketCount / (4096U / stringTableSweepPeriod);
+
+    // Intern a static record over the key's characters, for a caller that has already looked for one.
+    tools::impl::StringIdData * insertStaticRecord(tools::impl::StringIdData const & key)
+    {
+        AutoDispose<NewRealStringId::Reference> sid(new NewRealStringId(key, true, 0));
+        AutoDispose<NewRealStringId::Reference> found;
+        {
+            auto table = getNewStringTable();
+            sid->generation_ = table.generation_;
+            AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+            table.table_->update(*sid, [&](StringPhantom *& old)->void {
+                // Static records replace non-static ones. Holders of the replaced record keep it alive.
+                if (!old || !old->data_->isStatic_) {
+                    old = new StringPhantom(sid);
+                }
+                found = old->data_->ref();
+            });
+        }
+        TOOLS_ASSERT(!!found);
+        return found.release();
+    }
+
+    tools::impl::StringIdData * internStaticRecord(tools::impl::StringIdData const & key)
+    {
+        // Already interned as static is the common case, and needs no allocation.
+        {
+            tools::impl::StringIdData * hit = nullptr;
+            AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+            stringTable()->find(key, [&](StringPhantom * element)->void {
+                if (!!element && element->data_->isStatic_) {
+                    hit = element->data_->ref().release();
+                }
+            });
+            if (!!hit) {
+                return hit;
+            }
+        }
+        return insertStaticRecord(key);
+    }
+
+    // A string table snapshot is a header, a displacement per bucket, an entry per slot and then the (nul
+    // terminated) characters. Each string is found with one probe: its hash picks a bucket, and that bucket's
+    // displacement picks a slot no other string in the snapshot uses (hash and displace). Entries hold
+    // offsets from the start of the file, so it can be mapped anywhere.
+    struct SnapshotHeader
+    {
+        enum : uint32 {
+            magicValue = 0x53444953U, // "SIDS"
+            versionValue = 1U,
+        };
+
+        uint32 magic_;
+        uint32 version_;
+        uint32 seed_;     // Snapshots are only valid for the hash they were written with
+        uint32 count_;
+        uint32 buckets_;
+        uint32 slots_;
+        uint64 bytes_;
+    };
+
+    struct SnapshotEntry
+    {
+        uint32 hash_;
+        uint32 length_;
+        uint64 offset_;   // 0 for an unused slot
+    };
+
+    struct SnapshotString
+    {
+        uint32 hash_;
+        uint32 length_;
+        char const * string_;
+    };
+
+    static TOOLS_FORCE_INLINE uint64 snapshotEntriesOffset(uint32 buckets)
+    {
+        return roundUpPow2(static_cast<uint64>(sizeof(SnapshotHeader) + (buckets * sizeof(uint32))), static_cast<uint64>(8U));
+    }
+
+    // Lay out a snapshot of the given strings. Strings with the same hash as an earlier one are left out, no
+    // displacement could separate them. They are simply interned dynamically.
+    static void snapshotBuild(std::vector<char> & image, std::vector<SnapshotString> strings)
+    {
+        std::sort(strings.begin(), strings.end(), [](SnapshotString const & l, SnapshotString const & r)->bool {
+            return l.hash_ < r.hash_;
+        });
+        strings.erase(std::unique(strings.begin(), strings.end(), [](SnapshotString const & l, SnapshotString const & r)->bool {
+            return l.hash_ == r.hash_;
+        }), strings.end());
+        uint32 count = numeric_cast<uint32>(strings.size());
+        std::vector<uint32> hashes(count);
+        for (uint32 i = 0U; i != count; ++i) {
+            hashes[i] = strings[i].hash_;
+        }
+        uint32 buckets;
+        uint32 slots;
+        std::vector<uint32> displacements;
+        std::vector<uint32> slotOf;
+        tools::impl::perfectHashBuild(hashes.data(), hashes.size(), buckets, slots, displacements, slotOf);
+        uint64 entriesOffset = snapshotEntriesOffset(buckets);
+        uint64 bytes = entriesOffset + (slots * sizeof(SnapshotEntry));
+        for (auto && str : strings) {
+            bytes += str.length_ + 1U;
+        }
+        image.assign(numeric_cast<size_t>(bytes), '\0');
+        SnapshotHeader * header = reinterpret_cast<SnapshotHeader *>(image.data());
+        header->magic_ = SnapshotHeader::magicValue;
+        header->version_ = SnapshotHeader::versionValue;
+        header->seed_ = tools::impl::stringIdHashSeed;
+        header->count_ = count;
+        header->buckets_ = buckets;
+        header->slots_ = slots;
+        header->bytes_ = bytes;
+        memcpy(header + 1, displacements.data(), buckets * sizeof(uint32));
+        SnapshotEntry * entries = reinterpret_cast<SnapshotEntry *>(image.data() + entriesOffset);
+        uint64 offset = entriesOffset + (slots * sizeof(SnapshotEntry));
+        for (uint32 i = 0U; i != count; ++i) {
+            SnapshotEntry & entry = entries[slotOf[i]];
+            entry.hash_ = strings[i].hash_;
+            entry.length_ = strings[i].length_;
+            entry.offset_ = offset;
+            memcpy(image.data() + offset, strings[i].string_, strings[i].length_);
+            offset += strings[i].length_ + 1U;
+        }
+        TOOLS_ASSERT(offset == bytes);
+    }
+
+    // Validate a mapped snapshot. Entries are bounds checked as they are used.
+    static SnapshotHeader const * snapshotCheck(void const * base, size_t size)
     {
-        size_t hsh = stringHash(str, alloc - 1);
-        return new NewRealStringId(str, hsh, len, isStatic, 0);
+        SnapshotHeader const * header = static_cast<SnapshotHeader const *>(base);
+        if ((size < sizeof(SnapshotHeader)) || (header->magic_ != SnapshotHeader::magicValue) || (header->version_ != SnapshotHeader::versionValue)
+            || (header->seed_ != tools::impl::stringIdHashSeed) || (header->bytes_ != size) || !header->buckets_ || !isPow2(header->buckets_)
+            || !header->slots_ || !isPow2(header->slots_)
+            || ((snapshotEntriesOffset(header->buckets_) + (static_cast<uint64>(header->slots_) * sizeof(SnapshotEntry))) > size)) {
+            return nullptr;
+        }
+        return header;
+    }
+
+    static char const * snapshotFind(SnapshotHeader const * header, tools::impl::StringIdData const & key)
+    {
+        uint32 hash = static_cast<uint32>(key.hash_);
+        uint32 const * displacements = reinterpret_cast<uint32 const *>(header + 1);
+        SnapshotEntry const * entries = reinterpret_cast<SnapshotEntry const *>(reinterpret_cast<char const *>(header) + snapshotEntriesOffset(header->buckets_));
+        SnapshotEntry const & entry = entries[tools::impl::perfectHashSlot(hash, displacements[hash & (header->buckets_ - 1U)], header->slots_)];
+        if (!entry.offset_ || (entry.hash_ != hash) || (entry.length_ != key.length_) || ((entry.offset_ + entry.length_) >= header->bytes_)) {
+            return nullptr;
+        }
+        char const * chars = reinterpret_cast<char const *>(header) + entry.offset_;
+        // Static records hand out the mapped characters as a C string.
+        if ((chars[entry.length_] != '\0') || (memcmp(chars, key.string_, key.length_) != 0)) {
+            return nullptr;
+        }
+        return chars;
     }
+
+    // The mapped snapshot, if any. It is never unmapped, as static records point into it.
+    static SnapshotHeader const * volatile stringSnapshot_ = nullptr;
 }; // anonymous namespace
 
 void
@@ -171,108 +566,105 @@ StringId::fillInStringId( char const * inStr, sint32 count ) throw()
         TOOLS_ASSERT( count > 0 );
         len = numeric_cast<uint32>(count);
     }
-    AutoDispose<NewRealStringId::Reference> sid(createRecord(copyStringContents(inStr, numeric_cast<uint32>(len)), numeric_cast<uint32>(len), numeric_cast<uint32>(len + 1), false));
+    // Probe with a key on the stack first, so that interning an existing string does not allocate.
+    tools::impl::StringIdData key(inStr, stringHash(inStr, numeric_cast<uint32>(len)), len);
+    {
+        impl::StringIdData * hit = nullptr;
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+        stringTable()->find(key, [&](StringPhantom * element)->void {
+            if (!!element) {
+                // Our cloak keeps the element, and thus the table's reference, alive while we take ours.
+                hit = element->data_->ref().release();
+            }
+        });
+        if (!!hit) {
+            data_ = hit;
+            return;
+        }
+    }
+    // Strings in a mapped snapshot become static records over the mapped characters, without copying them.
+    SnapshotHeader const * snapshot = atomicRead(&stringSnapshot_);
+    if (!!snapshot) {
+        char const * mapped = snapshotFind(snapshot, key);
+        if (!!mapped) {
+            // The probe above missed, so go straight to inserting.
+            data_ = insertStaticRecord(tools::impl::StringIdData(mapped, key.hash_, len));
+            return;
+        }
+    }
+    AutoDispose<NewRealStringId::Reference> sid(new(len + 1U) NewRealStringId(key, NewRealStringId::InlineCopy()));
     AutoDispose<NewRealStringId::Reference> found;
+    bool inserted = false;
+    auto table = getNewStringTable();
     {
-        auto table = getNewStringTable();
         sid->generation_ = table.generation_;
-        AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
         table.table_->update(*sid, [&](StringPhantom *& old)->void {
-            if (!old || ((sid->generation_ < old->data_->generation_) && !old->data_->isStatic_)) {
+            inserted = !old;
+            if (inserted) {
                 old = new StringPhantom(sid);
-            } else {
-                old = new StringPhantom(old->data_, old->count_ + 1);
             }
             found = old->data_->ref();
         });
     }
     TOOLS_ASSERT(!!found);
     data_ = found.release();
+    if (inserted && ((table.generation_ % stringTableSweepPeriod) == 0U)) {
+        stringTableSweep(stringTableSweepBuckets);
+    }
 }
 
-StringId::StringId( StringId const & c ) throw()
-{
-    if (!c.data_) {
-        data_ = nullptr;
-    } else {
-        AutoDispose<NewRealStringId::Reference> sid(static_cast<NewRealStringId *>(c.data_)->ref());
-        AutoDispose<NewRealStringId::Reference> found;
-        {
-            auto table = getNewStringTable();
-            AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
-            table.table_->update(*sid, [&](StringPhantom *& old)->void {
-                if (!old || ((sid->generation_ < old->data_->generation_) && !old->data_->isStatic_)) {
-                    old = new StringPhantom(sid);
-                } else {
-                    old = new StringPhantom(old->data_, old->count_ + 1);
+namespace {
+    TOOLS_FORCE_INLINE tools::impl::StringIdData * refStringRecord(tools::impl::StringIdData * data)
+    {
+        if (!data) {
+            return nullptr;
+        }
+        return static_cast<NewRealStringId *>(data)->ref().release();
+    }
+
+    TOOLS_FORCE_INLINE void derefStringRecord(tools::impl::StringIdData * data)
+    {
+        if (!data) {
+            return;
+        }
+        AutoDispose<NewRealStringId::Reference> sid(static_cast<NewRealStringId::Reference *>(data));
+        NewRealStringId * rec = static_cast<NewRealStringId *>(sid.get());
+        // If only we and the table remain, try to unintern before letting go. We still hold our reference
+        // so the record is safe to use as a key. Anyone who picks the record up from the table after this
+        // check still has a valid (if no longer interned) record. Misses are left for the sweep.
+        if (rec->refCount() == 2U) {
+            NewStringTable * table = stringTable();
+            AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+            table->update(*sid, [&](StringPhantom *& old)->void {
+                if (!!old && (old->data_.get() == sid.get()) && (rec->refCount() == 2U)) {
+                    old = nullptr;
                 }
-                found = old->data_->ref();
             });
         }
-        TOOLS_ASSERT(!!found);
-        data_ = found.release();
     }
+}; // anonymous namespace
+
+StringId::StringId( StringId const & c ) throw()
+    : data_(refStringRecord(c.data_))
+#ifdef STRINGID_DEBUGGING
+    , thisPointer_( this )
+#endif // STRINGID_DEBUGGING
+{
 }
 
 StringId::~StringId( void ) throw()
 {
-    AutoDispose<NewRealStringId::Reference> sid(static_cast<NewRealStringId::Reference *>(data_));
-    if (!!sid) {
-        auto table = getNewStringTable();
-        AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
-        table.table_->update(*sid, [&](StringPhantom *& old)->void {
-            if (!!old && (old->data_ == sid) && (old->data_->generation_ == sid->generation_)) {
-                if (old->count_ == 1U) {
-                    old = nullptr;
-                } else {
-                    old = new StringPhantom(old->data_, old->count_ - 1);
-                }
-            }
-        });
-    }
+    derefStringRecord(data_);
     data_ = nullptr;
 }
 
 StringId & StringId::copy( StringId const & c )
 {
-    // First release the current data
-    {
-        AutoDispose<NewRealStringId::Reference> sid(static_cast<NewRealStringId::Reference *>(data_));
-        if (!!sid) {
-            auto table = getNewStringTable();
-            AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
-            table.table_->update(*sid, [&](StringPhantom *& old)->void {
-                if (!!old && (old->data_ == sid) && (old->data_->generation_ == sid->generation_)) {
-                    if (old->count_ == 1U) {
-                        old = nullptr;
-                    } else {
-                        old = new StringPhantom(old->data_, old->count_ - 1);
-                    }
-                }
-            });
-        }
-    }
-    // Then reference the new one
-    if (!c.data_) {
-        data_ = nullptr;
-    } else {
-        AutoDispose<NewRealStringId::Reference> sid(static_cast<NewRealStringId *>(c.data_)->ref());
-        AutoDispose<NewRealStringId::Reference> found;
-        {
-            auto table = getNewStringTable();
-            AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
-            table.table_->update(*sid, [&](StringPhantom *& old)->void {
-                if (!old || ((sid->generation_ < old->data_->generation_) && !old->data_->isStatic_)) {
-                    old = new StringPhantom(sid);
-                } else {
-                    old = new StringPhantom(old->data_, old->count_ + 1);
-                }
-                found = old->data_->ref();
-            });
-        }
-        TOOLS_ASSERT(!!found);
-        data_ = found.release();
-    }
+    // Reference first, in case of self-assignment
+    impl::StringIdData * prev = data_;
+    data_ = refStringRecord(c.data_);
+    derefStringRecord(prev);
     return *this;
 }
 
@@ -284,14 +676,12 @@ StringId const & tools::StringIdNull( void )
 
 StringId const & tools::StringIdEmpty( void )
 {
-    static const StringId ret( "" );
-    return ret;
+    return TOOLS_SID( "" );
 }
 
 StringId const & tools::StringIdWhitespace( void )
 {
-    static const StringId ret( " \f\n\r\t" );
-    return ret;
+    return TOOLS_SID( " \f\n\r\t" );
 }
 
 bool tools::IsNullOrEmptyStringId( StringId const & str )
@@ -342,27 +732,154 @@ bool tools::IsNullOrEmptyStringId( StringId const & str )
 StringId tools::StaticStringId( char const * inStr ) throw()
 {
     size_t len = strlen( inStr );
-    AutoDispose<NewRealStringId::Reference> sid(createRecord(inStr, numeric_cast<uint32>(len), numeric_cast<uint32>(len + 1), true));
-    AutoDispose<NewRealStringId::Reference> found;
+    return StringId(internStaticRecord(impl::StringIdData(inStr, stringHash(inStr, numeric_cast<uint32>(len)), len)));
+}
+
+StringId tools::StaticStringId( impl::StringIdLiteral const & lit ) throw()
+{
+    return StringId(internStaticRecord(lit));
+}
+
+StringId tools::StringIdInterned( char const * str, size_t len ) throw()
+{
+    if (!str) {
+        return StringId();
+    }
+    impl::StringIdData key(str, stringHash(str, numeric_cast<uint32>(len)), len);
+    impl::StringIdData * hit = nullptr;
+    AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+    stringTable()->find(key, [&](StringPhantom * element)->void {
+        if (!!element) {
+            hit = element->data_->ref().release();
+        }
+    });
+    return StringId(hit);
+}
+
+bool tools::stringIdSnapshotWrite( char const * path ) throw()
+{
+    std::vector<char> image;
     {
-        auto table = getNewStringTable();
-        sid->generation_ = table.generation_;
-        AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
-        table.table_->update(*sid, [&](StringPhantom *& old)->void {
-            if (!old || (sid->generation_ < old->data_->generation_) || (!old->data_->isStatic_)) {
-                old = new StringPhantom(sid);
-            } else {
-                old = new StringPhantom(old->data_, old->count_ + 1);
+        std::vector<SnapshotString> strings;
+        // Our cloak keeps every record (and its characters) alive until the image is built.
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+        stringTable()->forEach([&](StringPhantom const & element)->bool {
+            tools::impl::StringIdData const & data = *element.data_;
+            if (data.length_ < 0xFFFFFFFFU) {
+                SnapshotString str = { static_cast<uint32>(data.hash_), static_cast<uint32>(data.length_), data.string_ };
+                strings.push_back(str);
             }
-            found = old->data_->ref();
+            return true;
         });
+        snapshotBuild(image, std::move(strings));
     }
-    TOOLS_ASSERT(!!found);
-    return StringId(found.release());
+    return impl::platformWriteFile(path, image.data(), image.size());
+}
+
+bool tools::stringIdSnapshotMap( char const * path ) throw()
+{
+    if (!!atomicRead(&stringSnapshot_)) {
+        return false;
+    }
+    size_t size = 0U;
+    void const * base = impl::platformMapFile(path, &size);
+    if (!base) {
+        return false;
+    }
+    SnapshotHeader const * header = snapshotCheck(base, size);
+    if (!header || !!atomicCas(&stringSnapshot_, static_cast<SnapshotHeader const *>(nullptr), header)) {
+        impl::platformUnmapFile(base, size);
+        return false;
+    }
+    return true;
 }
 
 #include <tools/UnitTest.h>
 #if TOOLS_UNIT_TEST
+#include <tools/Environment.h>
+#include <tools/Threading.h>
+#include <tools/Timing.h>
+
+#include <unordered_map>
+
+using namespace tools::literals;
+
+namespace {
+    // Each thread copies either the one shared StringId, so all of them count references on the same
+    // record, or a StringId of its own.
+    struct StringIdTestImpl
+        : Notifiable<StringIdTestImpl>
+    {
+        enum : unsigned {
+            copiesPerThread = 1000000U,
+            maxThreads = 16U,
+        };
+
+        StringIdTestImpl(bool distinct)
+            : distinct_(distinct)
+            , threadIds_(0U)
+            , shared_("StringIdTestImpl shared string")
+        {
+            char buf[64];
+            for (unsigned i = 0U; i != maxThreads; ++i) {
+                sprintf(buf, "StringIdTestImpl distinct string %u", i);
+                distinctIds_[i] = StringId(buf);
+            }
+        }
+
+        // Runs copySupport on this many threads at once, returning how long until all are done.
+        uint64 timed(Test &, unsigned);
+
+        // support methods
+        void copySupport(void);
+
+        bool distinct_;
+        unsigned volatile threadIds_;
+        StringId shared_;
+        StringId distinctIds_[maxThreads];
+    };
+
+    // Forwards to the Platform affinity, counting maps made from the installing thread.
+    struct CountingAffinity
+        : Affinity
+    {
+        CountingAffinity(Affinity & inner) : inner_(inner), owner_(0U), maps_(0U) {}
+
+        void install(void) {
+            owner_ = tools::impl::threadId();
+            atomicExchange(&maps_, 0U);
+            *tools::detail::StaticServiceCache<Affinity, Platform>::storage() = this;
+        }
+        void uninstall(void) {
+            *tools::detail::StaticServiceCache<Affinity, Platform>::storage() = &inner_;
+        }
+
+        // Affinity
+        Affinity & bind(void) { return *this; }
+        AutoDispose<> fork(Affinity ** parent, tools::impl::ResourceSample const & sample) { return inner_.fork(parent, sample); }
+        Pool & pool(size_t size, tools::impl::ResourceSample const & sample, size_t phase) {
+            count();
+            return inner_.pool(size, sample, phase);
+        }
+
+        // Heap
+        void * map(size_t size, tools::impl::ResourceSample const & sample, size_t phase) {
+            count();
+            return inner_.map(size, sample, phase);
+        }
+        void unmap(void * site) { inner_.unmap(site); }
+
+        void count(void) {
+            if (tools::impl::threadId() == owner_) {
+                atomicIncrement(&maps_);
+            }
+        }
+
+        Affinity & inner_;
+        uint64 owner_;
+        unsigned volatile maps_;
+    };
+}; // anonymous namespace
 
 TOOLS_TEST_CASE("StringId.raw", [](Test &)
 {
@@ -380,7 +897,7 @@ TOOLS_TEST_CASE("StringId.raw", [](Test &)
     {
         auto table = getNewStringTable();
         rid->generation_ = table.generation_;
-        AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
         table.table_->update(*rid, [&](StringPhantom *& old)->void {
             if (!old || ((rid->generation_ < old->data_->generation_) && !old->data_->isStatic_)) {
                 old = new StringPhantom(rid);
@@ -438,14 +955,11 @@ TOOLS_TEST_CASE("StringId.raw", [](Test &)
     {
         TOOLS_ASSERTR(!!rid);
         auto table = getNewStringTable();
-        AutoDispose<> proto(phantomTryBindPrototype<PhantomUniversal>());
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
         table.table_->update(*rid, [&](StringPhantom *& old)->void {
             if (!!old && (old->data_ == rid) && (old->data_->generation_ == rid->generation_)) {
-                if (old->count_ == 1U) {
-                    old = nullptr;
-                } else {
-                    TOOLS_ASSERTR(!"string record has too high reference count");
-                }
+                TOOLS_ASSERTR(static_cast<NewRealStringId *>(old->data_.get())->refCount() == 2U);
+                old = nullptr;
             }
         });
     }
@@ -688,6 +1202,332 @@ TOOLS_TEST_CASE("StringId.empty", [](Test &)
     TOOLS_ASSERTR( !IsNullOrEmptyStringId( sid6 ) );
 });
 
+TOOLS_TEST_CASE("StringId.move", [](Test &)
+{
+    static_assert(std::is_nothrow_move_constructible<StringId>::value, "StringId moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<StringId>::value, "StringId moves must not throw");
+    char const * str = "TestStringIdMove string";
+    StringId sid(str);
+    char const * interned = sid.c_str();
+    StringId sid2(std::move(sid));
+    TOOLS_ASSERTR(!sid);
+    TOOLS_ASSERTR(sid2.c_str() == interned);
+    StringId sid3;
+    sid3 = std::move(sid2);
+    TOOLS_ASSERTR(!sid2);
+    TOOLS_ASSERTR(sid3.c_str() == interned);
+    // Moving over a value releases it rather than handing it back
+    StringId other("TestStringIdMove other");
+    StringId sid4(sid3);
+    other = std::move(sid4);
+    TOOLS_ASSERTR(!sid4);
+    TOOLS_ASSERTR(other.c_str() == interned);
+    std::vector<StringId> vec;
+    for (unsigned i = 0U; i != 64U; ++i) {
+        vec.push_back(sid3);
+    }
+    for (auto && elem : vec) {
+        TOOLS_ASSERTR(elem.c_str() == interned);
+    }
+});
+
+TOOLS_TEST_CASE("StringId.lookup.allocations", [](Test &)
+{
+    char const * str = "TestStringIdLookupAllocations string";
+    std::string str2(str);
+    char const * str3 = "TestStringIdLookupAllocations stringblahblah";
+    StringId sid(str);
+    StringId sid2(StaticStringId("TestStringIdLookupAllocations static"));
+    // Never destroyed, Heap::alloc records the heap it was called on.
+    static CountingAffinity counting(tools::impl::affinityInstance<Platform>());
+    unsigned hitMaps, missMaps;
+    counting.install();
+    {
+        StringId hit(str);
+        StringId hit2(str2);
+        StringId hit3(str3, numeric_cast<sint32>(strlen(str)));
+        StringId hit4("TestStringIdLookupAllocations static");
+        StringId copied(hit);
+        StringId moved(std::move(copied));
+        copied = hit4;
+        TOOLS_ASSERTR(hit.c_str() == sid.c_str());
+        TOOLS_ASSERTR(hit2.c_str() == sid.c_str());
+        TOOLS_ASSERTR(hit3.c_str() == sid.c_str());
+        TOOLS_ASSERTR(hit4.c_str() == sid2.c_str());
+        TOOLS_ASSERTR(moved.c_str() == sid.c_str());
+        hitMaps = atomicRead(&counting.maps_);
+        StringId miss("TestStringIdLookupAllocations missing string");
+        missMaps = atomicRead(&counting.maps_);
+    }
+    counting.uninstall();
+    TOOLS_ASSERTR(hitMaps == 0U);
+    TOOLS_ASSERTR(missMaps > hitMaps);
+});
+
+TOOLS_TEST_CASE("StringId.literal", [](Test &)
+{
+    static constexpr tools::impl::StringIdLiteral lit = "TestStringIdLiteral string"_sid;
+    static_assert(lit.length_ == 26U, "literal length is computed at compile time");
+    static_assert(("TestStringIdLiteral string"_sid).hash_ == lit.hash_, "literal hash is computed at compile time");
+    // Compile time hashes match runtime ones, across lanes, words and tails
+    static constexpr tools::impl::StringIdLiteral lits[] = {
+        ""_sid, "a"_sid, "abcdefg"_sid, "abcdefgh"_sid, "abcdefghijklmnopqrstuvw"_sid, "abcdefghijklmnopqrstuvwx"_sid,
+        "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"_sid,
+    };
+    for (auto && elem : lits) {
+        TOOLS_ASSERTR(elem.hash_ == stringHash(elem.string_, numeric_cast<uint32>(elem.length_)));
+        TOOLS_ASSERTR(elem.hash_ == StringId(std::string(elem.string_, elem.length_)).hash());
+    }
+    // Comparison against runtime StringIds, without interning the literal
+    StringId sid("TestStringIdLiteral string");
+    StringId sid2("TestStringIdLiteral strinG");
+    TOOLS_ASSERTR(sid == lit);
+    TOOLS_ASSERTR(lit == sid);
+    TOOLS_ASSERTR(sid2 != lit);
+    TOOLS_ASSERTR(StringId() != lit);
+    // Interning promotes to a static record pointing at the literal
+    StringId sid3(lit);
+    TOOLS_ASSERTR(sid3.c_str() == lit.string_);
+    TOOLS_ASSERTR(sid3 == sid);
+    TOOLS_ASSERTR(sid3 == lit);
+    // TOOLS_SID interns once per site
+    StringId const * site = nullptr;
+    for (unsigned i = 0U; i != 4U; ++i) {
+        StringId const & ref = TOOLS_SID("TestStringIdLiteral string");
+        TOOLS_ASSERTR(!site || (site == &ref));
+        site = &ref;
+        TOOLS_ASSERTR(ref == sid);
+        TOOLS_ASSERTR(ref.c_str() == sid3.c_str());
+    }
+    TOOLS_ASSERTR(TOOLS_SID("") == StringIdEmpty());
+    TOOLS_ASSERTR(IsNullOrEmptyStringId(StringId("")));
+});
+
+TOOLS_TEST_CASE("StringId.fastLess", [](Test &)
+{
+    std::vector<StringId> sids;
+    sids.push_back(StringId());
+    for (unsigned i = 0U; i != 64U; ++i) {
+        char buf[32];
+        sprintf(buf, "TestStringIdFastLess %u", i);
+        sids.push_back(StringId(buf));
+        sids.push_back(StringId(buf + 1));
+    }
+    std::sort(sids.begin(), sids.end(), StringIdFastLess());
+    TOOLS_ASSERTR(!sids.front());
+    StringIdFastLess less;
+    for (size_t i = 1U; i != sids.size(); ++i) {
+        // Strict, total and consistent with equality
+        TOOLS_ASSERTR(!less(sids[i], sids[i - 1U]));
+        TOOLS_ASSERTR(less(sids[i - 1U], sids[i]));
+        TOOLS_ASSERTR(!less(sids[i], sids[i]));
+        TOOLS_ASSERTR(!!sids[i]);
+        TOOLS_ASSERTR((sids[i - 1U].hash() < sids[i].hash()) || ((sids[i - 1U].hash() == sids[i].hash()) && (sids[i - 1U].length() <= sids[i].length())));
+    }
+    // Literals order alongside the StringIds they name
+    static constexpr tools::impl::StringIdLiteral lit = "TestStringIdFastLess 7"_sid;
+    StringId sid("TestStringIdFastLess 7");
+    TOOLS_ASSERTR(!less(sid, lit) && !less(lit, sid));
+    TOOLS_ASSERTR(less(StringId(), lit));
+});
+
+TOOLS_TEST_CASE("StringId.transparent", [](Test &)
+{
+    StringIdHash hash;
+    StringIdEqual equal;
+    StringId sid("TestStringIdTransparent key");
+    std::string str("TestStringIdTransparent key");
+    static constexpr tools::impl::StringIdLiteral lit = "TestStringIdTransparent key"_sid;
+    // Every key type hashes as the StringId would
+    TOOLS_ASSERTR(hash(sid) == hash("TestStringIdTransparent key"));
+    TOOLS_ASSERTR(hash(sid) == hash(str));
+    TOOLS_ASSERTR(hash(sid) == hash(lit));
+    TOOLS_ASSERTR(hash(StringId()) == hash(static_cast<char const *>(nullptr)));
+    TOOLS_ASSERTR(equal(sid, "TestStringIdTransparent key") && equal(str, sid) && equal(lit, sid));
+    TOOLS_ASSERTR(!equal(sid, "TestStringIdTransparent kez"));
+#ifdef TOOLS_HAS_STRING_VIEW
+    std::string_view view(str);
+    TOOLS_ASSERTR(hash(sid) == hash(view));
+    TOOLS_ASSERTR(equal(sid, view) && equal(view, sid));
+    TOOLS_ASSERTR(!equal(sid, view.substr(1)));
+#endif // TOOLS_HAS_STRING_VIEW
+    // Probing does not intern
+    for (unsigned i = 0U; i != 16U; ++i) {
+        TOOLS_ASSERTR(!StringIdInterned("TestStringIdTransparent absent"));
+    }
+    StringId found(StringIdInterned(str));
+    TOOLS_ASSERTR(found.c_str() == sid.c_str());
+    TOOLS_ASSERTR(!StringIdInterned(static_cast<char const *>(nullptr)));
+    // Lookup in a StringId keyed map
+    std::unordered_map<StringId, unsigned, StringIdHash, StringIdEqual> map;
+    map[sid] = 1U;
+    map[StringId("TestStringIdTransparent other")] = 2U;
+    auto iter = stringIdFind(map, "TestStringIdTransparent key");
+    TOOLS_ASSERTR((iter != map.end()) && (iter->second == 1U));
+    iter = stringIdFind(map, std::string("TestStringIdTransparent other"));
+    TOOLS_ASSERTR((iter != map.end()) && (iter->second == 2U));
+    TOOLS_ASSERTR(stringIdFind(map, "TestStringIdTransparent absent") == map.end());
+    TOOLS_ASSERTR(!StringIdInterned("TestStringIdTransparent absent"));
+});
+
+TOOLS_TEST_CASE("StringId.snapshot", [](Test &)
+{
+    std::vector<std::string> storage;
+    for (unsigned i = 0U; i != 1000U; ++i) {
+        char buf[48];
+        sprintf(buf, "TestStringIdSnapshot string %u", i);
+        storage.push_back(buf);
+    }
+    storage.push_back(std::string());
+    std::vector<SnapshotString> strings;
+    for (auto && str : storage) {
+        SnapshotString entry = { static_cast<uint32>(stringHash(str.data(), numeric_cast<uint32>(str.size()))), numeric_cast<uint32>(str.size()), str.data() };
+        strings.push_back(entry);
+    }
+    // A duplicate hash (here, a duplicate string) is left out rather than breaking the build
+    strings.push_back(strings.front());
+    std::vector<char> image;
+    snapshotBuild(image, strings);
+    SnapshotHeader const * header = snapshotCheck(image.data(), image.size());
+    TOOLS_ASSERTR(!!header);
+    TOOLS_ASSERTR(header->count_ == storage.size());
+    TOOLS_ASSERTR(header->slots_ >= header->count_);
+    for (auto && str : storage) {
+        tools::impl::StringIdData key(str.c_str(), stringHash(str.data(), numeric_cast<uint32>(str.size())), str.size());
+        char const * found = snapshotFind(header, key);
+        TOOLS_ASSERTR(!!found);
+        TOOLS_ASSERTR(found != str.c_str());
+        TOOLS_ASSERTR((strlen(found) == str.size()) && (memcmp(found, str.data(), str.size()) == 0));
+    }
+    for (unsigned i = 0U; i != 1000U; ++i) {
+        char buf[48];
+        sprintf(buf, "TestStringIdSnapshot absent %u", i);
+        size_t len = strlen(buf);
+        TOOLS_ASSERTR(!snapshotFind(header, tools::impl::StringIdData(buf, stringHash(buf, numeric_cast<uint32>(len)), len)));
+    }
+    // Damaged images are rejected
+    TOOLS_ASSERTR(!snapshotCheck(image.data(), image.size() - 1U));
+    TOOLS_ASSERTR(!snapshotCheck(image.data(), sizeof(SnapshotHeader) - 1U));
+    std::vector<char> damaged(image);
+    reinterpret_cast<SnapshotHeader *>(damaged.data())->seed_ ^= 1U;
+    TOOLS_ASSERTR(!snapshotCheck(damaged.data(), damaged.size()));
+    // As is a string missing its terminator
+    damaged = image;
+    header = snapshotCheck(damaged.data(), damaged.size());
+    {
+        tools::impl::StringIdData key(storage.front().c_str(), stringHash(storage.front().data(), numeric_cast<uint32>(storage.front().size())), storage.front().size());
+        char const * found = snapshotFind(header, key);
+        TOOLS_ASSERTR(!!found);
+        damaged[(found - damaged.data()) + storage.front().size()] = 'x';
+        TOOLS_ASSERTR(!snapshotFind(header, key));
+    }
+    // Round trip the live table through a file
+    StringId sid("TestStringIdSnapshot live");
+#ifdef WINDOWS_PLATFORM
+    char const * path = "TestStringIdSnapshot.sids";
+#else // WINDOWS_PLATFORM
+    char const * path = "/tmp/TestStringIdSnapshot.sids";
+#endif // WINDOWS_PLATFORM
+    TOOLS_ASSERTR(stringIdSnapshotWrite(path));
+    size_t size = 0U;
+    void const * base = tools::impl::platformMapFile(path, &size);
+    TOOLS_ASSERTR(!!base);
+    header = snapshotCheck(base, size);
+    TOOLS_ASSERTR(!!header);
+    char const * found = snapshotFind(header, tools::impl::StringIdData(sid.c_str(), sid.hash(), sid.length()));
+    TOOLS_ASSERTR(!!found && (strcmp(found, sid.c_str()) == 0));
+    tools::impl::platformUnmapFile(base, size);
+    remove(path);
+});
+
+TOOLS_TEST_CASE("StringId.arena", [](Test &)
+{
+    static const unsigned count = 2000U;
+    char buf[64];
+    {
+        std::vector<StringId> sids;
+        for (unsigned i = 0U; i != count; ++i) {
+            sprintf(buf, "TestStringIdArena string %u", i);
+            sids.push_back(StringId(buf));
+            // Non-static characters are copied inline
+            TOOLS_ASSERTR(strcmp(sids.back().c_str(), buf) == 0);
+        }
+        uint64 ids, staticIds, bytes, saved;
+        tools::impl::stringIdGetMemoryTracking(ids, staticIds, bytes, saved);
+        // Records from earlier tests may be reclaimed meanwhile, so only check what ours account for.
+        TOOLS_ASSERTR(ids >= count);
+        TOOLS_ASSERTR(bytes >= count * sizeof(NewRealStringId));
+        TOOLS_ASSERTR(saved > 0U);
+    }
+    // Reclaimed blocks are reused by the same size class. Records are returned when phantom reclamation
+    // releases the table's reference, so check the arena directly.
+    {
+        StringArena & arena = stringArena();
+        void * block = arena.map(sizeof(NewRealStringId), 40U);
+        void * other = arena.map(sizeof(NewRealStringId), 80U);
+        arena.unmap(block);
+        TOOLS_ASSERTR(arena.map(sizeof(NewRealStringId), 33U) == block);
+        arena.unmap(block);
+        arena.unmap(other);
+    }
+    // Records too large for a size class
+    std::string big(4096U, 'x');
+    StringId sidBig(big);
+    TOOLS_ASSERTR(sidBig == big);
+    TOOLS_ASSERTR(sidBig.c_str() != big.c_str());
+});
+
+TOOLS_TEST_CASE("StringId.sweep", [](Test &)
+{
+    char const * str = "TestStringIdSweep string";
+    size_t len = strlen( str );
+    size_t hsh = stringHash( str, numeric_cast<uint32>(len) );
+    AutoDispose<NewRealStringId::Reference> key(new NewRealStringId(str, hsh, len, true, 0));
+    // Intern a record with no StringId holding it, as a lost unintern race would leave it
+    {
+        AutoDispose<NewRealStringId::Reference> rid(new NewRealStringId(str, hsh, len, true, 0));
+        auto table = getNewStringTable();
+        AutoDispose<> proto(phantomTryBindPrototype<PhantomEpoch>());
+        table.table_->update(*rid, [&](StringPhantom *& old)->void {
+            TOOLS_ASSERTR(!old);
+            old = new StringPhantom(rid);
+        });
+    }
+    {
+        bool found = false;
+        getNewStringTable().table_->find(*key, [&](StringPhantom * element)->void {
+            found = !!element;
+        });
+        TOOLS_ASSERTR(found);
+    }
+    // A live StringId keeps its record through a sweep
+    StringId live("TestStringIdSweep live string");
+    TOOLS_ASSERTR(stringTableSweep(NewStringTable::bucketCount) >= 1U);
+    getNewStringTable().table_->find(*key, [](StringPhantom * element)->void {
+        TOOLS_ASSERTR(!element);
+    });
+    StringId live2("TestStringIdSweep live string");
+    TOOLS_ASSERTR(live2.c_str() == live.c_str());
+});
+
+TOOLS_TEST_CASE("StringId.copy.scalability", testParamCombine<unsigned, bool>({ 1U, 2U, 4U, 8U, 16U }, { false, true }), [](Test & test, unsigned threads, bool distinct)
+{
+    AutoDispose<> lifetime;
+    StringIdTestImpl * state;
+    lifetime = anyDisposableAllocNew<AllocStatic<Platform>>(&state, distinct);
+    uint64 single = state->timed(test, 1U);
+    uint64 elapsed = state->timed(test, threads);
+    if (testTimingsReported()) {
+        fprintf(stderr, "StringId copy/destroy %u threads, %s: %.2f ns/copy, alone: %.2f ns/copy\n", threads, distinct ? "distinct" : "shared",
+            static_cast<double>(elapsed) / static_cast<double>(StringIdTestImpl::copiesPerThread),
+            static_cast<double>(single) / static_cast<double>(StringIdTestImpl::copiesPerThread));
+    }
+    if (distinct && (threads >= 4U) && (threads <= tools::impl::cpuCount())) {
+        // Copies of different StringIds share nothing, so threads running at once take well under their serial time.
+        TOOLS_ASSERTR((2U * elapsed) < (threads * single));
+    }
+});
+
 // TODO: reinstate this
 //TOOLS_TEST_CASE("StringId.widen", [](Test &)
 //{
@@ -701,4 +1541,38 @@ TOOLS_TEST_CASE("StringId.empty", [](Test &)
 //    TOOLS_ASSERTR( sid == sid3 );
 //});
 
+////////
+// StringIdTestImpl
+////////
+
+uint64
+StringIdTestImpl::timed(Test & test, unsigned threads)
+{
+    auto threading = test.environment().unmockNow<Threading>();
+    auto timing = test.environment().unmockNow<Timing>();
+    std::vector<AutoDispose<Thread>> forked;
+    uint64 start = timing->mark();
+    for (unsigned i = 0U; i != threads; ++i) {
+        forked.push_back(threading->fork("stringIdTesting", toThunk<&StringIdTestImpl::copySupport>()));
+    }
+    for (auto && thr : forked) {
+        thr->waitSync();
+    }
+    return timing->mark(start);
+}
+
+void
+StringIdTestImpl::copySupport(void)
+{
+    unsigned id = atomicAdd(&threadIds_, 1U) % maxThreads;
+    StringId const & source = distinct_ ? distinctIds_[id] : shared_;
+    StringId assigned;
+    for (unsigned i = 0U; i != copiesPerThread; ++i) {
+        StringId copied(source);
+        assigned = copied;
+    }
+    TOOLS_ASSERTR(assigned == source);
+    TOOLS_ASSERTR(assigned.c_str() == source.c_str());
+}
+
 #endif /* TOOLS_UNIT_TEST */
@@ -1,10 +1,14 @@
 #include "toolsprecompiled.h"
 
 #include <tools/AsyncTools.h>
+#include <tools/Concurrency.h>
+#include <tools/Threading.h>
 
 #include "TimingImpl.h"
 
 #include <algorithm>
+#include <limits.h>
+#include <string.h>
 #include <vector>
 #include <boost/numeric/conversion/cast.hpp>
 
@@ -18,49 +22,174 @@ using boost::numeric_cast;
 namespace {
     struct TimerQueueImpl;
 
+    enum : unsigned {
+        timerIdle,  // not started, or finished
+        timerPosted,  // in pending_, until the timer thread takes it in
+        timerWaiting,  // in the wheel
+        timerReady,  // in ready_
+    };
+
     struct TimerReq
-        : StandardManualRequest< TimerReq >
+        : StandardManualRequest< TimerReq, AllocStatic< Temporal >, Timer >
     {
-        TimerReq( TimerQueueImpl &, uint64, uint64 *, void * );
+        TimerReq( TimerQueueImpl &, uint64, uint64 *, uint64, void * );
+        ~TimerReq( void );
 
         // Request
         void start();
 
+        // Timer
+        bool cancel( void );
+        bool reschedule( uint64 );
+
         TimerQueueImpl * parent_;
         uint64 delta_;
         uint64 * startTime_;
-        TimerReq * next_;
-        uint64 due_;
+        TimerReq * next_;  // in pending_, then in a wheel slot
+        TimerReq ** prev_;  // what points to this in its wheel slot
+        unsigned slot_;  // level * TimerWheel::slots + slot
+        unsigned state_;  // guarded by the queue's lock, once posted
+        bool canceled_;  // while posted
+        uint64 slack_;
+        uint64 deadline_;  // as asked for
+        uint64 due_;  // when it is set to fire, within the slack after the deadline
         void * caller_;
     };
 
-    struct TimerQueueImpl
-        : StandardDisposable< TimerQueueImpl, TimerQueue >
+    typedef std::vector< TimerReq *, AllocatorAffinity< TimerReq * >> TimerVec;
+
+    // A hierarchical timing wheel. Time is counted in ticks of 2^tickBits ns (about 65 us), and each level
+    // has a slot per value of one 8 bit digit of the tick. A timer sits at the lowest level where its tick
+    // differs from the current one, in the slot for its digit there. When the current tick reaches an
+    // occupied slot, its timers move down a level, or out of the wheel once they are due within the
+    // current tick. Insertion is O(1), and a timer moves at most once per level. Bitmaps of the occupied
+    // slots find the next one without visiting the empty ones in between.
+    struct TimerWheel
     {
-        typedef std::vector< TimerReq *, AllocatorAffinity< TimerReq * >> TimerVec;
+        static unsigned const tickBits = 16U;
+        static unsigned const slotBits = 8U;
+        static unsigned const slots = 1U << slotBits;
+        static unsigned const levels = ( 64U - tickBits + slotBits - 1U ) / slotBits;
+
+        TimerWheel( uint64 );
+
+        // Returns false, without taking the timer, if it is due within the current tick.
+        bool insert( TimerReq * );
+        void remove( TimerReq * );
+        // Move the current tick forward, to that of the given time, appending the timers due within it.
+        void advance( uint64, TimerVec & );
+        // When the wheel next has work, or UINT64_MAX if it is empty.
+        uint64 nextTime( void ) const;
+        // Remove every timer.
+        void drain( TimerVec & );
+
+        // The tick of the next occupied slot, or UINT64_MAX.
+        uint64 nextTick( unsigned &, unsigned & ) const;
+
+        uint64 tick_;
+        uint64 occupied_[ levels ][ slots / 64U ];
+        TimerReq * slots_[ levels ][ slots ];
+    };
 
+    // Timers are posted to pending_ without locking, and only the timer thread takes them from there. The
+    // wheel and ready_ are shared with cancel and reschedule, under lock_.
+    //
+    // Each timer holds a reference on its queue, as the owner does until it disposes of it. Disposing
+    // closes the queue, cancelling whatever it holds, and it stays closed for as long as handles to its
+    // timers are left: starting one of those cancels it straight away.
+    struct TimerQueueImpl
+        : TimerQueue
+        , AllocStatic<>
+    {
         TimerQueueImpl( Thunk const & );
         ~TimerQueueImpl( void );
 
+        // Disposable
+        void dispose( void );
+
         // TimerQueue
-        AutoDispose< Request > timer( uint64, uint64 *, void * );
+        AutoDispose< Timer > timer( uint64, uint64 *, uint64, void * );
         uint64 eval( uint64 * );
+        TimingStats stats( void );
 
         // local methods
         bool draw( TimerReq * );
         void post( TimerReq & );
+        void place( TimerReq * );
+        void account( void );
+        void withdraw( TimerReq * );
+        bool cancel( TimerReq & );
+        bool reschedule( TimerReq &, uint64 );
+        void close( void );
+        void drop( TimerReq * );
+        void deref( void );
 
+        unsigned volatile refs_;
+        bool volatile closed_;
         Thunk thunk_;
         TimerReq * volatile pending_;
-        TimerVec sleeping_;
+        AutoDispose< Monitor > lock_;
+        TimerWheel wheel_;
+        // Timers due within the wheel's current tick, soonest last.
+        TimerVec ready_;
+        // Taken out under the lock by eval, to be finished once it is released.
+        TimerVec firing_;
+        TimerVec canceled_;
         TimerReq claim_;
+        // Only the timer thread writes these.
+        uint64 wakeups_;
+        uint64 fired_;
+        uint64 saved_;
+        std::vector< uint64, AllocatorAffinity< uint64 >> ticks_;
+    };
+
+    struct TimerLocal
+        : AllocStatic<>
+    {
+        TimerLocal( void ) : queue_( nullptr ) {}
+
+        TimerQueueOwner * queue_;
     };
 };  // anonymous namespace
 
+//////////
+// Statics
+//////////
+
+static uint64 volatile coarseTime = 0U;
+static StandardThreadLocalHandle< TimerLocal > timerLocal_;
+
 ///////////////////////
 // Non-member Functions
 ///////////////////////
 
+uint64
+tools::impl::getCoarseTime( void )
+{
+    uint64 ret = atomicRead( &coarseTime );
+    if( TOOLS_UNLIKELY( !ret )) {
+        ret = tools::impl::getHighResTime();
+        tickCoarseTime( ret );
+    }
+    return ret;
+}
+
+void
+tools::impl::tickCoarseTime(
+    uint64 now )
+{
+    // Every worker ticks this, so skip the store (and the cache line bouncing it causes) until it has fallen
+    // a little behind. Racing ticks may also arrive out of order, and it only ever moves forward.
+    static uint64 const grain = 20U * TOOLS_NANOSECONDS_PER_MICROSECOND;
+    for( uint64 prev = atomicRead( &coarseTime ); ( prev + grain ) < now; ) {
+        uint64 seen = atomicCas( &coarseTime, prev, now );
+        if( seen == prev ) {
+            break;
+        }
+        prev = seen;
+    }
+}
+
 AutoDispose< TimerQueue >
 tools::impl::timerQueueNew(
     Thunk const & thunk )
@@ -68,6 +197,69 @@ tools::impl::timerQueueNew(
     return new TimerQueueImpl( thunk );
 }
 
+void
+tools::impl::timerQueueBindLocal(
+    TimerQueueOwner * queue )
+{
+    timerLocal_->queue_ = queue;
+}
+
+TimerQueueOwner *
+tools::impl::timerQueueLocal( void )
+{
+    TimerLocal * local = timerLocal_.peek();
+    return !!local ? local->queue_ : nullptr;
+}
+
+// The lowest set bit at or above from, or 64 if there is none.
+static unsigned
+timerLowBit(
+    uint64 word,
+    unsigned from )
+{
+    word = ( from < 64U ) ? ( word & ( ~0ULL << from )) : 0ULL;
+    if( !word ) {
+        return 64U;
+    }
+#ifdef WINDOWS_PLATFORM
+    unsigned long index;
+    _BitScanForward64( &index, word );
+    return static_cast< unsigned >( index );
+#else // WINDOWS_PLATFORM
+    return static_cast< unsigned >( __builtin_ctzll( word ));
+#endif // WINDOWS_PLATFORM
+}
+
+static unsigned
+timerHighBit(
+    uint64 word )
+{
+    TOOLS_ASSERT( !!word );
+#ifdef WINDOWS_PLATFORM
+    unsigned long index;
+    _BitScanReverse64( &index, word );
+    return static_cast< unsigned >( index );
+#else // WINDOWS_PLATFORM
+    return 63U - static_cast< unsigned >( __builtin_clzll( word ));
+#endif // WINDOWS_PLATFORM
+}
+
+// The most round time within the slack after a deadline. The windows of timers that overlap share their
+// roundest point whenever one lies in the overlap, so these timers land in the same tick and fire together.
+static uint64
+timerCoalesce(
+    uint64 deadline,
+    uint64 slack )
+{
+    uint64 latest = ( slack < ( UINT64_MAX - deadline )) ? ( deadline + slack ) : UINT64_MAX;
+    if( latest == deadline ) {
+        return deadline;
+    }
+    // Above their highest differing bit, the two agree, and there latest has a 1 where deadline has a 0.
+    unsigned bit = timerHighBit( deadline ^ latest );
+    return latest & ~(( 1ULL << bit ) - 1ULL );
+}
+
 ///////////
 // TimerReq
 ///////////
@@ -76,34 +268,200 @@ TimerReq::TimerReq(
     TimerQueueImpl & p,
     uint64 d,
     uint64 * s,
+    uint64 slack,
     void * c )
     : parent_( &p )
     , delta_( d )
     , startTime_( s )
+    , next_( nullptr )
+    , prev_( nullptr )
+    , slot_( 0U )
+    , state_( timerIdle )
+    , canceled_( false )
+    , slack_( slack )
     , caller_( c )
 {
+    // The queue's own claim_ is a member of it, and holds no reference.
+    if( this != &p.claim_ ) {
+        atomicRef( &p.refs_ );
+    }
+}
+
+TimerReq::~TimerReq( void )
+{
+    if( this != &parent_->claim_ ) {
+        parent_->deref();
+    }
 }
 
 void
 TimerReq::start()
 {
     uint64 now = tools::impl::getHighResTime();
-    due_ = now + delta_;
+    deadline_ = now + delta_;
+    due_ = timerCoalesce( deadline_, slack_ );
     if( !!startTime_ ) {
         *startTime_ = now;
     }
+    canceled_ = false;
+    state_ = timerPosted;
     parent_->post( *this );
 }
 
+bool
+TimerReq::cancel( void )
+{
+    return parent_->cancel( *this );
+}
+
+bool
+TimerReq::reschedule(
+    uint64 delay )
+{
+    return parent_->reschedule( *this, delay );
+}
+
+/////////////
+// TimerWheel
+/////////////
+
+TimerWheel::TimerWheel(
+    uint64 now )
+    : tick_( now >> tickBits )
+{
+    memset( occupied_, 0, sizeof( occupied_ ));
+    memset( slots_, 0, sizeof( slots_ ));
+}
+
+bool
+TimerWheel::insert(
+    TimerReq * r )
+{
+    uint64 tick = r->due_ >> tickBits;
+    if( tick <= tick_ ) {
+        return false;
+    }
+    unsigned level = timerHighBit( tick ^ tick_ ) / slotBits;
+    unsigned slot = static_cast< unsigned >(( tick >> ( level * slotBits )) & ( slots - 1U ));
+    TimerReq * head = slots_[ level ][ slot ];
+    r->next_ = head;
+    if( !!head ) {
+        head->prev_ = &r->next_;
+    }
+    r->prev_ = &slots_[ level ][ slot ];
+    r->slot_ = ( level * slots ) + slot;
+    slots_[ level ][ slot ] = r;
+    occupied_[ level ][ slot / 64U ] |= 1ULL << ( slot % 64U );
+    return true;
+}
+
+void
+TimerWheel::remove(
+    TimerReq * r )
+{
+    *r->prev_ = r->next_;
+    if( !!r->next_ ) {
+        r->next_->prev_ = r->prev_;
+    }
+    r->next_ = nullptr;
+    r->prev_ = nullptr;
+    unsigned level = r->slot_ / slots;
+    unsigned slot = r->slot_ % slots;
+    if( !slots_[ level ][ slot ] ) {
+        occupied_[ level ][ slot / 64U ] &= ~( 1ULL << ( slot % 64U ));
+    }
+}
+
+uint64
+TimerWheel::nextTick(
+    unsigned & level,
+    unsigned & slot ) const
+{
+    // Occupied slots are always past the current tick's digit at their level, and anything at a lower
+    // level comes due before the current tick's digit at the next level up changes.
+    for( level = 0U; level != levels; ++level ) {
+        unsigned shift = level * slotBits;
+        unsigned digit = static_cast< unsigned >(( tick_ >> shift ) & ( slots - 1U ));
+        for( unsigned word = ( digit + 1U ) / 64U; word != ( slots / 64U ); ++word ) {
+            unsigned bit = timerLowBit( occupied_[ level ][ word ], ( word == ( digit + 1U ) / 64U ) ? (( digit + 1U ) % 64U ) : 0U );
+            if( bit != 64U ) {
+                slot = ( word * 64U ) + bit;
+                uint64 high = ( tick_ >> ( shift + slotBits )) << ( shift + slotBits );
+                return high | ( static_cast< uint64 >( slot ) << shift );
+            }
+        }
+    }
+    return UINT64_MAX;
+}
+
+void
+TimerWheel::advance(
+    uint64 now,
+    TimerVec & ready )
+{
+    uint64 target = now >> tickBits;
+    for(;;) {
+        unsigned level, slot;
+        uint64 tick = nextTick( level, slot );
+        if( tick > target ) {
+            break;
+        }
+        tick_ = tick;
+        TimerReq * list = slots_[ level ][ slot ];
+        slots_[ level ][ slot ] = nullptr;
+        occupied_[ level ][ slot / 64U ] &= ~( 1ULL << ( slot % 64U ));
+        for( TimerReq * next; !!list; list = next ) {
+            next = list->next_;
+            list->next_ = nullptr;
+            if( !insert( list )) {
+                ready.push_back( list );
+            }
+        }
+    }
+    tick_ = std::max( tick_, target );
+}
+
+uint64
+TimerWheel::nextTime( void ) const
+{
+    unsigned level, slot;
+    uint64 tick = nextTick( level, slot );
+    return ( tick == UINT64_MAX ) ? UINT64_MAX : ( tick << tickBits );
+}
+
+void
+TimerWheel::drain(
+    TimerVec & out )
+{
+    for( unsigned level = 0U; level != levels; ++level ) {
+        for( unsigned slot = 0U; slot != slots; ++slot ) {
+            for( TimerReq * list = slots_[ level ][ slot ], * next; !!list; list = next ) {
+                next = list->next_;
+                list->next_ = nullptr;
+                out.push_back( list );
+            }
+            slots_[ level ][ slot ] = nullptr;
+        }
+        memset( occupied_[ level ], 0, sizeof( occupied_[ level ]));
+    }
+}
+
 /////////////////
 // TimerQueueImpl
 /////////////////
 
 TimerQueueImpl::TimerQueueImpl(
     Thunk const & thunk )
-    : thunk_( thunk )
+    : refs_( 1U )
+    , closed_( false )
+    , thunk_( thunk )
     , pending_( nullptr )
-    , claim_( *this, 0, nullptr, nullptr )
+    , lock_( monitorStaticNew() )
+    , wheel_( tools::impl::getHighResTime() )
+    , claim_( *this, 0, nullptr, 0, nullptr )
+    , wakeups_( 0U )
+    , fired_( 0U )
+    , saved_( 0U )
 {
     claim_.next_ = nullptr;
     pending_ = &claim_;
@@ -111,33 +469,28 @@ TimerQueueImpl::TimerQueueImpl(
 
 TimerQueueImpl::~TimerQueueImpl( void )
 {
-    AutoDispose< Error::Reference > err;
-    // Clear out all pending timers
-    while( !!pending_ && pending_ != &claim_ ) {
-        TimerReq * toCancel = pending_;
-        pending_ = toCancel->next_;
-        toCancel->next_ = nullptr;
-        if( !err ) {
-            err = errorCancelNew();
-        }
-        toCancel->finish( *err );
-    }
-    // Cancel timers from those most about to fire, to those more distant.
-    std::for_each(sleeping_.rbegin(), sleeping_.rend(), [&]( TimerReq * r )->void {
-        if( !err ) {
-            err = errorCancelNew();
-        }
-        r->finish( *err );
-    });
+    // Closed before the last reference went.
+    TOOLS_ASSERT( closed_ );
+    TOOLS_ASSERT( pending_ == &claim_ );
+    TOOLS_ASSERT( ready_.empty() );
+    TOOLS_ASSERT( wheel_.nextTime() == UINT64_MAX );
 }
 
-AutoDispose< Request >
+void
+TimerQueueImpl::dispose( void )
+{
+    close();
+    deref();
+}
+
+AutoDispose< Timer >
 TimerQueueImpl::timer(
     uint64 delay,
     uint64 * start,
+    uint64 slack,
     void * caller )
 {
-    return new TimerReq( *this, delay, start, caller );
+    return new TimerReq( *this, delay, start, slack, caller );
 }
 
 uint64
@@ -145,37 +498,72 @@ TimerQueueImpl::eval(
     uint64 * napTime )
 {
     uint64 now, retry;
+    if( atomicRead( &closed_ )) {
+        // claim_ stays in pending_ for good, see close.
+        retry = 7ULL * TOOLS_NANOSECONDS_PER_SECOND;
+        if( !!napTime ) {
+            *napTime = tools::impl::getHighResTime() + retry;
+        }
+        return retry;
+    }
     do {
         // By default retry after 7 seconds
         retry = 7ULL * TOOLS_NANOSECONDS_PER_SECOND;
         // Claim ownership of the eval loop immediately to prevent other threads from pushing
         // spurious wakeups.
         TimerReq * queue = atomicExchange( &pending_, &claim_ );
-        // Copy, then sort, the claims.
-        bool added = draw( queue );
-        bool activate = false;
-        // Allow up to 50 us of slop.
-        now = tools::impl::getHighResTime();
-        uint64 activateTime = now + ( 50U * TOOLS_MILLISECONDS_PER_SECOND );
-        if( !sleeping_.empty() ) {
-            do {
-                TimerReq * soonest = sleeping_.back();
-                if( soonest->due_ > activateTime ) {
-                    retry = std::min( retry, numeric_cast< uint64 >( ( soonest->due_ - activateTime ) +
-                        ( 100U * TOOLS_MILLISECONDS_PER_SECOND )));
-                    break;                  
+        bool added;
+        uint64 activateTime, next;
+        {
+            AutoDispose<> l( lock_->enter() );
+            size_t settled = ready_.size();
+            // Take in the claims.
+            added = draw( queue );
+            // Allow up to 50 us of slop.
+            now = tools::impl::getHighResTime();
+            tools::impl::tickCoarseTime( now );
+            activateTime = now + ( 50U * TOOLS_MILLISECONDS_PER_SECOND );
+            wheel_.advance( activateTime, ready_ );
+            if( ready_.size() != settled ) {
+                for( size_t i = settled; i != ready_.size(); ++i ) {
+                    ready_[ i ]->state_ = timerReady;
                 }
-                activate = true;
-                sleeping_.pop_back();
-                // Fire this timer
-                uint64 duration = tools::impl::getHighResTime();
-                //void * caller = soonest->caller_;
-                soonest->finish();
-                duration = tools::impl::getHighResTime() - duration;
-                // if( duration > warningTime ) {
-                //     // TODO: log this as taking a long time
-                // }
-            } while( !sleeping_.empty() );
+                // Only what is due within the current tick is sorted.
+                std::sort( ready_.begin(), ready_.end(), []( TimerReq * l, TimerReq * r )->bool {
+                    return l->due_ > r->due_;
+                });
+            }
+            // Once taken out to fire, a timer can no longer be cancelled or moved.
+            while( !ready_.empty() && ( ready_.back()->due_ <= activateTime )) {
+                ready_.back()->state_ = timerIdle;
+                firing_.push_back( ready_.back() );
+                ready_.pop_back();
+            }
+            next = ready_.empty() ? wheel_.nextTime() : ready_.back()->due_;
+        }
+        bool activate = !firing_.empty() || !canceled_.empty();
+        account();
+        if( !canceled_.empty() ) {
+            AutoDispose< Error::Reference > err( errorCancelNew() );
+            for( auto && r : canceled_ ) {
+                r->finish( *err );
+            }
+            canceled_.clear();
+        }
+        for( auto && soonest : firing_ ) {
+            // Fire this timer
+            uint64 duration = tools::impl::getHighResTime();
+            //void * caller = soonest->caller_;
+            soonest->finish();
+            duration = tools::impl::getHighResTime() - duration;
+            // if( duration > warningTime ) {
+            //     // TODO: log this as taking a long time
+            // }
+        }
+        firing_.clear();
+        if( next != UINT64_MAX ) {
+            retry = std::min( retry, numeric_cast< uint64 >( ( next - activateTime ) +
+                ( 100U * TOOLS_MILLISECONDS_PER_SECOND )));
         }
         if( activate || added ) {
             // If we succeeded, try and find some more work.
@@ -192,6 +580,44 @@ TimerQueueImpl::eval(
     return retry;
 }
 
+TimingStats
+TimerQueueImpl::stats( void )
+{
+    TimingStats ret;
+    ret.wakeups_ = wakeups_;
+    ret.fired_ = fired_;
+    ret.saved_ = saved_;
+    return ret;
+}
+
+// Tally the timers about to fire. Fired at their exact deadlines, they would have needed a wakeup for each
+// distinct tick those fell in, rather than for each distinct tick they were due in.
+void
+TimerQueueImpl::account( void )
+{
+    if( firing_.empty() ) {
+        return;
+    }
+    ++wakeups_;
+    fired_ += firing_.size();
+    if( std::none_of( firing_.begin(), firing_.end(), []( TimerReq * r )->bool { return r->due_ != r->deadline_; })) {
+        return;
+    }
+    auto distinct = [&]( uint64 TimerReq::* field )->size_t {
+        ticks_.clear();
+        for( auto && r : firing_ ) {
+            ticks_.push_back( ( r->*field ) >> TimerWheel::tickBits );
+        }
+        std::sort( ticks_.begin(), ticks_.end() );
+        return static_cast< size_t >( std::unique( ticks_.begin(), ticks_.end() ) - ticks_.begin() );
+    };
+    size_t asked = distinct( &TimerReq::deadline_ );
+    size_t due = distinct( &TimerReq::due_ );
+    if( asked > due ) {
+        saved_ += asked - due;
+    }
+}
+
 bool
 TimerQueueImpl::draw(
     TimerReq * queue )
@@ -202,7 +628,14 @@ TimerQueueImpl::draw(
             queueNext = queue->next_;
             // This needs to be reset immediately
             queue->next_ = nullptr;
-            sleeping_.push_back( queue );
+            if( queue->canceled_ ) {
+                queue->state_ = timerIdle;
+                canceled_.push_back( queue );
+            } else if( wheel_.insert( queue )) {
+                queue->state_ = timerWaiting;
+            } else {
+                ready_.push_back( queue );
+            }
             added = true;
         }
         if( pending_ == &claim_ ) {
@@ -210,11 +643,6 @@ TimerQueueImpl::draw(
         }
         queue = atomicExchange( &pending_, &claim_ );
     }
-    if( added ) {
-        std::sort( sleeping_.begin(), sleeping_.end(), []( TimerReq * l, TimerReq * r )->bool {
-            return l->due_ > r->due_;
-        });
-    }
     return added;
 }
 
@@ -224,13 +652,227 @@ TimerQueueImpl::post(
 {
     if( !atomicPush( &pending_, &r, &TimerReq::next_ )) {
         if( !!thunk_ ) {
-	    thunk_.fire();
-	}
+            // Not fire(), which would empty the thunk.
+            thunk_();
+        }
+    } else if( atomicRead( &closed_ )) {
+        // Closed, so nothing evaluates pending_ any more. Either close took this timer along with the
+        // rest, or it was pushed after that and is cancelled here.
+        drop( atomicExchange( &pending_, &claim_ ));
+    }
+}
+
+// Put a timer taken out of the wheel or ready_ back in, as of its due time.
+void
+TimerQueueImpl::place(
+    TimerReq * r )
+{
+    if( wheel_.insert( r )) {
+        r->state_ = timerWaiting;
+        return;
+    }
+    r->state_ = timerReady;
+    ready_.insert( std::upper_bound( ready_.begin(), ready_.end(), r, []( TimerReq * l, TimerReq * r )->bool {
+        return l->due_ > r->due_;
+    }), r );
+}
+
+void
+TimerQueueImpl::withdraw(
+    TimerReq * r )
+{
+    if( r->state_ == timerWaiting ) {
+        wheel_.remove( r );
+    } else {
+        TOOLS_ASSERT( r->state_ == timerReady );
+        // ready_ holds only what is due within the current tick.
+        ready_.erase( std::find( ready_.begin(), ready_.end(), r ));
+    }
+    r->state_ = timerIdle;
+}
+
+bool
+TimerQueueImpl::cancel(
+    TimerReq & r )
+{
+    {
+        AutoDispose<> l( lock_->enter() );
+        switch( r.state_ ) {
+        case timerPosted:
+            // The timer thread finishes it as it takes it in.
+            if( r.canceled_ ) {
+                return false;
+            }
+            r.canceled_ = true;
+            return true;
+        case timerWaiting:
+        case timerReady:
+            withdraw( &r );
+            break;
+        default:
+            return false;
+        }
+    }
+    AutoDispose< Error::Reference > err( errorCancelNew() );
+    r.finish( *err );
+    return true;
+}
+
+bool
+TimerQueueImpl::reschedule(
+    TimerReq & r,
+    uint64 delay )
+{
+    uint64 deadline = tools::impl::getHighResTime() + delay;
+    uint64 due = timerCoalesce( deadline, r.slack_ );
+    bool sooner;
+    {
+        AutoDispose<> l( lock_->enter() );
+        switch( r.state_ ) {
+        case timerPosted:
+            if( r.canceled_ ) {
+                return false;
+            }
+            // Not yet taken in, so nothing to move.
+            r.deadline_ = deadline;
+            r.due_ = due;
+            return true;
+        case timerWaiting:
+        case timerReady:
+            sooner = ( due < r.due_ );
+            withdraw( &r );
+            r.deadline_ = deadline;
+            r.due_ = due;
+            place( &r );
+            break;
+        default:
+            return false;
+        }
+    }
+    if( sooner && !!thunk_ ) {
+        // The timer thread may be asleep until the old deadline.
+        thunk_();
+    }
+    return true;
+}
+
+// Cancel everything and stop evaluating. The timer thread must not be in eval.
+void
+TimerQueueImpl::close( void )
+{
+    TimerVec waiting;
+    {
+        AutoDispose<> l( lock_->enter() );
+        TOOLS_ASSERT( !closed_ );
+        atomicSet( &closed_, true );
+        // Cancel timers from those most about to fire, to those more distant.
+        wheel_.drain( waiting );
+        for( auto && r : waiting ) {
+            r->state_ = timerIdle;
+        }
+        std::sort( waiting.begin(), waiting.end(), []( TimerReq * l, TimerReq * r )->bool {
+            return l->due_ < r->due_;
+        });
+        for( auto && r : ready_ ) {
+            r->state_ = timerIdle;
+        }
+        waiting.insert( waiting.begin(), ready_.rbegin(), ready_.rend() );
+        ready_.clear();
+    }
+    // Leaving claim_ in pending_ means a later post never calls the thunk, and sees it is closed instead.
+    drop( atomicExchange( &pending_, &claim_ ));
+    if( !waiting.empty() ) {
+        AutoDispose< Error::Reference > err( errorCancelNew() );
+        for( auto && r : waiting ) {
+            r->finish( *err );
+        }
+    }
+}
+
+// Cancel timers taken from pending_ once the queue is closed.
+void
+TimerQueueImpl::drop(
+    TimerReq * queue )
+{
+    TimerVec dropped;
+    {
+        AutoDispose<> l( lock_->enter() );
+        for( TimerReq * next; !!queue && queue != &claim_; queue = next ) {
+            next = queue->next_;
+            queue->next_ = nullptr;
+            queue->state_ = timerIdle;
+            dropped.push_back( queue );
+        }
+    }
+    if( dropped.empty() ) {
+        return;
+    }
+    AutoDispose< Error::Reference > err( errorCancelNew() );
+    for( auto && r : dropped ) {
+        r->finish( *err );
+    }
+}
+
+void
+TimerQueueImpl::deref( void )
+{
+    if( !atomicDeref( &refs_ )) {
+        delete this;
     }
 }
 
 #include <tools/UnitTest.h>
 #if TOOLS_UNIT_TEST
+#include <tools/AlgorithmsTools.h>
+#include <tools/AtomicCollections.h>
+
+namespace {
+    struct TimerProbe
+        : Completable< TimerProbe >
+    {
+        void fired( Error * err ) {
+            at_ = tools::impl::getHighResTime();
+            canceled_ = !!err;
+            order_ = ( *sequence_ )++;
+        }
+
+        uint64 delay_;
+        uint64 start_;
+        uint64 at_;
+        unsigned order_;
+        unsigned * sequence_;
+        bool canceled_;
+    };
+
+    struct TimerCount
+        : Completable< TimerCount >
+    {
+        TimerCount( void ) : fired_( 0U ) {}
+
+        void fired( Error * ) {
+            ++fired_;
+        }
+
+        unsigned fired_;
+    };
+
+    // The owner of a queue only ever evaluated by the test thread.
+    struct TimerQueueOwnerTest
+        : TimerQueueOwner
+    {
+        TimerQueueOwnerTest(void) : queue_(tools::impl::timerQueueNew(Thunk())) {}
+
+        TimerQueue & queue(void) {
+            return *queue_;
+        }
+        bool eval(uint64 * due) {
+            queue_->eval(due);
+            return true;
+        }
+
+        AutoDispose<TimerQueue> queue_;
+    };
+};  // anonymous namespace
 
 //////////
 // Testing
@@ -292,6 +934,387 @@ TOOLS_TEST_CASE("Timing.mark.wait", "Timing leaves things allocated", [](Test &
     }
 });
 
+TOOLS_TEST_CASE("Timing.queue.order", [](Test &)
+{
+    static unsigned const probes = 4096U;
+    static unsigned const distant = 16U;
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    std::vector<TimerProbe> probe(probes);
+    std::vector<AutoDispose<Request>> reqs;
+    unsigned sequence = 0U;
+    for (unsigned i = 0U; i != probes; ++i) {
+        // Spread over 40 ms, with some due at once, some sharing a delay, and some far enough out to
+        // still be waiting when the queue goes away.
+        uint64 delay = tools::randomU64() % (40U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+        if ((i % 64U) == 0U) {
+            delay = 0U;
+        } else if ((i % 64U) == 1U) {
+            delay = 5U * TOOLS_NANOSECONDS_PER_MILLISECOND;
+        }
+        if (i < distant) {
+            delay = (i + 1U) * 3600U * TOOLS_NANOSECONDS_PER_SECOND;
+        }
+        probe[i].delay_ = delay;
+        probe[i].order_ = UINT_MAX;
+        probe[i].sequence_ = &sequence;
+        probe[i].canceled_ = false;
+        reqs.push_back(queue->timer(delay, &probe[i].start_));
+        reqs.back()->start(probe[i].toCompletion<&TimerProbe::fired>());
+    }
+    uint64 giveUp = tools::impl::getHighResTime() + (5U * TOOLS_NANOSECONDS_PER_SECOND);
+    while ((sequence != (probes - distant)) && (tools::impl::getHighResTime() < giveUp)) {
+        queue->eval();
+    }
+    TOOLS_ASSERTR(sequence == (probes - distant));
+    std::vector<TimerProbe *> fired;
+    for (unsigned i = distant; i != probes; ++i) {
+        TOOLS_ASSERTR(!probe[i].canceled_);
+        // Never more than the 50 us of slop early.
+        TOOLS_ASSERTR((probe[i].at_ + (50U * TOOLS_NANOSECONDS_PER_MICROSECOND)) >= (probe[i].start_ + probe[i].delay_));
+        fired.push_back(&probe[i]);
+    }
+    std::sort(fired.begin(), fired.end(), [](TimerProbe * l, TimerProbe * r)->bool {
+        return l->order_ < r->order_;
+    });
+    for (size_t i = 1U; i < fired.size(); ++i) {
+        TOOLS_ASSERTR((fired[i - 1U]->start_ + fired[i - 1U]->delay_) <= (fired[i]->start_ + fired[i]->delay_));
+    }
+    // What is left is canceled, soonest first.
+    queue.reset();
+    TOOLS_ASSERTR(sequence == probes);
+    for (unsigned i = 0U; i != distant; ++i) {
+        TOOLS_ASSERTR(probe[i].canceled_);
+        TOOLS_ASSERTR(probe[i].order_ == (probes - distant + i));
+    }
+});
+
+TOOLS_TEST_CASE("Timing.queue.benchmark", [](Test &)
+{
+    static unsigned const timers = 1000000U;
+    static unsigned const bursts = 10U;
+    static unsigned const perBurst = timers / bursts;
+    // Due from half a second out over the next quarter second, in no particular order. None comes due
+    // while they are being inserted.
+    std::vector<uint64> delays(timers);
+    for (auto && delay : delays) {
+        delay = (500U * TOOLS_NANOSECONDS_PER_MILLISECOND) + (tools::randomU64() % (250U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    }
+    // What the queue did before the wheel: append each burst of claims, then sort all the sleeping timers.
+    uint64 sorting = 0U;
+    {
+        std::vector<uint64> sleeping;
+        sleeping.reserve(timers);
+        for (unsigned b = 0U; b != bursts; ++b) {
+            sleeping.insert(sleeping.end(), delays.begin() + (b * perBurst), delays.begin() + ((b + 1U) * perBurst));
+            uint64 start = tools::impl::getHighResTime();
+            std::sort(sleeping.begin(), sleeping.end(), [](uint64 l, uint64 r)->bool {
+                return l > r;
+            });
+            sorting += tools::impl::getHighResTime() - start;
+        }
+    }
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    TimerCount count;
+    std::vector<AutoDispose<Request>> reqs;
+    reqs.reserve(timers);
+    for (uint64 delay : delays) {
+        reqs.push_back(queue->timer(delay));
+    }
+    uint64 started = 0U;
+    uint64 inserted = 0U;
+    for (unsigned b = 0U; b != bursts; ++b) {
+        uint64 start = tools::impl::getHighResTime();
+        for (unsigned i = b * perBurst; i != ((b + 1U) * perBurst); ++i) {
+            reqs[i]->start(count.toCompletion<&TimerCount::fired>());
+        }
+        started += tools::impl::getHighResTime() - start;
+        start = tools::impl::getHighResTime();
+        queue->eval();
+        inserted += tools::impl::getHighResTime() - start;
+    }
+    TOOLS_ASSERTR(count.fired_ == 0U);
+    // Time spent expiring, less that spent waiting for timers to come due.
+    uint64 expiring = 0U;
+    uint64 giveUp = tools::impl::getHighResTime() + (10U * TOOLS_NANOSECONDS_PER_SECOND);
+    while ((count.fired_ != timers) && (tools::impl::getHighResTime() < giveUp)) {
+        unsigned before = count.fired_;
+        uint64 start = tools::impl::getHighResTime();
+        queue->eval();
+        if (count.fired_ != before) {
+            expiring += tools::impl::getHighResTime() - start;
+        }
+    }
+    TOOLS_ASSERTR(count.fired_ == timers);
+    if (testTimingsReported()) {
+        fprintf(stderr, "Timer queue with %u timers: start %.1f ns, insert %.1f ns (sorted: %.1f ns), expire %.1f ns per timer\n", timers,
+            static_cast<double>(started) / timers, static_cast<double>(inserted) / timers, static_cast<double>(sorting) / timers,
+            static_cast<double>(expiring) / timers);
+    }
+    // The wheel takes each burst in without going over the timers already waiting.
+    TOOLS_ASSERTR(inserted < sorting);
+});
+
+TOOLS_TEST_CASE("Timing.timer.cancel", [](Test & test)
+{
+    auto timing = test.environment().get<Timing>();
+    AutoDispose<Timer> timer(timing->timer(10U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    Test::RequestStatus status;
+    test.run(NoDispose<Request>(timer), status);
+    status.unnotified();
+    TOOLS_ASSERTR(timer->cancel());
+    status.error();
+    TOOLS_ASSERTR(!timer->cancel());
+    TOOLS_ASSERTR(!timer->reschedule(TOOLS_NANOSECONDS_PER_MILLISECOND));
+    // Nothing is left to fire.
+    test.progressTime(20U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+});
+
+TOOLS_TEST_CASE("Timing.timer.reschedule", [](Test & test)
+{
+    auto timing = test.environment().get<Timing>();
+    AutoDispose<Timer> later(timing->timer(10U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    AutoDispose<Timer> sooner(timing->timer(10U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    Test::RequestStatus laterStatus, soonerStatus;
+    test.run(NoDispose<Request>(later), laterStatus);
+    test.run(NoDispose<Request>(sooner), soonerStatus);
+    TOOLS_ASSERTR(later->reschedule(30U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    TOOLS_ASSERTR(sooner->reschedule(5U * TOOLS_NANOSECONDS_PER_MILLISECOND));
+    test.progressTime(5U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+    soonerStatus.success();
+    laterStatus.unnotified();
+    // Past where it was first due, but not yet where it was moved to.
+    test.progressTime(20U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+    laterStatus.unnotified();
+    test.progressTime(5U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+    laterStatus.success();
+    TOOLS_ASSERTR(!later->reschedule(TOOLS_NANOSECONDS_PER_MILLISECOND));
+});
+
+TOOLS_TEST_CASE("Timing.queue.cancel", [](Test &)
+{
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    unsigned sequence = 0U;
+    TimerProbe posted, waiting;
+    for (auto && p : { &posted, &waiting }) {
+        p->order_ = UINT_MAX;
+        p->sequence_ = &sequence;
+        p->canceled_ = false;
+    }
+    AutoDispose<Timer> postedReq(queue->timer(3600U * TOOLS_NANOSECONDS_PER_SECOND, nullptr));
+    AutoDispose<Timer> waitingReq(queue->timer(3600U * TOOLS_NANOSECONDS_PER_SECOND, nullptr));
+    waitingReq->start(waiting.toCompletion<&TimerProbe::fired>());
+    queue->eval();
+    postedReq->start(posted.toCompletion<&TimerProbe::fired>());
+    // Not yet taken in, so the timer thread finishes it as it does.
+    TOOLS_ASSERTR(postedReq->cancel());
+    TOOLS_ASSERTR(!postedReq->cancel());
+    TOOLS_ASSERTR(sequence == 0U);
+    // Already in the wheel, so it is finished before cancel returns.
+    TOOLS_ASSERTR(waitingReq->cancel());
+    TOOLS_ASSERTR(waiting.canceled_);
+    TOOLS_ASSERTR(sequence == 1U);
+    TOOLS_ASSERTR(!waitingReq->cancel());
+    queue->eval();
+    TOOLS_ASSERTR(posted.canceled_);
+    TOOLS_ASSERTR(sequence == 2U);
+    TOOLS_ASSERTR(!postedReq->reschedule(TOOLS_NANOSECONDS_PER_MILLISECOND));
+    // With the wheel empty again, the queue falls back to its default nap.
+    TOOLS_ASSERTR(queue->eval() == (7U * TOOLS_NANOSECONDS_PER_SECOND));
+});
+
+TOOLS_TEST_CASE("Timing.queue.close", [](Test &)
+{
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    unsigned sequence = 0U;
+    TimerProbe waiting, late;
+    for (auto && p : { &waiting, &late }) {
+        p->order_ = UINT_MAX;
+        p->sequence_ = &sequence;
+        p->canceled_ = false;
+    }
+    AutoDispose<Timer> waitingReq(queue->timer(3600U * TOOLS_NANOSECONDS_PER_SECOND, nullptr));
+    AutoDispose<Timer> lateReq(queue->timer(TOOLS_NANOSECONDS_PER_MILLISECOND, nullptr));
+    waitingReq->start(waiting.toCompletion<&TimerProbe::fired>());
+    queue->eval();
+    // Closing cancels what is waiting, and the handles keep the queue itself alive.
+    queue.reset();
+    TOOLS_ASSERTR(waiting.canceled_);
+    TOOLS_ASSERTR(sequence == 1U);
+    TOOLS_ASSERTR(!waitingReq->cancel());
+    // Nothing evaluates it any more, so a timer started now is cancelled straight away.
+    lateReq->start(late.toCompletion<&TimerProbe::fired>());
+    TOOLS_ASSERTR(late.canceled_);
+    TOOLS_ASSERTR(sequence == 2U);
+    TOOLS_ASSERTR(!lateReq->reschedule(TOOLS_NANOSECONDS_PER_MILLISECOND));
+});
+
+TOOLS_TEST_CASE("Timing.queue.reschedule", [](Test &)
+{
+    static unsigned const probes = 64U;
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    std::vector<TimerProbe> probe(probes);
+    std::vector<AutoDispose<Timer>> reqs;
+    unsigned sequence = 0U;
+    for (unsigned i = 0U; i != probes; ++i) {
+        probe[i].order_ = UINT_MAX;
+        probe[i].sequence_ = &sequence;
+        probe[i].canceled_ = false;
+        reqs.push_back(queue->timer(3600U * TOOLS_NANOSECONDS_PER_SECOND, nullptr));
+        reqs.back()->start(probe[i].toCompletion<&TimerProbe::fired>());
+    }
+    // Move them all in to the next 16 ms, in the reverse of the order they were started in. The first
+    // half are moved while still posted, the rest once they are in the wheel.
+    for (unsigned i = 0U; i != probes; ++i) {
+        if (i == (probes / 2U)) {
+            queue->eval();
+        }
+        probe[i].delay_ = (probes - i) * 250U * TOOLS_NANOSECONDS_PER_MICROSECOND;
+        probe[i].start_ = tools::impl::getHighResTime();
+        TOOLS_ASSERTR(reqs[i]->reschedule(probe[i].delay_));
+    }
+    uint64 giveUp = tools::impl::getHighResTime() + (5U * TOOLS_NANOSECONDS_PER_SECOND);
+    while ((sequence != probes) && (tools::impl::getHighResTime() < giveUp)) {
+        queue->eval();
+    }
+    TOOLS_ASSERTR(sequence == probes);
+    for (unsigned i = 0U; i != probes; ++i) {
+        TOOLS_ASSERTR(!probe[i].canceled_);
+        TOOLS_ASSERTR((probe[i].at_ + (50U * TOOLS_NANOSECONDS_PER_MICROSECOND)) >= (probe[i].start_ + probe[i].delay_));
+        TOOLS_ASSERTR(probe[i].order_ == (probes - 1U - i));
+        TOOLS_ASSERTR(!reqs[i]->reschedule(TOOLS_NANOSECONDS_PER_MILLISECOND));
+    }
+});
+
+TOOLS_TEST_CASE("Timing.queue.coalesce", [](Test &)
+{
+    static unsigned const probes = 32U;
+    AutoDispose<TimerQueue> queue(tools::impl::timerQueueNew(Thunk()));
+    for (uint64 slack : { 0ULL, 10ULL * TOOLS_NANOSECONDS_PER_MILLISECOND }) {
+        std::vector<TimerProbe> probe(probes);
+        std::vector<AutoDispose<Timer>> reqs;
+        unsigned sequence = 0U;
+        TimingStats before = queue->stats();
+        for (unsigned i = 0U; i != probes; ++i) {
+            // 100 us apart, so each deadline is in a tick of its own.
+            probe[i].delay_ = (i + 1U) * 100U * TOOLS_NANOSECONDS_PER_MICROSECOND;
+            probe[i].order_ = UINT_MAX;
+            probe[i].sequence_ = &sequence;
+            probe[i].canceled_ = false;
+            reqs.push_back(queue->timer(probe[i].delay_, &probe[i].start_, slack));
+            reqs.back()->start(probe[i].toCompletion<&TimerProbe::fired>());
+        }
+        uint64 giveUp = tools::impl::getHighResTime() + (5U * TOOLS_NANOSECONDS_PER_SECOND);
+        while ((sequence != probes) && (tools::impl::getHighResTime() < giveUp)) {
+            queue->eval();
+        }
+        TOOLS_ASSERTR(sequence == probes);
+        for (auto && p : probe) {
+            TOOLS_ASSERTR(!p.canceled_);
+            TOOLS_ASSERTR((p.at_ + (50U * TOOLS_NANOSECONDS_PER_MICROSECOND)) >= (p.start_ + p.delay_));
+        }
+        TimingStats after = queue->stats();
+        TOOLS_ASSERTR((after.fired_ - before.fired_) == probes);
+        if (slack == 0U) {
+            TOOLS_ASSERTR(after.saved_ == before.saved_);
+        } else {
+            // Every window spans the last deadline, so they share at most two round points.
+            TOOLS_ASSERTR((after.wakeups_ - before.wakeups_) <= 2U);
+            TOOLS_ASSERTR((after.saved_ - before.saved_) >= (probes - 2U));
+        }
+    }
+});
+
+TOOLS_TEST_CASE("Timing.queue.local", [](Test & test)
+{
+    auto timing = test.environment().unmockNow<Timing>();
+    TimerQueueOwnerTest owner;
+    TimerQueue * local = owner.queue_.get();
+    tools::impl::timerQueueBindLocal(&owner);
+    TimerCount count;
+    AutoDispose<Timer> timer(timing->timer(TOOLS_NANOSECONDS_PER_MILLISECOND));
+    timer->start(count.toCompletion<&TimerCount::fired>());
+    // The timer thread leaves it to this thread.
+    uint64 until = tools::impl::getHighResTime() + (20U * TOOLS_NANOSECONDS_PER_MILLISECOND);
+    while (tools::impl::getHighResTime() < until) {
+        tools::detail::atomicSpinPause();
+    }
+    TOOLS_ASSERTR(count.fired_ == 0U);
+    local->eval();
+    TOOLS_ASSERTR(count.fired_ == 1U);
+    // Waiting synchronously fires them as they come due.
+    AutoDispose<Request> delay(timing->timer(TOOLS_NANOSECONDS_PER_MILLISECOND));
+    AutoDispose<Error::Reference> err(runRequestSynchronously(delay));
+    TOOLS_ASSERTR(!err);
+    // Unbound, timers go back to the timer thread.
+    tools::impl::timerQueueBindLocal(nullptr);
+    delay = timing->timer(TOOLS_NANOSECONDS_PER_MILLISECOND);
+    err = runRequestSynchronously(delay);
+    TOOLS_ASSERTR(!err);
+    TOOLS_ASSERTR(local->stats().fired_ == 2U);
+});
+
+TOOLS_TEST_CASE("Timing.highRes.precision", [](Test &)
+{
+    // The bounds are relative to what the OS clock manages on this host, as load or virtualization worsens
+    // both clocks alike.
+    uint64 start = tools::impl::getOsTime();
+    uint64 last = tools::impl::getHighResTime();
+    uint64 lastBefore = start;
+    uint64 step = UINT64_MAX, worst = 0U;
+    uint64 osStep = UINT64_MAX, bracket = 0U;
+    while ((tools::impl::getOsTime() - start) < (250U * TOOLS_NANOSECONDS_PER_MILLISECOND)) {
+        uint64 before = tools::impl::getOsTime();
+        uint64 now = tools::impl::getHighResTime();
+        uint64 after = tools::impl::getOsTime();
+        TOOLS_ASSERTR(now >= last);
+        if (now != last) {
+            step = std::min(step, now - last);
+        }
+        last = now;
+        if (before != lastBefore) {
+            osStep = std::min(osStep, before - lastBefore);
+        }
+        lastBefore = before;
+        bracket = std::max(bracket, after - before);
+        // How far outside the OS clock's bracket of the read it fell.
+        uint64 off = (now < before) ? (before - now) : ((now > after) ? (now - after) : 0U);
+        worst = std::max(worst, off);
+    }
+    if (testTimingsReported()) {
+        fprintf(stderr, "High resolution time from the %s: smallest step %llu ns (OS %llu ns), at most %llu ns off the OS clock\n",
+            tools::impl::highResTimeFromTsc() ? "TSC" : "OS", static_cast<unsigned long long>(step), static_cast<unsigned long long>(osStep),
+            static_cast<unsigned long long>(worst));
+    }
+    // Read once a loop, like the OS clock's step, so never coarser than that.
+    TOOLS_ASSERTR(step <= (2U * osStep));
+    // Never off by more than the longest it took to read the OS clock.
+    TOOLS_ASSERTR(worst <= (bracket + osStep));
+});
+
+TOOLS_TEST_CASE("Timing.highRes.cost", [](Test &)
+{
+    static unsigned const reads = 1000000U;
+    uint64 sink = 0U;
+    auto measure = [&](uint64 (*clock)(void))->double {
+        uint64 start = tools::impl::getOsTime();
+        for (unsigned i = 0U; i != reads; ++i) {
+            sink += clock();
+        }
+        return static_cast<double>(tools::impl::getOsTime() - start) / reads;
+    };
+    double highRes = measure(&tools::impl::getHighResTime);
+    double os = measure(&tools::impl::getOsTime);
+    double coarse = measure(&tools::impl::getCoarseTime);
+    if (testTimingsReported()) {
+        fprintf(stderr, "Clock reads: high resolution (%s) %.1f ns, OS %.1f ns, coarse %.1f ns\n",
+            tools::impl::highResTimeFromTsc() ? "TSC" : "OS", highRes, os, coarse);
+    }
+    TOOLS_ASSERTR(sink != 0U);
+    TOOLS_ASSERTR(tools::impl::getCoarseTime() <= tools::impl::getHighResTime());
+    // Only a load, where the others read a clock.
+    TOOLS_ASSERTR(coarse <= highRes);
+});
+
 TOOLS_TEST_CASE("time.units", [](Test &)
 {
     auto nsecs = 23_ns;
@@ -8,13 +8,40 @@ namespace tools {
    struct TimerQueue
        : Disposable
    {
-       virtual AutoDispose< Request > timer( uint64, uint64 *, void * = TOOLS_RETURN_ADDRESS() ) = 0;
+       virtual AutoDispose< Timer > timer( uint64, uint64 * = nullptr, uint64 = 0, void * = TOOLS_RETURN_ADDRESS() ) = 0;
        virtual uint64 eval( uint64 * = nullptr ) = 0;
+       virtual TimingStats stats( void ) = 0;
+   };
+
+   // A local timer queue, as its owner binds it. Other threads may evaluate the queue for the owner at times,
+   // and eval is where they all take turns.
+   struct TimerQueueOwner
+   {
+       virtual TimerQueue & queue( void ) = 0;
+       // Fire what is due, and set when the next is. Returns false, leaving the queue alone, while another
+       // thread is at it.
+       virtual bool eval( uint64 * ) = 0;
    };
 
    namespace impl {
+       // Monotonic nanoseconds, in the same time base as the OS clock (CLOCK_MONOTONIC on Linux).
        uint64 getHighResTime( void );
+       // The OS clock itself, which getHighResTime may only be kept in step with.
+       uint64 getOsTime( void );
+       // Whether getHighResTime reads the invariant TSC directly, rather than going through the OS.
+       bool highResTimeFromTsc( void );
+       // getHighResTime as of the last scheduler task or timer wakeup, for callers that can live with that.
+       // It is never ahead of getHighResTime, but lags it by up to a task's run time, and by longer in a
+       // process that has gone idle.
+       uint64 getCoarseTime( void );
+       void tickCoarseTime( uint64 );
+       // CPU time used by the calling thread, in nanoseconds.
+       uint64 getThreadCpuTime( void );
        AutoDispose< TimerQueue > timerQueueNew( Thunk const & );
+       // Timers made on a thread with a queue bound here go to that queue rather than the timer thread's, and
+       // the thread then has to eval it itself. Bind nullptr to go back to the timer thread.
+       void timerQueueBindLocal( TimerQueueOwner * );
+       TimerQueueOwner * timerQueueLocal( void );
        void annotateThread( StringId const & );
    };  // impl namespace
 };  // tools namespace
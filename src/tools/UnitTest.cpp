@@ -10,6 +10,7 @@
 
 #include <iterator>
 #include <queue>
+#include <stdlib.h>
 #include <unordered_map>
 #include <vector>
 
@@ -195,7 +196,11 @@ namespace {
         // Timing
         uint64 mark(void) override;
         uint64 mark(uint64) override;
-        AutoDispose<Request> timer(uint64, uint64 *) override;
+        AutoDispose<Timer> timer(uint64, uint64 *, uint64) override;
+        TimingStats stats(void) override;
+
+        // local methods
+        void withdraw(MockTimerReq &);
 
         TestImpl & parent_;
         uint64 time_;
@@ -204,7 +209,7 @@ namespace {
     };
 
     struct MockTimerReq
-        : StandardRequest<MockTimerReq>
+        : StandardRequest<MockTimerReq, AllocStatic<>, Timer>
         , Notifiable<MockTimerReq>
     {
         MockTimerReq(TestImpl &, MockScheduler &, uint64, uint64 *);
@@ -212,6 +217,10 @@ namespace {
         // StandardRequest
         RequestStep start(void) override;
 
+        // Timer
+        bool cancel(void) override;
+        bool reschedule(uint64) override;
+
         // local methods
         void escape(void);
         void reenter(void);
@@ -372,6 +381,13 @@ tools::unittest::impl::registerMockHelper(Test & test, NoDispose<Service> servic
     test.environment().stopUnmocked(service);
 }
 
+bool
+tools::testTimingsReported(void)
+{
+    static bool const ret = !!getenv("TOOLS_TEST_TIMINGS");
+    return ret;
+}
+
 ///////////
 // TestImpl
 ///////////
@@ -1057,12 +1073,39 @@ MockScheduler::mark(uint64 mark)
     return static_cast<uint64>(time_ - mark);
 }
 
-AutoDispose<Request>
-MockScheduler::timer(uint64 waitTime, uint64 * outStartTime)
+AutoDispose<Timer>
+MockScheduler::timer(uint64 waitTime, uint64 * outStartTime, uint64)
 {
+    // Mock timers fire at exactly their deadline, whatever the slack, so tests see the same times.
     return new MockTimerReq(parent_, *this, waitTime, outStartTime);
 }
 
+TimingStats
+MockScheduler::stats(void)
+{
+    // Mock time never sleeps, so there are no wakeups to count.
+    TimingStats ret;
+    ret.wakeups_ = 0U;
+    ret.fired_ = 0U;
+    ret.saved_ = 0U;
+    return ret;
+}
+
+void
+MockScheduler::withdraw(MockTimerReq & request)
+{
+    // Mock time is not performance critical, rebuild the queue without it.
+    PendingQueue queueCopy;
+    pendingRequests_.swap(queueCopy);
+    while (!queueCopy.empty()) {
+        auto entry = queueCopy.top();
+        if (entry.request_ != &request) {
+            pendingRequests_.push(entry);
+        }
+        queueCopy.pop();
+    }
+}
+
 ///////////////
 // MockTimerReq
 ///////////////
@@ -1088,6 +1131,7 @@ MockTimerReq::escape(void)
 {
     TOOLS_ASSERT(!running_);
     running_ = true;
+    cancel_ = false;
     thunk_ = toThunk<&MockTimerReq::reenter>();
     auto fireTime = timing_.time_ + waitTime_;
     timing_.pendingRequests_.push(MockTimerEntry(*this, fireTime));
@@ -1096,6 +1140,35 @@ MockTimerReq::escape(void)
     }
 }
 
+bool
+MockTimerReq::cancel(void)
+{
+    if (!running_ || cancel_) {
+        return false;
+    }
+    timing_.withdraw(*this);
+    cancel_ = true;
+    // On the test thread the completion is queued, as it is for a firing timer, and only happens once the
+    // test runs what it has queued. Anywhere else it completes before this returns.
+    if (test_.isMainThread()) {
+        test_.start(thunk_);
+    } else {
+        thunk_();
+    }
+    return true;
+}
+
+bool
+MockTimerReq::reschedule(uint64 waitTime)
+{
+    if (!running_ || cancel_) {
+        return false;
+    }
+    timing_.withdraw(*this);
+    timing_.pendingRequests_.push(MockTimerEntry(*this, timing_.time_ + waitTime));
+    return true;
+}
+
 void
 MockTimerReq::reenter(void)
 {
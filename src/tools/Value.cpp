@@ -4,315 +4,988 @@
 #include <tools/UnitTest.h>
 #include <tools/Value.h>
 
-#include <boost/numeric/conversion/cast.hpp>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits>
+#include <string>
+
+#if defined(__has_include)
+#  if __has_include(<charconv>) && ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#    include <charconv>
+#  endif
+#endif
+// Floating point to_chars/from_chars arrived later than the integer ones. Without them we fall back to
+// printf/strtod, searching for the shortest round trip precision.
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#  define TOOLS_HAS_FLOAT_CHARCONV
+#endif
 
 using namespace tools;
 
 namespace {
+  // Range checked numeric conversion. Returns false, leaving to alone, if from is out of range for ToT.
+  template< typename ToT, typename FromT >
+  inline bool NumericConvert( FromT from, ToT & to, std::true_type /*to integral*/, std::true_type /*from integral*/ ) {
+    if( std::is_signed< FromT >::value && ( from < FromT( 0 ))) {
+      if( !std::is_signed< ToT >::value || ( static_cast< sint64 >( from ) < static_cast< sint64 >( std::numeric_limits< ToT >::min() ))) {
+        return false;
+      }
+    } else if( static_cast< uint64 >( from ) > static_cast< uint64 >( std::numeric_limits< ToT >::max() )) {
+      return false;
+    }
+    to = static_cast< ToT >( from );
+    return true;
+  }
+
+  template< typename ToT, typename FromT >
+  inline bool NumericConvert( FromT from, ToT & to, std::true_type /*to integral*/, std::false_type /*from floating*/ ) {
+    // The bounds are powers of 2, exact as doubles. NaN fails both tests.
+    static const double lower = static_cast< double >( std::numeric_limits< ToT >::min() );
+    static const double upper = ldexp( 1.0, std::numeric_limits< ToT >::digits );
+    if( !( static_cast< double >( from ) >= lower ) || !( static_cast< double >( from ) < upper )) {
+      return false;
+    }
+    to = static_cast< ToT >( from );
+    return true;
+  }
+
+  template< typename ToT, typename FromT, typename FromIntegralT >
+  inline bool NumericConvert( FromT from, ToT & to, std::false_type /*to floating*/, FromIntegralT ) {
+    // Narrowing a finite value beyond ToT's range is undefined. Infinities and NaN carry over.
+    if( isfinite( static_cast< double >( from )) && ( fabs( static_cast< double >( from )) > static_cast< double >( std::numeric_limits< ToT >::max() ))) {
+      return false;
+    }
+    to = static_cast< ToT >( from );
+    return true;
+  }
+
+  template< typename ToT, typename FromT >
+  inline bool NumericConvert( FromT from, ToT & to ) {
+    return NumericConvert( from, to, std::integral_constant< bool, std::is_integral< ToT >::value >(), std::integral_constant< bool, std::is_integral< FromT >::value >() );
+  }
+
+  inline bool IsScaler( Value const & v ) {
+    return ( v.tag_ >= impl::valueTagBool ) && ( v.tag_ <= impl::valueTagDouble );
+  }
+
+  // Convert any scaler Value. Returns false for non-scalers, or if the value is out of range for ToT.
   template< typename ToT >
-  ToT ScalerConvert( Value const & v ) {
-    if( v.isInteger() ) {
-      if( v.isSigned() ) {
-        switch( v.sizeOf() ) {
-          case 1:
-            return boost::numeric_cast< ToT >( boost::any_cast< sint8 >( v.value_ ) );
-          case 2:
-            return boost::numeric_cast< ToT >( boost::any_cast< sint16 >( v.value_ ) );
-          case 4:
-            return boost::numeric_cast< ToT >( boost::any_cast< sint32 >( v.value_ ) );
-          case 8:
-            return boost::numeric_cast< ToT >( boost::any_cast< sint64 >( v.value_ ) );
-          default:
-            break;
-        }
+  bool ScalerConvert( Value const & v, ToT & ret ) {
+    switch( v.tag_ ) {
+    case impl::valueTagBool:
+      return NumericConvert( static_cast< uint8 >( v.storage_.bool_ ? 1U : 0U ), ret );
+    case impl::valueTagSint8:
+      return NumericConvert( v.storage_.sint8_, ret );
+    case impl::valueTagSint16:
+      return NumericConvert( v.storage_.sint16_, ret );
+    case impl::valueTagSint32:
+      return NumericConvert( v.storage_.sint32_, ret );
+    case impl::valueTagSint64:
+      return NumericConvert( v.storage_.sint64_, ret );
+    case impl::valueTagUint8:
+      return NumericConvert( v.storage_.uint8_, ret );
+    case impl::valueTagUint16:
+      return NumericConvert( v.storage_.uint16_, ret );
+    case impl::valueTagUint32:
+      return NumericConvert( v.storage_.uint32_, ret );
+    case impl::valueTagUint64:
+      return NumericConvert( v.storage_.uint64_, ret );
+    case impl::valueTagFloat:
+      return NumericConvert( v.storage_.float_, ret );
+    case impl::valueTagDouble:
+      return NumericConvert( v.storage_.double_, ret );
+    default:
+      break;
+    }
+    //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( ToT ) );
+    return false;
+  }
+
+  enum : size_t {
+    // Enough for any 64 bit integer, or the shortest round trip form of any double
+    formatBufferBytes = 32U,
+  };
+
+  // Write the decimal digits of val so they end at end. Returns the first character.
+  template< typename UIntT >
+  inline char * FormatUnsigned( UIntT val, char * end ) {
+    do {
+      *--end = static_cast< char >( '0' + ( val % 10U ));
+      val /= 10U;
+    } while( val != 0U );
+    return end;
+  }
+
+  template< typename IntT >
+  inline char * FormatInteger( IntT val, char * end, std::true_type /*signed*/ ) {
+    typedef typename std::make_unsigned< IntT >::type UIntT;
+    if( val < 0 ) {
+      // Negate unsigned, so the minimum value works
+      char * ret = FormatUnsigned( static_cast< UIntT >( UIntT( 0 ) - static_cast< UIntT >( val )), end );
+      *--ret = '-';
+      return ret;
+    }
+    return FormatUnsigned( static_cast< UIntT >( val ), end );
+  }
+
+  template< typename IntT >
+  inline char * FormatInteger( IntT val, char * end, std::false_type /*signed*/ ) {
+    return FormatUnsigned( val, end );
+  }
+
+  template< typename IntT >
+  inline StringId IntegerToStringId( IntT val ) {
+    char buf[ formatBufferBytes ];
+    char * end = buf + sizeof( buf );
+    char * begin = FormatInteger( val, end, std::integral_constant< bool, std::is_signed< IntT >::value >() );
+    return StringId( begin, static_cast< sint32 >( end - begin ));
+  }
+
+  // The shortest form which parses back to exactly val. Returns the length written.
+  template< typename FloatT >
+  inline size_t FormatFloating( FloatT val, char * buf ) {
+#ifdef TOOLS_HAS_FLOAT_CHARCONV
+    std::to_chars_result res = std::to_chars( buf, buf + formatBufferBytes, val );
+    TOOLS_ASSERT( res.ec == std::errc() );
+    return static_cast< size_t >( res.ptr - buf );
+#else // TOOLS_HAS_FLOAT_CHARCONV
+    if( val != val ) {
+      memcpy( buf, "nan", 4U );
+      return 3U;
+    }
+    int len = 0;
+    for( int precision = 1; precision <= std::numeric_limits< FloatT >::max_digits10; ++precision ) {
+      len = snprintf( buf, formatBufferBytes, "%.*g", precision, static_cast< double >( val ));
+      if( static_cast< FloatT >( strtod( buf, nullptr )) == val ) {
+        break;
+      }
+    }
+    return static_cast< size_t >( len );
+#endif // TOOLS_HAS_FLOAT_CHARCONV
+  }
+
+  template< typename FloatT >
+  inline StringId FloatingToStringId( FloatT val ) {
+    char buf[ formatBufferBytes ];
+    return StringId( buf, static_cast< sint32 >( FormatFloating( val, buf )));
+  }
+
+  enum ParseResult {
+    parseOk,
+    parseOutOfRange,
+    parseInvalid,
+  };
+
+  // Parse all of [str, str + len) as a decimal integer.
+  template< typename IntT >
+  inline ParseResult ParseInteger( char const * str, size_t len, IntT & out ) {
+    typedef typename std::make_unsigned< IntT >::type UIntT;
+    char const * end = str + len;
+    bool negative = ( str != end ) && ( *str == '-' );
+    if( negative ) {
+      ++str;
+    }
+    if( str == end ) {
+      return parseInvalid;
+    }
+    UIntT limit = static_cast< UIntT >( std::numeric_limits< IntT >::max() );
+    if( negative && std::is_signed< IntT >::value ) {
+      limit = static_cast< UIntT >( limit + 1U );
+    }
+    UIntT acc = 0U;
+    bool overflow = false;
+    for( ; str != end; ++str ) {
+      unsigned digit = static_cast< unsigned >( static_cast< unsigned char >( *str )) - '0';
+      if( digit > 9U ) {
+        return parseInvalid;
+      }
+      if( acc > static_cast< UIntT >(( limit - digit ) / 10U )) {
+        // Keep scanning, the rest may still not be an integer
+        overflow = true;
       } else {
-        switch( v.sizeOf() ) {
-          case 1:
-            return boost::numeric_cast< ToT >( boost::any_cast< uint8 >( v.value_ ) );
-          case 2:
-            return boost::numeric_cast< ToT >( boost::any_cast< uint16 >( v.value_ ) );
-          case 4:
-            return boost::numeric_cast< ToT >( boost::any_cast< uint32 >( v.value_ ) );
-          case 8:
-            return boost::numeric_cast< ToT >( boost::any_cast< uint64 >( v.value_ ) );
-          default:
-            break;
+        acc = static_cast< UIntT >(( acc * 10U ) + digit );
+      }
+    }
+    if( overflow || ( negative && !std::is_signed< IntT >::value && ( acc != 0U ))) {
+      return parseOutOfRange;
+    }
+    out = negative ? static_cast< IntT >( UIntT( 0 ) - acc ) : static_cast< IntT >( acc );
+    return parseOk;
+  }
+
+  // Parse all of [str, str + len) as a floating point number. str must be nul terminated at len.
+  inline bool ParseFloating( char const * str, size_t len, double & out ) {
+    if( len == 0U ) {
+      return false;
+    }
+#ifdef TOOLS_HAS_FLOAT_CHARCONV
+    std::from_chars_result res = std::from_chars( str, str + len, out );
+    return ( res.ec == std::errc() ) && ( res.ptr == str + len );
+#else // TOOLS_HAS_FLOAT_CHARCONV
+    if( isspace( static_cast< unsigned char >( *str ))) {
+      return false;
+    }
+    char * end = nullptr;
+    out = strtod( str, &end );
+    return end == str + len;
+#endif // TOOLS_HAS_FLOAT_CHARCONV
+  }
+
+  // The characters of a string-like Value (StringId, std::string or character pointer), without interning.
+  inline bool ValueChars( Value const & v, char const *& str, size_t & len ) {
+    switch( v.tag_ ) {
+    case impl::valueTagStringId:
+      {
+        StringId const & sid = *v.getIf< StringId >();
+        str = sid.c_str();
+        len = sid.length();
+        return !!str;
+      }
+    case impl::valueTagBoxed:
+      {
+        std::string const * stdStr = v.getIf< std::string >();
+        if( !stdStr ) {
+          return false;
         }
+        str = stdStr->c_str();
+        len = stdStr->size();
+        return true;
       }
-    } else if( v.isFloat() ) {
-      switch( v.sizeOf() ) {
-      case 4:
-        return boost::numeric_cast< ToT >( boost::any_cast< float >( v.value_ ) );
-      case 8:
-        return boost::numeric_cast< ToT >( boost::any_cast< double >( v.value_ ) );
-      default:
-        break;
+    case impl::valueTagPointer:
+      if( !v.isType< char const * >() && !v.isType< char * >() ) {
+        return false;
       }
+      str = static_cast< char const * >( v.storage_.pointer_ );
+      if( !str ) {
+        return false;
+      }
+      len = strlen( str );
+      return true;
+    default:
+      return false;
     }
-    //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( ToT ) );
-    return 0;
   }
 
+  // Integers parse as integers. Strings which are not integers parse as floating point, and then convert
+  // (truncating, as a floating point Value would).
   template< typename ToT >
-  ToT StringIdToScaler( StringId const & str ) {
-    // while I like that this will use existing scaler string deserialization, what I don't
-    // like is the lack of error information.  For example, if the string does not contain
-    // a serialized scaler
-    std::istringstream stream( str.c_str() );
-    ToT val;
-    stream >> val;
-    return val;
+  inline bool StringToScaler( char const * str, size_t len, ToT & ret, std::true_type /*integral*/ ) {
+    ParseResult res = ParseInteger( str, len, ret );
+    if( res != parseInvalid ) {
+      return res == parseOk;
+    }
+    double parsed;
+    return ParseFloating( str, len, parsed ) && NumericConvert( parsed, ret );
   }
-}; // anonymous namespace
 
-StringId
-tools::impl::ValueToStringId( Value const & v )
-{
-  try {
-    return boost::any_cast< StringId >( v.value_ );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  try {
-    return boost::any_cast< StringId const >( v.value_ );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  try {
-    std::string str( boost::any_cast< std::string >( v.value_ ) );
-    return StringId( str );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  try {
-    std::string const str( boost::any_cast< std::string const >( v.value_ ) );
-    return StringId( str );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  try {
-    char * str = boost::any_cast< char * >( v.value_ );
-    return StringId( str );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  try {
-    char const * str = boost::any_cast< char const * >( v.value_ );
-    return StringId( str );
-  }
-  catch( boost::bad_any_cast const & ) {}
-  // TODO: maybe serialize pointers?
-  if( v.isInteger() ) {
-    if( v.isSigned() ) {
-      switch( v.sizeOf() ) {
-      case 1:
-        {
-          sint8 val = boost::any_cast< sint8 >( v.value_ );
-          static boost::format fmt( "%d" );
-          return StringId( ( fmt % val ).str() );
-        }
+  template< typename ToT >
+  inline bool StringToScaler( char const * str, size_t len, ToT & ret, std::false_type /*integral*/ ) {
+    double parsed;
+    return ParseFloating( str, len, parsed ) && NumericConvert( parsed, ret );
+  }
+
+  // Scalers convert directly, strings are parsed. Returns false (with ret 0) for values which cannot be
+  // represented as ToT.
+  template< typename ToT >
+  inline bool ValueToScaler( Value const & v, ToT & ret ) {
+    ret = ToT();
+    bool converted;
+    if( IsScaler( v )) {
+      converted = ScalerConvert( v, ret );
+    } else {
+      char const * str;
+      size_t len;
+      converted = ValueChars( v, str, len ) && StringToScaler( str, len, ret, std::integral_constant< bool, std::is_integral< ToT >::value >() );
+    }
+    if( !converted ) {
+      ret = ToT();
+    }
+    return converted;
+  }
+
+  template< typename ToT >
+  inline ToT ValueToScaler( Value const & v ) {
+    ToT ret;
+    ValueToScaler( v, ret );
+    return ret;
+  }
+
+  // Runs of values with the same tag (the common case for a column) are converted by a loop specialized for
+  // that tag.
+  template< typename ToT, typename FromT >
+  inline size_t ScalerRun( Value const * values, size_t count, ToT * out, FromT Value::Storage::* member ) {
+    size_t ret = 0U;
+    for( size_t i = 0U; i != count; ++i ) {
+      if( NumericConvert( values[ i ].storage_.*member, out[ i ] )) {
+        ++ret;
+      } else {
+        out[ i ] = ToT();
+      }
+    }
+    return ret;
+  }
+
+  template< typename ToT >
+  size_t ValuesToScaler( Value const * values, size_t count, ToT * out ) {
+    size_t ret = 0U;
+    while( count != 0U ) {
+      impl::ValueTag tag = values->tag_;
+      size_t run = 1U;
+      while(( run != count ) && ( values[ run ].tag_ == tag )) {
+        ++run;
+      }
+      switch( tag ) {
+      case impl::valueTagSint8:
+        ret += ScalerRun( values, run, out, &Value::Storage::sint8_ );
         break;
-      case 2:
-        {
-          sint16 val = boost::any_cast< sint16 >( v.value_ );
-          static boost::format fmt( "%d" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagSint16:
+        ret += ScalerRun( values, run, out, &Value::Storage::sint16_ );
         break;
-      case 4:
-        {
-          sint32 val = boost::any_cast< sint32 >( v.value_ );
-          static boost::format fmt( "%d" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagSint32:
+        ret += ScalerRun( values, run, out, &Value::Storage::sint32_ );
         break;
-      case 8:
-        {
-          sint64 val = boost::any_cast< sint64 >( v.value_ );
-          static boost::format fmt( "%lld" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagSint64:
+        ret += ScalerRun( values, run, out, &Value::Storage::sint64_ );
         break;
-      default:
-        //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( StringId ) );
-        return StringIdNull();
-      }
-    } else {
-      switch( v.sizeOf() ) {
-      case 1:
-        {
-          uint8 val = boost::any_cast< uint8 >( v.value_ );
-          static boost::format fmt( "%u" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagUint8:
+        ret += ScalerRun( values, run, out, &Value::Storage::uint8_ );
         break;
-      case 2:
-        {
-          uint16 val = boost::any_cast< uint16 >( v.value_ );
-          static boost::format fmt( "%u" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagUint16:
+        ret += ScalerRun( values, run, out, &Value::Storage::uint16_ );
         break;
-      case 4:
-        {
-          uint32 val = boost::any_cast< uint32 >( v.value_ );
-          static boost::format fmt( "%u" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagUint32:
+        ret += ScalerRun( values, run, out, &Value::Storage::uint32_ );
         break;
-      case 8:
-        {
-          uint64 val = boost::any_cast< uint64 >( v.value_ );
-          static boost::format fmt( "%llu" );
-          return StringId( ( fmt % val ).str() );
-        }
+      case impl::valueTagUint64:
+        ret += ScalerRun( values, run, out, &Value::Storage::uint64_ );
+        break;
+      case impl::valueTagFloat:
+        ret += ScalerRun( values, run, out, &Value::Storage::float_ );
+        break;
+      case impl::valueTagDouble:
+        ret += ScalerRun( values, run, out, &Value::Storage::double_ );
         break;
       default:
-        //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( StringId ) );
-        return StringIdNull();
+        for( size_t i = 0U; i != run; ++i ) {
+          if( ValueToScaler( values[ i ], out[ i ] )) {
+            ++ret;
+          }
+        }
+        break;
       }
+      values += run;
+      out += run;
+      count -= run;
     }
-  } else if( v.isFloat() ) {
-    switch( v.sizeOf() ) {
-    case 32:
-      {
-        float val = boost::any_cast< float >( v.value_ );
-        static boost::format fmt( "%f" );
-        return StringId( ( fmt % val ).str() );
-      }
-      break;
-    case 64:
-      {
-        double val = boost::any_cast< double >( v.value_ );
-        static boost::format fmt( "%lf" );
-        return StringId( ( fmt % val ).str() );
+    return ret;
+  }
+}; // anonymous namespace
+
+StringId
+tools::impl::ValueToStringId( Value const & v )
+{
+  switch( v.tag_ ) {
+  case valueTagStringId:
+    return *v.getIf< StringId >();
+  case valueTagBoxed:
+    {
+      std::string const * str = v.getIf< std::string >();
+      if( !!str ) {
+        return StringId( *str );
       }
-      break;
-    default:
-      //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( StringId ) );
-      return StringIdNull();
     }
+    break;
+  case valueTagPointer:
+    if( v.isType< char const * >() || v.isType< char * >() ) {
+      return StringId( static_cast< char const * >( v.storage_.pointer_ ));
+    }
+    // TODO: maybe serialize pointers?
+    break;
+  case valueTagBool:
+    return v.storage_.bool_ ? TOOLS_SID( "true" ) : TOOLS_SID( "false" );
+  case valueTagSint8:
+    return IntegerToStringId( v.storage_.sint8_ );
+  case valueTagSint16:
+    return IntegerToStringId( v.storage_.sint16_ );
+  case valueTagSint32:
+    return IntegerToStringId( v.storage_.sint32_ );
+  case valueTagSint64:
+    return IntegerToStringId( v.storage_.sint64_ );
+  case valueTagUint8:
+    return IntegerToStringId( v.storage_.uint8_ );
+  case valueTagUint16:
+    return IntegerToStringId( v.storage_.uint16_ );
+  case valueTagUint32:
+    return IntegerToStringId( v.storage_.uint32_ );
+  case valueTagUint64:
+    return IntegerToStringId( v.storage_.uint64_ );
+  case valueTagFloat:
+    return FloatingToStringId( v.storage_.float_ );
+  case valueTagDouble:
+    return FloatingToStringId( v.storage_.double_ );
+  default:
+    break;
   }
   // TODO: more string serialization?
   //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( StringId ) );
   return StringIdNull();
 }
 
+namespace {
+  // Scalers are true when not 0. Strings must be 1 or 0, or true/false or yes/no in any case. Returns false
+  // (with ret false) for anything else.
+  bool BoolConvert( Value const & v, bool & ret ) {
+    ret = false;
+    switch( v.tag_ ) {
+    case impl::valueTagBool:
+      ret = v.storage_.bool_;
+      return true;
+    case impl::valueTagSint8:
+      ret = v.storage_.sint8_ != 0;
+      return true;
+    case impl::valueTagSint16:
+      ret = v.storage_.sint16_ != 0;
+      return true;
+    case impl::valueTagSint32:
+      ret = v.storage_.sint32_ != 0;
+      return true;
+    case impl::valueTagSint64:
+      ret = v.storage_.sint64_ != 0;
+      return true;
+    case impl::valueTagUint8:
+      ret = v.storage_.uint8_ != 0U;
+      return true;
+    case impl::valueTagUint16:
+      ret = v.storage_.uint16_ != 0U;
+      return true;
+    case impl::valueTagUint32:
+      ret = v.storage_.uint32_ != 0U;
+      return true;
+    case impl::valueTagUint64:
+      ret = v.storage_.uint64_ != 0U;
+      return true;
+    case impl::valueTagFloat:
+      ret = v.storage_.float_ != 0.0f;
+      return true;
+    case impl::valueTagDouble:
+      ret = v.storage_.double_ != 0.0;
+      return true;
+    default:
+      break;
+    }
+    tools::StringId valSid = impl::ValueToStringId( v );
+    static const tools::StringId oneId( tools::StaticStringId( "1" ) );
+    static const tools::StringId zeroId( tools::StaticStringId( "0" ) );
+    if( ( valSid == oneId ) || ( valSid.compareToIgnoreCase( "true" ) == 0 ) || ( valSid.compareToIgnoreCase( "yes" ) == 0 )) {
+      ret = true;
+      return true;
+    }
+    //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( bool ) );
+    return ( valSid == zeroId ) || ( valSid.compareToIgnoreCase( "false" ) == 0 ) || ( valSid.compareToIgnoreCase( "no" ) == 0 );
+  }
+}; // anonymous namespace
+
 bool
 tools::impl::ValueToBool( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< sint16 >( v ) != 0;
-  }
-  // TODO: implement this
-  tools::StringId valSid = ValueToStringId( v );
-  static const tools::StringId oneId( tools::StaticStringId( "1" ) );
-  static const tools::StringId zeroId( tools::StaticStringId( "0" ) );
-  if( valSid == oneId ) {
-    return true;
-  } else if( valSid == zeroId ) {
-    return false;
-  } else if( valSid.compareToIgnoreCase( "true" ) == 0 ) {
-    return true;
-  } else if( valSid.compareToIgnoreCase( "false" ) == 0 ) {
-    return false;
-  } else if( valSid.compareToIgnoreCase( "yes" ) == 0 ) {
-    return true;
-  } else if( valSid.compareToIgnoreCase( "no" ) == 0 ) {
-    return false;
-  }
-  //throw ValueException( v.typeName(), TOOLS_TYPE_NAME( bool ) );
-  return false;
+  bool ret;
+  BoolConvert( v, ret );
+  return ret;
 }
 
 sint8
 tools::impl::ValueToSint8( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< sint8 >( v );
-  }
-  // we use sint16 to avoid confusion with char
-  return boost::numeric_cast< sint8 >( StringIdToScaler< sint16 >( ValueToStringId( v ) ) );
+  return ValueToScaler< sint8 >( v );
 }
 
 sint16
 tools::impl::ValueToSint16( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< sint16 >( v );
-  }
-  return StringIdToScaler< sint16 >( ValueToStringId( v ) );
+  return ValueToScaler< sint16 >( v );
 }
 
 sint32
 tools::impl::ValueToSint32( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< sint32 >( v );
-  }
-  return StringIdToScaler< sint32 >( ValueToStringId( v ) );
+  return ValueToScaler< sint32 >( v );
 }
 
 sint64
 tools::impl::ValueToSint64( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< sint64 >( v );
-  }
-  return StringIdToScaler< sint64 >( ValueToStringId( v ) );
+  return ValueToScaler< sint64 >( v );
 }
 
 uint8
 tools::impl::ValueToUint8( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< uint8 >( v );
-  }
-  // we use uint16 so as not to confuse it with char
-  return boost::numeric_cast< uint8 >( StringIdToScaler< uint16 >( ValueToStringId( v ) ) );
+  return ValueToScaler< uint8 >( v );
 }
 
 uint16
 tools::impl::ValueToUint16( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< uint16 >( v );
-  }
-  return StringIdToScaler< uint16 >( ValueToStringId( v ) );
+  return ValueToScaler< uint16 >( v );
 }
 
 uint32
 tools::impl::ValueToUint32( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< uint32 >( v );
-  }
-  return StringIdToScaler< uint32 >( ValueToStringId( v ) );
+  return ValueToScaler< uint32 >( v );
 }
 
 uint64
 tools::impl::ValueToUint64( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< uint64 >( v );
-  }
-  return StringIdToScaler< uint64 >( ValueToStringId( v ) );
+  return ValueToScaler< uint64 >( v );
 }
 
 float
 tools::impl::ValueToFloat( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< float >( v );
-  }
-  return StringIdToScaler< float >( ValueToStringId( v ) );
+  return ValueToScaler< float >( v );
 }
 
 double
 tools::impl::ValueToDouble( Value const & v )
 {
-  if( v.isInteger() || v.isFloat() ) {
-    return ScalerConvert< double >( v );
+  return ValueToScaler< double >( v );
+}
+
+size_t
+tools::impl::ValuesToStringId( Value const * values, size_t count, StringId * out )
+{
+  size_t ret = 0U;
+  for( size_t i = 0U; i != count; ++i ) {
+    out[ i ] = ValueToStringId( values[ i ] );
+    if( !!out[ i ] ) {
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+size_t
+tools::impl::ValuesToBool( Value const * values, size_t count, bool * out )
+{
+  size_t ret = 0U;
+  for( size_t i = 0U; i != count; ++i ) {
+    if( BoolConvert( values[ i ], out[ i ] )) {
+      ++ret;
+    }
   }
-  return StringIdToScaler< double >( ValueToStringId( v ) );
+  return ret;
+}
+
+size_t
+tools::impl::ValuesToSint8( Value const * values, size_t count, sint8 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToSint16( Value const * values, size_t count, sint16 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToSint32( Value const * values, size_t count, sint32 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToSint64( Value const * values, size_t count, sint64 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToUint8( Value const * values, size_t count, uint8 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToUint16( Value const * values, size_t count, uint16 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToUint32( Value const * values, size_t count, uint32 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToUint64( Value const * values, size_t count, uint64 * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToFloat( Value const * values, size_t count, float * out )
+{
+  return ValuesToScaler( values, count, out );
+}
+
+size_t
+tools::impl::ValuesToDouble( Value const * values, size_t count, double * out )
+{
+  return ValuesToScaler( values, count, out );
 }
 
 // unit tests for Value functionality
 #if TOOLS_UNIT_TEST
 
+#include <tools/AlgorithmsTools.h>
+#include <tools/Timing.h>
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace {
+  struct ValueTestThing {
+    ValueTestThing( uint32 a, uint32 b ) : a_( a ), b_( b ) {}
+    bool operator==( ValueTestThing const & r ) const { return ( a_ == r.a_ ) && ( b_ == r.b_ ); }
+    uint32 a_;
+    uint32 b_;
+  };
+}; // anonymous namespace
+
+TOOLS_TEST_CASE("Value.storage", [](Test &)
+{
+  // Scalars, StringIds, pointers and small plain types are held inline
+  TOOLS_ASSERTR(Value().tag() == impl::valueTagVoid);
+  TOOLS_ASSERTR(Value(true).tag() == impl::valueTagBool);
+  TOOLS_ASSERTR(Value(static_cast<sint16>(-3)).tag() == impl::valueTagSint16);
+  TOOLS_ASSERTR(Value(7U).tag() == impl::valueTagUint32);
+  TOOLS_ASSERTR(Value(1.5).tag() == impl::valueTagDouble);
+  TOOLS_ASSERTR(Value(StringId("TestValue string")).tag() == impl::valueTagStringId);
+  TOOLS_ASSERTR(Value("TestValue chars").tag() == impl::valueTagPointer);
+  TOOLS_ASSERTR(Value(ValueTestThing(1U, 2U)).tag() == impl::valueTagInline);
+  TOOLS_ASSERTR(Value(std::string("TestValue std::string")).tag() == impl::valueTagBoxed);
+  // Type queries are unchanged
+  Value v(static_cast<sint64>(-5));
+  TOOLS_ASSERTR(v.isInteger() && v.isSigned() && !v.isFloat() && !v.isPointer() && (v.sizeOf() == 8U));
+  TOOLS_ASSERTR(v.typeName() == tools::nameOf<sint64>());
+  TOOLS_ASSERTR(Value(2.0f).isFloat());
+  TOOLS_ASSERTR(Value().isVoid());
+  static_assert(std::is_nothrow_move_constructible<Value>::value, "Value moves must not throw");
+  static_assert(std::is_nothrow_move_assignable<Value>::value, "Value moves must not throw");
+  // Copies, moves and reassignment keep what they hold
+  Value thing(ValueTestThing(3U, 4U));
+  Value boxed(std::string("TestValue boxed"));
+  Value sid(StringId("TestValue sid"));
+  Value copy(boxed);
+  TOOLS_ASSERTR(*copy.getIf<std::string>() == "TestValue boxed");
+  TOOLS_ASSERTR(copy.getIf<std::string>() != boxed.getIf<std::string>());
+  Value moved(std::move(copy));
+  TOOLS_ASSERTR(copy.isVoid());
+  TOOLS_ASSERTR(*moved.getIf<std::string>() == "TestValue boxed");
+  moved = sid;
+  TOOLS_ASSERTR(*moved.getIf<StringId>() == "TestValue sid");
+  moved = thing;
+  TOOLS_ASSERTR(*moved.getIf<ValueTestThing>() == ValueTestThing(3U, 4U));
+  TOOLS_ASSERTR(!moved.getIf<std::string>());
+  boxed.set(*boxed.getIf<std::string>() + " again");
+  TOOLS_ASSERTR(*boxed.getIf<std::string>() == "TestValue boxed again");
+  int target = 0;
+  Value ptr(&target);
+  TOOLS_ASSERTR(interpret_cast<int *>(ptr) == &target);
+  TOOLS_ASSERTR(!interpret_cast<long *>(ptr));
+});
+
+TOOLS_TEST_CASE("Value.conversions", [](Test &)
+{
+  // Scalers
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value(static_cast<uint8>(200))) == 200);
+  TOOLS_ASSERTR(interpret_cast<uint64>(Value(42.0)) == 42U);
+  TOOLS_ASSERTR(interpret_cast<double>(Value(-3)) == -3.0);
+  TOOLS_ASSERTR(interpret_cast<sint16>(Value(true)) == 1);
+  TOOLS_ASSERTR(interpret_cast<bool>(Value(0.0)) == false);
+  TOOLS_ASSERTR(interpret_cast<bool>(Value(static_cast<uint64>(1ULL << 40))));
+  // Out of range gives 0 rather than throwing
+  TOOLS_ASSERTR(interpret_cast<uint8>(Value(300)) == 0U);
+  TOOLS_ASSERTR(interpret_cast<uint32>(Value(-1)) == 0U);
+  TOOLS_ASSERTR(interpret_cast<sint8>(Value(1e10)) == 0);
+  TOOLS_ASSERTR(interpret_cast<sint64>(Value(std::numeric_limits<double>::quiet_NaN())) == 0);
+  TOOLS_ASSERTR(interpret_cast<sint8>(Value(-128)) == -128);
+  TOOLS_ASSERTR(interpret_cast<uint64>(Value(std::numeric_limits<uint64>::max())) == std::numeric_limits<uint64>::max());
+  TOOLS_ASSERTR(interpret_cast<float>(Value(1e300)) == 0.0f);
+  TOOLS_ASSERTR(interpret_cast<float>(Value(-1e300)) == 0.0f);
+  TOOLS_ASSERTR(interpret_cast<float>(Value("1e39")) == 0.0f);
+  TOOLS_ASSERTR(interpret_cast<float>(Value(static_cast<double>(std::numeric_limits<float>::max()))) == std::numeric_limits<float>::max());
+  TOOLS_ASSERTR(interpret_cast<float>(Value(-std::numeric_limits<double>::infinity())) == -std::numeric_limits<float>::infinity());
+  TOOLS_ASSERTR(isnan(interpret_cast<float>(Value(std::numeric_limits<double>::quiet_NaN()))));
+  // Strings
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value(StringId("-17"))) == -17);
+  TOOLS_ASSERTR(interpret_cast<uint8>(Value(std::string("250"))) == 250U);
+  TOOLS_ASSERTR(interpret_cast<uint8>(Value("260")) == 0U);
+  TOOLS_ASSERTR(interpret_cast<double>(Value("2.5")) == 2.5);
+  TOOLS_ASSERTR(interpret_cast<bool>(Value("Yes")));
+  TOOLS_ASSERTR(!interpret_cast<bool>(Value(StringId("false"))));
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(-12)) == "-12");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(static_cast<uint64>(12345678901ULL))) == "12345678901");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(static_cast<sint8>(-3))) == "-3");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(true)) == "true");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(0.5f)) == "0.5");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::string("TestValue std::string"))) == "TestValue std::string");
+  // Anything else
+  TOOLS_ASSERTR(!interpret_cast<StringId>(Value(ValueTestThing(1U, 2U))));
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value()) == 0);
+  TOOLS_ASSERTR(interpret_cast<ValueTestThing>(Value(ValueTestThing(5U, 6U))) == ValueTestThing(5U, 6U));
+  TOOLS_ASSERTR(interpret_cast<std::string>(Value(7)).empty());
+});
+
+TOOLS_TEST_CASE("Value.format", [](Test &)
+{
+  // Integer limits of every width
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<sint8>::min())) == "-128");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<sint16>::min())) == "-32768");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<sint32>::min())) == "-2147483648");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<sint64>::min())) == "-9223372036854775808");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<sint64>::max())) == "9223372036854775807");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<uint8>::max())) == "255");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(std::numeric_limits<uint64>::max())) == "18446744073709551615");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(0U)) == "0");
+  // Integers round trip through their strings
+  AutoDispose<RandomState> rng(randomStateNew(0x5EEDU));
+  for (unsigned i = 0U; i != 10000U; ++i) {
+    sint64 val = static_cast<sint64>(rng->rndU64()) >> (i % 64U);
+    StringId str(interpret_cast<StringId>(Value(val)));
+    TOOLS_ASSERTR(interpret_cast<sint64>(Value(str)) == val);
+    std::ostringstream expected;
+    expected << val;
+    TOOLS_ASSERTR(str == expected.str());
+  }
+  // Floating point is the shortest string which parses back to the same value
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(0.1)) == "0.1");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(0.1f)) == "0.1");
+  TOOLS_ASSERTR(interpret_cast<StringId>(Value(-2.0)) == "-2");
+  for (unsigned i = 0U; i != 10000U; ++i) {
+    uint64 bits = rng->rndU64();
+    double val;
+    memcpy(&val, &bits, sizeof(val));
+    if (val != val) {
+      continue;
+    }
+    StringId str(interpret_cast<StringId>(Value(val)));
+    TOOLS_ASSERTR(str.length() <= 24U);
+    TOOLS_ASSERTR(interpret_cast<double>(Value(str)) == val);
+    float single = static_cast<float>(static_cast<sint32>(bits)) / 1024.0f;
+    TOOLS_ASSERTR(interpret_cast<float>(Value(interpret_cast<StringId>(Value(single)))) == single);
+  }
+});
+
+TOOLS_TEST_CASE("Value.parse", [](Test &)
+{
+  TOOLS_ASSERTR(interpret_cast<sint8>(Value("-128")) == -128);
+  TOOLS_ASSERTR(interpret_cast<sint8>(Value("127")) == 127);
+  TOOLS_ASSERTR(interpret_cast<sint8>(Value("128")) == 0);
+  TOOLS_ASSERTR(interpret_cast<uint64>(Value("18446744073709551615")) == std::numeric_limits<uint64>::max());
+  TOOLS_ASSERTR(interpret_cast<uint64>(Value("18446744073709551616")) == 0U);
+  TOOLS_ASSERTR(interpret_cast<sint64>(Value("-9223372036854775808")) == std::numeric_limits<sint64>::min());
+  TOOLS_ASSERTR(interpret_cast<sint64>(Value("-9223372036854775809")) == 0);
+  TOOLS_ASSERTR(interpret_cast<uint32>(Value("-1")) == 0U);
+  // Partial or empty strings are not numbers
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value("")) == 0);
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value("-")) == 0);
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value("12abc")) == 0);
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value(" 12")) == 0);
+  TOOLS_ASSERTR(interpret_cast<double>(Value("1.5x")) == 0.0);
+  // Floating point strings convert to integers as floating point Values would
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value("2.75")) == 2);
+  TOOLS_ASSERTR(interpret_cast<sint32>(Value("1e3")) == 1000);
+  TOOLS_ASSERTR(interpret_cast<uint8>(Value("1e3")) == 0U);
+  TOOLS_ASSERTR(interpret_cast<double>(Value(std::string("-0.25"))) == -0.25);
+  TOOLS_ASSERTR(interpret_cast<float>(Value(StringId("3.5e2"))) == 350.0f);
+});
+
+TOOLS_TEST_CASE("Value.column", [](Test &)
+{
+  std::vector<Value> values;
+  for (sint32 i = 0; i != 100; ++i) {
+    values.push_back(Value(i));
+  }
+  values.push_back(Value(1000));
+  values.push_back(Value(static_cast<uint8>(7)));
+  values.push_back(Value(2.5));
+  values.push_back(Value("42"));
+  values.push_back(Value("nope"));
+  values.push_back(Value(ValueTestThing(1U, 2U)));
+  std::vector<uint8> bytes(values.size());
+  TOOLS_ASSERTR(interpretColumn(values.data(), values.size(), bytes.data()) == 103U);
+  for (size_t i = 0U; i != 100U; ++i) {
+    TOOLS_ASSERTR(bytes[i] == i);
+  }
+  TOOLS_ASSERTR(bytes[100] == 0U);
+  TOOLS_ASSERTR(bytes[101] == 7U);
+  TOOLS_ASSERTR(bytes[102] == 2U);
+  TOOLS_ASSERTR(bytes[103] == 42U);
+  TOOLS_ASSERTR((bytes[104] == 0U) && (bytes[105] == 0U));
+  std::vector<double> doubles(values.size());
+  TOOLS_ASSERTR(interpretColumn(values.data(), values.size(), doubles.data()) == 104U);
+  TOOLS_ASSERTR((doubles[99] == 99.0) && (doubles[102] == 2.5) && (doubles[103] == 42.0));
+  std::vector<StringId> strings(values.size());
+  TOOLS_ASSERTR(interpretColumn(values.data(), values.size(), strings.data()) == 105U);
+  TOOLS_ASSERTR((strings[100] == "1000") && (strings[104] == "nope") && !strings[105]);
+  // Only scalers and the recognised strings count as booleans
+  bool flags[106];
+  TOOLS_ASSERTR(values.size() == 106U);
+  TOOLS_ASSERTR(interpretColumn(values.data(), values.size(), flags) == 103U);
+  TOOLS_ASSERTR(!flags[0] && flags[1] && flags[102] && !flags[103] && !flags[104] && !flags[105]);
+  // Matches the single value conversions
+  for (size_t i = 0U; i != values.size(); ++i) {
+    TOOLS_ASSERTR(bytes[i] == interpret_cast<uint8>(values[i]));
+    TOOLS_ASSERTR(strings[i] == interpret_cast<StringId>(values[i]));
+  }
+});
+
+TOOLS_TEST_CASE("Value.format.throughput", [](Test & test)
+{
+  static const unsigned count = 4096U;
+  static const unsigned rounds = 64U;
+  auto timing = test.environment().unmockNow<Timing>();
+  AutoDispose<RandomState> rng(randomStateNew(0x5EEDU));
+  std::vector<Value> ints;
+  std::vector<Value> doubles;
+  std::vector<Value> intStrings;
+  for (unsigned i = 0U; i != count; ++i) {
+    sint64 val = static_cast<sint64>(rng->rndU64()) >> (i % 48U);
+    ints.push_back(Value(val));
+    doubles.push_back(Value(static_cast<double>(val) / 1000.0));
+    intStrings.push_back(Value(interpret_cast<StringId>(Value(val))));
+  }
+  size_t volatile sink = 0U;
+  // The previous implementation: a boost::format (shared, racy as a static) and a std::string per value.
+  uint64 start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    for (auto && v : ints) {
+      boost::format fmt("%lld");
+      sink = sink + StringId((fmt % v.storage_.sint64_).str()).length();
+    }
+  }
+  uint64 legacyFormat = timing->mark(start);
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    for (auto && v : ints) {
+      sink = sink + interpret_cast<StringId>(v).length();
+    }
+  }
+  uint64 format = timing->mark(start);
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    for (auto && v : doubles) {
+      sink = sink + interpret_cast<StringId>(v).length();
+    }
+  }
+  uint64 formatDouble = timing->mark(start);
+  // The previous parse: a std::istringstream per value
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    for (auto && v : intStrings) {
+      std::istringstream stream(v.getIf<StringId>()->c_str());
+      sint64 val;
+      stream >> val;
+      sink = sink + static_cast<size_t>(val);
+    }
+  }
+  uint64 legacyParse = timing->mark(start);
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    for (auto && v : intStrings) {
+      sink = sink + static_cast<size_t>(interpret_cast<sint64>(v));
+    }
+  }
+  uint64 parse = timing->mark(start);
+  std::vector<sint64> column(count);
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    sink = sink + interpretColumn(ints.data(), count, column.data());
+  }
+  uint64 columnInts = timing->mark(start);
+  start = timing->mark();
+  for (unsigned r = 0U; r != rounds; ++r) {
+    sink = sink + interpretColumn(intStrings.data(), count, column.data());
+  }
+  uint64 columnStrings = timing->mark(start);
+  if (testTimingsReported()) {
+    double conversions = static_cast<double>(count) * static_cast<double>(rounds);
+    fprintf(stderr, "Value format sint64: %.2f ns (boost::format %.2f ns), double: %.2f ns\n", static_cast<double>(format) / conversions,
+      static_cast<double>(legacyFormat) / conversions, static_cast<double>(formatDouble) / conversions);
+    fprintf(stderr, "Value parse sint64: %.2f ns (istringstream %.2f ns)\n", static_cast<double>(parse) / conversions,
+      static_cast<double>(legacyParse) / conversions);
+    fprintf(stderr, "Value column sint64 from sint64: %.2f ns, from strings: %.2f ns\n", static_cast<double>(columnInts) / conversions,
+      static_cast<double>(columnStrings) / conversions);
+  }
+  // Stack buffers against a std::string (and a stream or boost::format) per value
+  TOOLS_ASSERTR(format < legacyFormat);
+  TOOLS_ASSERTR(parse < legacyParse);
+  TOOLS_ASSERTR(columnInts < columnStrings);
+});
+
+TOOLS_TEST_CASE("Value.benchmark", [](Test & test)
+{
+  static const unsigned iterations = 1000000U;
+  auto timing = test.environment().unmockNow<Timing>();
+  Value values[] = {
+    Value(static_cast<uint8>(7)), Value(-123456), Value(static_cast<uint64>(1ULL << 40)), Value(2.5),
+    Value(StringId("12345")), Value(std::string("-42")), Value("3.25"),
+  };
+  char const * names[] = { "uint8", "sint32", "uint64", "double", "StringId", "std::string", "char const *" };
+  uint64 toInts[sizeof(values) / sizeof(values[0])];
+  for (size_t i = 0U; i != sizeof(values) / sizeof(values[0]); ++i) {
+    Value const & v = values[i];
+    sint64 volatile intSink = 0;
+    double volatile floatSink = 0.0;
+    bool volatile boolSink = false;
+    uint64 start = timing->mark();
+    for (unsigned j = 0U; j != iterations; ++j) {
+      intSink = interpret_cast<sint64>(v);
+    }
+    uint64 toInt = timing->mark(start);
+    start = timing->mark();
+    for (unsigned j = 0U; j != iterations; ++j) {
+      floatSink = interpret_cast<double>(v);
+    }
+    uint64 toDouble = timing->mark(start);
+    start = timing->mark();
+    for (unsigned j = 0U; j != iterations; ++j) {
+      boolSink = interpret_cast<bool>(v);
+    }
+    uint64 toBool = timing->mark(start);
+    unsigned stringIterations = iterations / 10U;
+    start = timing->mark();
+    for (unsigned j = 0U; j != stringIterations; ++j) {
+      StringId sid(interpret_cast<StringId>(v));
+      boolSink = !sid;
+    }
+    uint64 toStringId = timing->mark(start);
+    start = timing->mark();
+    for (unsigned j = 0U; j != iterations; ++j) {
+      Value copy(v);
+      boolSink = copy.isVoid();
+    }
+    uint64 copies = timing->mark(start);
+    toInts[i] = toInt;
+    if (testTimingsReported()) {
+      fprintf(stderr, "Value %s: sint64 %.2f ns, double %.2f ns, bool %.2f ns, StringId %.2f ns, copy %.2f ns\n", names[i],
+        static_cast<double>(toInt) / static_cast<double>(iterations), static_cast<double>(toDouble) / static_cast<double>(iterations),
+        static_cast<double>(toBool) / static_cast<double>(iterations), static_cast<double>(toStringId) / static_cast<double>(stringIterations),
+        static_cast<double>(copies) / static_cast<double>(iterations));
+    }
+  }
+  // Scalers convert with a switch, strings have to be parsed
+  TOOLS_ASSERTR(*std::max_element(toInts, toInts + 4) < *std::min_element(toInts + 4, toInts + 7));
+});
+
 #endif /* TOOLS_UNIT_TEST != 0 */
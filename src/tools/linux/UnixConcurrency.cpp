@@ -22,6 +22,14 @@
 
 #include <linux/futex.h>
 
+// Restartable sequences (for per-CPU counters) need the glibc registration (2.35+) and x86-64 assembly.
+#if defined( __x86_64__ ) && defined( __has_include )
+#  if __has_include( <sys/rseq.h> )
+#    include <sys/rseq.h>
+#    define TOOLS_HAS_RSEQ 1
+#  endif
+#endif
+
 using namespace tools;
 
 typedef void * ( *EntryPointT )( void * );
@@ -74,8 +82,12 @@ namespace {
         // ConditionVar
         AutoDispose< Monitor > monitorNew( impl::ResourceSample const & );
         void wait( void );
+        void wait( uint64 );
         void signal( bool );
 
+        // local methods
+        void waitInner( timespec const * );
+
         pthread_cond_t cvar_;
     };
 
@@ -313,6 +325,68 @@ namespace tools {
             return static_cast< uint32 >( sched_getcpu() );
         }
 
+        uint32
+        cpuCount( void )
+        {
+            static uint32 count = 0U;
+            if( !count ) {
+                long conf = sysconf( _SC_NPROCESSORS_CONF );
+                long online = sysconf( _SC_NPROCESSORS_ONLN );
+                count = static_cast< uint32 >( std::max( std::max( conf, online ), 1L ));
+            }
+            return count;
+        }
+
+        bool
+        cpuLocalAdd(
+            uint64 volatile * slots,
+            size_t stride,
+            unsigned slotCount,
+            uint64 delta )
+        {
+#ifdef TOOLS_HAS_RSEQ
+            // glibc registers every thread's rseq area, unless that has been disabled by tunable.
+            if( TOOLS_UNLIKELY( __rseq_size == 0U )) {
+                return false;
+            }
+            struct rseq * area = reinterpret_cast< struct rseq * >( static_cast< char * >( __builtin_thread_pointer() ) + __rseq_offset );
+            // The critical section is from 1 to 2, with the commit being the single add. If we are
+            // preempted, migrated or signaled before the add, the kernel sends us to 4, which must be
+            // preceded by the RSEQ_SIG glibc registered with. An unregistered cpu_id is ~0, which fails the
+            // bounds check.
+            __asm__ __volatile__ goto (
+                ".pushsection __rseq_cs, \"aw\"\n\t"
+                ".balign 32\n\t"
+                "3:\n\t"
+                ".long 0x0, 0x0\n\t"
+                ".quad 1f, (2f - 1f), 4f\n\t"
+                ".popsection\n\t"
+                "leaq 3b(%%rip), %%rax\n\t"
+                "movq %%rax, %[rseqCs]\n\t"
+                "1:\n\t"
+                "movl %[cpuId], %%eax\n\t"
+                "cmpl %[slotCount], %%eax\n\t"
+                "jae %l[abort]\n\t"
+                "imulq %[stride], %%rax\n\t"
+                "addq %[delta], (%[slots], %%rax)\n\t"
+                "2:\n\t"
+                ".pushsection __rseq_failure, \"ax\"\n\t"
+                ".byte 0x0f, 0xb9, 0x3d\n\t"
+                ".long 0x53053053\n\t"
+                "4:\n\t"
+                "jmp %l[abort]\n\t"
+                ".popsection\n\t"
+                :
+                : [cpuId] "m" ( area->cpu_id ), [rseqCs] "m" ( area->rseq_cs ), [slotCount] "r" ( slotCount ),
+                  [stride] "r" ( stride ), [delta] "r" ( delta ), [slots] "r" ( slots )
+                : "memory", "cc", "rax"
+                : abort );
+            return true;
+        abort:
+#endif // TOOLS_HAS_RSEQ
+            return false;
+        }
+
         unsigned
         platformStackCount( void )
         {
@@ -596,7 +670,12 @@ PthreadMutexMonitor::enter(
 
 PthreadCvar::PthreadCvar( void )
 {
-    pthread_cond_init( &cvar_, nullptr );
+    // Timed waits are measured on the monotonic clock, so that setting the wall clock doesn't move them.
+    pthread_condattr_t attr;
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &cvar_, &attr );
+    pthread_condattr_destroy( &attr );
 }
 
 PthreadCvar::~PthreadCvar( void )
@@ -613,6 +692,25 @@ PthreadCvar::monitorNew(
 
 void
 PthreadCvar::wait( void )
+{
+    waitInner( nullptr );
+}
+
+void
+PthreadCvar::wait(
+    uint64 timeout )
+{
+    timespec until;
+    clock_gettime( CLOCK_MONOTONIC, &until );
+    uint64 nsec = static_cast< uint64 >( until.tv_nsec ) + ( timeout % TOOLS_NANOSECONDS_PER_SECOND );
+    until.tv_sec += static_cast< time_t >(( timeout / TOOLS_NANOSECONDS_PER_SECOND ) + ( nsec / TOOLS_NANOSECONDS_PER_SECOND ));
+    until.tv_nsec = static_cast< long >( nsec % TOOLS_NANOSECONDS_PER_SECOND );
+    waitInner( &until );
+}
+
+void
+PthreadCvar::waitInner(
+    timespec const * until )
 {
     impl::ConditionVarLock ** cvarMonitor = impl::conditionVarPlatformLockRef( this );
     impl::ConditionVarLock * lockVal = *cvarMonitor;
@@ -621,7 +719,11 @@ PthreadCvar::wait( void )
     TOOLS_ASSERT( !!lock );
     *cvarMonitor = nullptr;
     lockVal->lock_ = nullptr;
-    pthread_cond_wait( &cvar_, &static_cast< PthreadMutexMonitor * >( lockVal->monitor_ )->lock_ );
+    if( !!until ) {
+        pthread_cond_timedwait( &cvar_, &static_cast< PthreadMutexMonitor * >( lockVal->monitor_ )->lock_, until );
+    } else {
+        pthread_cond_wait( &cvar_, &static_cast< PthreadMutexMonitor * >( lockVal->monitor_ )->lock_ );
+    }
     TOOLS_ASSERT( !lockVal->lock_ );
     lockVal->lock_ = lock;
     TOOLS_ASSERT( !*cvarMonitor );
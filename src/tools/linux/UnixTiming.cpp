@@ -2,16 +2,28 @@
 
 #include <tools/InterfaceTools.h>
 #include <tools/Async.h>
+#include <tools/AtomicCollections.h>
+#include <tools/Concurrency.h>
 #include <tools/Timing.h>
 
 #include "../TimingImpl.h"
 
 #include <boost/cast.hpp>
 
+#include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 #include <pthread.h>
 
+// Reading the TSC directly needs x86-64 (the conversions multiply and divide in 128 bits) and the GCC
+// cpuid header.
+#if defined( __x86_64__ )
+#  include <cpuid.h>
+#  include <x86intrin.h>
+#  define TOOLS_HAS_TSC 1
+#endif
+
 using namespace tools;
 using boost::numeric_cast;
 
@@ -52,25 +64,69 @@ struct TimingImpl
     // Timing
     uint64 mark( void );
     uint64 mark( uint64 );
-    AutoDispose< Request > timer( uint64, uint64 * );
+    AutoDispose< Timer > timer( uint64, uint64 *, uint64 );
+    TimingStats stats( void );
 
     AutoDispose< PosixTimerThread > ptimer_;
     unsigned ncpu_;
     unsigned coreMax_;
 };
 
+#ifdef TOOLS_HAS_TSC
+enum : unsigned {
+    tscUnknown,  // not yet looked at
+    tscCalibrating,  // anchored, but the OS clock is used until enough time has passed to measure the rate
+    tscRunning,
+    tscUnavailable,  // not invariant, or not trusted by the kernel
+};
+
+// The TSC mapped on to CLOCK_MONOTONIC as base_ + ((tsc - tscBase_) * mult_) >> tscShift.
+struct TscParams
+{
+    uint64 tscBase_;
+    uint64 base_;
+    uint64 mult_;
+};
+
+// The TSC is read without a system call. Its rate is measured against CLOCK_MONOTONIC over the first 10 ms,
+// then again each second. Any error found at a resync is slewed out over the next second, not stepped, so
+// that time never goes backwards.
+struct TscClock
+{
+    static unsigned const tscShift = 32U;
+    static uint64 const calibrateTime = 10ULL * TOOLS_NANOSECONDS_PER_MILLISECOND;
+    static uint64 const resyncTime = TOOLS_NANOSECONDS_PER_SECOND;
+    // Errors beyond this (a suspend, or a migrated VM) are stepped over when the TSC is behind.
+    static uint64 const stepTime = TOOLS_NANOSECONDS_PER_MILLISECOND;
+
+    unsigned volatile state_;
+    unsigned volatile seq_;  // odd while params_ is being written
+    unsigned volatile resyncing_;
+    TscParams params_;
+    // Written only by whichever thread holds resyncing_.
+    uint64 resyncTicks_;
+    uint64 sampleTsc_;  // the last pair read from the two clocks
+    uint64 sampleTime_;
+};
+#endif // TOOLS_HAS_TSC
+
 //////////
 // Statics
 //////////
 
 static RegisterEnvironment< Timing, TimingImpl > regTiming;
 
+#ifdef TOOLS_HAS_TSC
+// Zero initialized, and so tscUnknown, before any constructor runs.
+static TscClock tscClock;
+#endif // TOOLS_HAS_TSC
+
 ///////////////////////
 // Non-member Functions
 ///////////////////////
 
 uint64
-tools::impl::getHighResTime()
+tools::impl::getOsTime()
 {
     timespec localTimeOfDay;
     clock_gettime(CLOCK_MONOTONIC, &localTimeOfDay);
@@ -78,6 +134,186 @@ tools::impl::getHighResTime()
         numeric_cast< uint64 >( localTimeOfDay.tv_nsec );
 }
 
+#ifdef TOOLS_HAS_TSC
+static bool
+tscTrusted( void )
+{
+    unsigned eax, ebx, ecx, edx;
+    if( !__get_cpuid( 0x80000000U, &eax, &ebx, &ecx, &edx ) || ( eax < 0x80000007U )) {
+        return false;
+    }
+    __get_cpuid( 0x80000007U, &eax, &ebx, &ecx, &edx );
+    if( !( edx & ( 1U << 8 ))) {
+        // Not invariant, the rate follows frequency scaling and stops in deep sleep.
+        return false;
+    }
+    // The kernel checks that the TSCs of every CPU agree, and falls back to another clocksource if they
+    // don't. Only read the TSC directly if the kernel uses it itself.
+    char name[ 32 ] = {};
+    FILE * source = fopen( "/sys/devices/system/clocksource/clocksource0/current_clocksource", "r" );
+    if( !source ) {
+        return false;
+    }
+    bool ret = !!fgets( name, sizeof( name ), source ) && ( strncmp( name, "tsc\n", 4U ) == 0 );
+    fclose( source );
+    return ret;
+}
+
+// Read the two clocks together, keeping the tightest of a few brackets so that a read which was preempted
+// doesn't skew the pair.
+static uint64
+tscSample(
+    uint64 & time )
+{
+    uint64 best = UINT64_MAX, ret = 0U;
+    for( unsigned i = 0U; i != 4U; ++i ) {
+        uint64 before = __rdtsc();
+        uint64 os = tools::impl::getOsTime();
+        uint64 after = __rdtsc();
+        if( ( after - before ) < best ) {
+            best = after - before;
+            ret = before + ( best / 2U );
+            time = os;
+        }
+    }
+    return ret;
+}
+
+static uint64
+tscConvert(
+    TscParams const & params,
+    uint64 tsc )
+{
+    // Another CPU may be a few ticks behind the one that took the anchor.
+    uint64 ticks = ( tsc > params.tscBase_ ) ? ( tsc - params.tscBase_ ) : 0U;
+    return params.base_ + static_cast< uint64 >(( static_cast< unsigned __int128 >( ticks ) * params.mult_ ) >> TscClock::tscShift );
+}
+
+static void
+tscPublish(
+    TscParams const & params )
+{
+    unsigned seq = tscClock.seq_;
+    tscClock.seq_ = seq + 1U;
+    tools::detail::atomicCompilerBarrier();
+    tscClock.params_ = params;
+    tools::detail::atomicCompilerBarrier();
+    tscClock.seq_ = seq + 2U;
+}
+
+// Measure the rate over the time since the last sample, and anchor the mapping at a new one. Called by the
+// one thread that won resyncing_.
+static void
+tscResync(
+    TscParams const & current )
+{
+    uint64 time;
+    uint64 tsc = tscSample( time );
+    if( ( tsc <= tscClock.sampleTsc_ ) || ( time <= tscClock.sampleTime_ )) {
+        return;
+    }
+    uint64 ticks = tsc - tscClock.sampleTsc_;
+    uint64 elapsed = time - tscClock.sampleTime_;
+    uint64 mult = static_cast< uint64 >(( static_cast< unsigned __int128 >( elapsed ) << TscClock::tscShift ) / ticks );
+    tscClock.resyncTicks_ = static_cast< uint64 >(( static_cast< unsigned __int128 >( ticks ) * TscClock::resyncTime ) / elapsed );
+    tscClock.sampleTsc_ = tsc;
+    tscClock.sampleTime_ = time;
+    TscParams next;
+    next.tscBase_ = tsc;
+    if( atomicRead( &tscClock.state_ ) == tscCalibrating ) {
+        // Callers have been using the OS clock up to now.
+        next.base_ = time;
+        next.mult_ = mult;
+        tscPublish( next );
+        atomicSet( &tscClock.state_, tscRunning );
+        return;
+    }
+    // Continue from where the old mapping has got to, and slew by what it is off over the next second.
+    next.base_ = tscConvert( current, tsc );
+    if( time > ( next.base_ + TscClock::stepTime )) {
+        next.base_ = time;
+    }
+    sint64 error = static_cast< sint64 >( time - next.base_ );
+    sint64 slew = static_cast< sint64 >(( static_cast< __int128 >( error ) << TscClock::tscShift ) / static_cast< __int128 >( tscClock.resyncTicks_ ));
+    // Never slow by more than half, whatever has happened.
+    next.mult_ = ( slew < -static_cast< sint64 >( mult / 2U )) ? ( mult / 2U ) : static_cast< uint64 >( static_cast< sint64 >( mult ) + slew );
+    tscPublish( next );
+}
+
+static TOOLS_NO_INLINE uint64
+tscSlowTime( void )
+{
+    uint64 now = tools::impl::getOsTime();
+    unsigned state = atomicRead( &tscClock.state_ );
+    if( state == tscUnknown ) {
+        if( atomicCas( &tscClock.resyncing_, 0U, 1U ) == 0U ) {
+            if( tscTrusted() ) {
+                tscClock.sampleTsc_ = tscSample( tscClock.sampleTime_ );
+                atomicSet( &tscClock.state_, tscCalibrating );
+            } else {
+                atomicSet( &tscClock.state_, tscUnavailable );
+            }
+            atomicSet( &tscClock.resyncing_, 0U );
+        }
+    } else if(( state == tscCalibrating ) && ( now > ( tscClock.sampleTime_ + TscClock::calibrateTime ))) {
+        if( atomicCas( &tscClock.resyncing_, 0U, 1U ) == 0U ) {
+            if( atomicRead( &tscClock.state_ ) == tscCalibrating ) {
+                tscResync( tscClock.params_ );
+            }
+            atomicSet( &tscClock.resyncing_, 0U );
+        }
+    }
+    return now;
+}
+#endif // TOOLS_HAS_TSC
+
+uint64
+tools::impl::getHighResTime()
+{
+#ifdef TOOLS_HAS_TSC
+    if( TOOLS_UNLIKELY( tscClock.state_ != tscRunning )) {
+        return tscSlowTime();
+    }
+    TscParams params;
+    unsigned seq;
+    do {
+        seq = tscClock.seq_;
+        tools::detail::atomicCompilerBarrier();
+        params = tscClock.params_;
+        tools::detail::atomicCompilerBarrier();
+    } while(( seq & 1U ) || ( seq != tscClock.seq_ ));
+    uint64 tsc = __rdtsc();
+    if( TOOLS_UNLIKELY(( tsc - params.tscBase_ ) > tscClock.resyncTicks_ ) && ( tsc > params.tscBase_ )) {
+        if( atomicCas( &tscClock.resyncing_, 0U, 1U ) == 0U ) {
+            tscResync( params );
+            atomicSet( &tscClock.resyncing_, 0U );
+        }
+    }
+    return tscConvert( params, tsc );
+#else // TOOLS_HAS_TSC
+    return getOsTime();
+#endif // TOOLS_HAS_TSC
+}
+
+bool
+tools::impl::highResTimeFromTsc()
+{
+#ifdef TOOLS_HAS_TSC
+    return ( atomicRead( &tscClock.state_ ) == tscRunning );
+#else // TOOLS_HAS_TSC
+    return false;
+#endif // TOOLS_HAS_TSC
+}
+
+uint64
+tools::impl::getThreadCpuTime()
+{
+    timespec threadTime;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &threadTime);
+    return numeric_cast< uint64 >( threadTime.tv_sec ) * TOOLS_NANOSECONDS_PER_SECOND +
+        numeric_cast< uint64 >( threadTime.tv_nsec );
+}
+
 static void
 nsecToTimespec(
     uint64 nsec,
@@ -203,10 +439,21 @@ TimingImpl::mark(
     return tools::impl::getHighResTime() - startMark;
 }
 
-AutoDispose< Request >
+AutoDispose< Timer >
 TimingImpl::timer(
     uint64 duration,
-    uint64 * startTime )
+    uint64 * startTime,
+    uint64 slack )
+{
+    // Scheduler workers keep the timers they make, so that they fire on the same thread.
+    if( TimerQueueOwner * local = impl::timerQueueLocal() ) {
+        return std::move( local->queue().timer( duration, startTime, slack ));
+    }
+    return std::move(ptimer_->queue_->timer( duration, startTime, slack ));
+}
+
+TimingStats
+TimingImpl::stats( void )
 {
-    return std::move(ptimer_->queue_->timer( duration, startTime ));
+    return ptimer_->queue_->stats();
 }
@@ -2,6 +2,14 @@
 
 #include <tools/Tools.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+
 using namespace tools;
 
 ///////////////////////
@@ -14,3 +22,74 @@ tools::impl::isAbnormalShutdown( void )
     // TODO: check for a signal or something?
     return true;
 }
+
+namespace tools {
+    namespace impl {
+        void const *
+        platformMapFile(
+            char const * path,
+            size_t * size )
+        {
+            int fd = open( path, O_RDONLY | O_CLOEXEC );
+            if( fd < 0 ) {
+                return nullptr;
+            }
+            void * ret = nullptr;
+            struct stat st;
+            if(( fstat( fd, &st ) == 0 ) && ( st.st_size > 0 )) {
+                ret = mmap( nullptr, static_cast< size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+                if( ret == MAP_FAILED ) {
+                    ret = nullptr;
+                } else {
+                    *size = static_cast< size_t >( st.st_size );
+                }
+            }
+            close( fd );
+            return ret;
+        }
+
+        void
+        platformUnmapFile(
+            void const * site,
+            size_t size )
+        {
+            int ret = munmap( const_cast< void * >( site ), size );
+            TOOLS_ASSERT( !ret );
+        }
+
+        bool
+        platformWriteFile(
+            char const * path,
+            void const * data,
+            size_t size )
+        {
+            // Write aside and rename, so that nobody maps a partial file.
+            std::string temp( path );
+            temp.append( ".tmp" );
+            int fd = open( temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+            if( fd < 0 ) {
+                return false;
+            }
+            char const * next = static_cast< char const * >( data );
+            char const * end = next + size;
+            while( next != end ) {
+                ssize_t written = write( fd, next, static_cast< size_t >( end - next ));
+                if( written < 0 ) {
+                    if( errno == EINTR ) {
+                        continue;
+                    }
+                    break;
+                }
+                next += written;
+            }
+            bool ret = ( close( fd ) == 0 ) && ( next == end );
+            if( ret ) {
+                ret = ( rename( temp.c_str(), path ) == 0 );
+            }
+            if( !ret ) {
+                unlink( temp.c_str() );
+            }
+            return ret;
+        }
+    };  // impl namespace
+};  // tools namespace
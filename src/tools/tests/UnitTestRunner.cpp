@@ -1,10 +1,43 @@
+#include <tools/StartupProfile.h>
 #include <tools/UnitTest.h>
 
+#ifdef WINDOWS_PLATFORM
+#  include <Windows.h>
+#  include <Psapi.h>
+#else // WINDOWS_PLATFORM
+#  include <sys/resource.h>
+#endif // WINDOWS_PLATFORM
+#include <stdlib.h>
+#include <chrono>
+
 using namespace tools;
 
+static unsigned long long
+peakResidentKiB( void )
+{
+#ifdef WINDOWS_PLATFORM
+    PROCESS_MEMORY_COUNTERS counters;
+    if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ))) {
+        return 0ULL;
+    }
+    return counters.PeakWorkingSetSize / 1024U;
+#else // WINDOWS_PLATFORM
+    rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 ) {
+        return 0ULL;
+    }
+    return static_cast< unsigned long long >( usage.ru_maxrss );
+#endif // WINDOWS_PLATFORM
+}
+
 int
 main( int argc, char** argv )
 {
+    // With TOOLS_STRINGID_SNAPSHOT set, map that StringId snapshot (writing it at exit if it could not be
+    // mapped), and report startup time and peak RSS for comparison between runs with and without one.
+    auto begin = std::chrono::steady_clock::now();
+    char const * snapshotPath = getenv("TOOLS_STRINGID_SNAPSHOT");
+    bool snapshotMapped = !!snapshotPath && stringIdSnapshotMap(snapshotPath);
     AutoDispose<> envLifetime;
     Environment * env = NewSimpleEnvironment(envLifetime, "test");
     TOOLS_ASSERT(!!env);
@@ -15,6 +48,14 @@ main( int argc, char** argv )
         TOOLS_ASSERT(!err);
     }
     auto mgr = env->get<tools::unittest::impl::Management>();
+    // Static registration is done by now, tests then run against the frozen registry.
+    registryFreeze();
+    startupProfileFinish();
+    if (!!snapshotPath) {
+        auto startup = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+        fprintf(stderr, "Startup %s StringId snapshot: %lld us, peak RSS %llu KiB\n", snapshotMapped ? "with" : "without",
+            static_cast<long long>(startup.count()), peakResidentKiB());
+    }
     if (argc == 1) {
         mgr->run(StringIdNull());
     } else {
@@ -40,4 +81,12 @@ main( int argc, char** argv )
         auto err(runRequestSynchronously(stopReq));
         TOOLS_ASSERT(!err);
     }
+    if (!!snapshotPath) {
+        auto total = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        fprintf(stderr, "Run %s StringId snapshot: %lld ms, peak RSS %llu KiB\n", snapshotMapped ? "with" : "without",
+            static_cast<long long>(total.count()), peakResidentKiB());
+        if (!snapshotMapped && !stringIdSnapshotWrite(snapshotPath)) {
+            fprintf(stderr, "Could not write StringId snapshot %s\n", snapshotPath);
+        }
+    }
 }
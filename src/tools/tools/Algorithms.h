@@ -4,6 +4,11 @@
 #include <tools/Tools.h>
 
 #include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <string.h>
 #ifdef WINDOWS_PLATFORM
 #  include <intrin.h>
 #  include <nmmintrin.h>
@@ -303,6 +308,150 @@ namespace tools {
         }
 #endif // TOOLS_ARCH_UNKNOWN
 
+        // Up to 8 bytes taken little-endian and zero filled. Assembled a byte at a time so the result does not
+        // depend on host byte order.
+        TOOLS_FORCE_INLINE uint64 hashBytesTail( uint8 const * p, size_t len )
+        {
+            uint64 ret = 0U;
+            for( size_t i = 0U; i != len; ++i ) {
+                ret |= static_cast< uint64 >( p[ i ] ) << ( 8U * i );
+            }
+            return ret;
+        }
+
+        // Shape of the byte range hash, independent of how a CRC32C step is computed. Full 24 byte strides
+        // run three independent lanes (the crc32 instruction has a latency of 3 and a throughput of 1), which
+        // are then folded. The remaining words and the tail go through one lane, followed by the length so
+        // that zero fill cannot alias a shorter key. CRC is linear, so we finish with the murmur3 avalanche.
+        template< typename StepT, typename LoadT >
+        TOOLS_FORCE_INLINE uint32 hashBytesWith( uint8 const * p, size_t len, uint32 initial, StepT const & step, LoadT const & load )
+        {
+            size_t const total = len;
+            uint32 a = initial;
+            uint32 b = initial ^ 0x9E3779B9U;
+            uint32 c = initial ^ 0x85EBCA6BU;
+            for( ; len >= 24U; len -= 24U, p += 24U ) {
+                a = step( a, load( p ));
+                b = step( b, load( p + 8U ));
+                c = step( c, load( p + 16U ));
+            }
+            a = step( a, ( static_cast< uint64 >( b ) << 32 ) | c );
+            for( ; len >= 8U; len -= 8U, p += 8U ) {
+                a = step( a, load( p ));
+            }
+            if( len != 0U ) {
+                a = step( a, hashBytesTail( p, len ));
+            }
+            a = step( a, static_cast< uint64 >( total ));
+            a ^= a >> 16;
+            a *= 0x85EBCA6BU;
+            a ^= a >> 13;
+            a *= 0xC2B2AE35U;
+            a ^= a >> 16;
+            return a;
+        }
+
+        // Table driven (slicing-by-8) CRC32C version of hashBytes. This produces exactly the values the
+        // hardware version does.
+        TOOLS_API uint32 hashBytesPortable( void const *, size_t, uint32 );
+        // What TOOLS_ARCH_UNKNOWN uses: the crc32 instruction where cpuid reports SSE 4.2, otherwise the
+        // tables.
+        TOOLS_API uint32 hashBytesRuntime( void const *, size_t, uint32 );
+        // Whether hashBytes runs on the crc32 instruction.
+        TOOLS_API bool hashBytesHardware( void );
+
+        // Hash a range of bytes.
+#ifdef TOOLS_ARCH_X86
+        TOOLS_FORCE_INLINE uint32 hashBytes( void const * data, size_t len, uint32 initial )
+        {
+            return tools::impl::hashBytesWith( static_cast< uint8 const * >( data ), len, initial,
+                []( uint32 crc, uint64 v )->uint32 {
+                    return static_cast< uint32 >( _mm_crc32_u64( crc, v ));
+                }, []( uint8 const * p )->uint64 {
+                    uint64 ret;
+                    memcpy( &ret, p, sizeof( ret ));
+                    return ret;
+                });
+        }
+#endif // TOOLS_ARCH_X86
+#ifdef TOOLS_ARCH_UNKNOWN
+        TOOLS_FORCE_INLINE uint32 hashBytes( void const * data, size_t len, uint32 initial )
+        {
+            return tools::impl::hashBytesRuntime( data, len, initial );
+        }
+#endif // TOOLS_ARCH_UNKNOWN
+
+        // Compile time twin of hashBytes, producing identical values for character strings. Written as single
+        // return recursion so it stays a C++11 constant expression, with one bitwise CRC32C step per byte.
+        constexpr uint32 constCrcBit( uint32 c )
+        {
+            return (( c & 1U ) != 0U ) ? (( c >> 1 ) ^ 0x82F63B78U ) : ( c >> 1 );
+        }
+
+        constexpr uint32 constCrcByte( uint32 c )
+        {
+            return constCrcBit( constCrcBit( constCrcBit( constCrcBit( constCrcBit( constCrcBit( constCrcBit( constCrcBit( c ))))))));
+        }
+
+        constexpr uint32 constCrcWord( uint32 crc, uint64 v, unsigned i = 0U )
+        {
+            return ( i == 8U ) ? crc : constCrcWord( constCrcByte( crc ^ static_cast< uint32 >(( v >> ( 8U * i )) & 0xFFU )), v, i + 1U );
+        }
+
+        constexpr uint64 constHashLoad( char const * p, size_t len )
+        {
+            return ( len == 0U ) ? 0U : ( static_cast< uint64 >( static_cast< uint8 >( p[ 0 ] )) | ( constHashLoad( p + 1, len - 1U ) << 8 ));
+        }
+
+        constexpr uint32 constHashAvalanche3( uint32 a )
+        {
+            return a ^ ( a >> 16 );
+        }
+
+        constexpr uint32 constHashAvalanche2( uint32 a )
+        {
+            return constHashAvalanche3(( a ^ ( a >> 13 )) * 0xC2B2AE35U );
+        }
+
+        constexpr uint32 constHashAvalanche( uint32 a )
+        {
+            return constHashAvalanche2(( a ^ ( a >> 16 )) * 0x85EBCA6BU );
+        }
+
+        constexpr uint32 constHashFinish( char const * p, size_t len, size_t total, uint32 a )
+        {
+            return constHashAvalanche( constCrcWord(( len != 0U ) ? constCrcWord( a, constHashLoad( p, len )) : a, static_cast< uint64 >( total )));
+        }
+
+        constexpr uint32 constHashWords( char const * p, size_t len, size_t total, uint32 a )
+        {
+            return ( len >= 8U ) ? constHashWords( p + 8, len - 8U, total, constCrcWord( a, constHashLoad( p, 8U ))) : constHashFinish( p, len, total, a );
+        }
+
+        constexpr uint32 constHashLanes( char const * p, size_t len, size_t total, uint32 a, uint32 b, uint32 c )
+        {
+            return ( len >= 24U )
+                ? constHashLanes( p + 24, len - 24U, total, constCrcWord( a, constHashLoad( p, 8U )),
+                    constCrcWord( b, constHashLoad( p + 8, 8U )), constCrcWord( c, constHashLoad( p + 16, 8U )))
+                : constHashWords( p, len, total, constCrcWord( a, ( static_cast< uint64 >( b ) << 32 ) | c ));
+        }
+
+        constexpr uint32 constHashBytes( char const * p, size_t len, uint32 initial )
+        {
+            return constHashLanes( p, len, len, initial, initial ^ 0x9E3779B9U, initial ^ 0x85EBCA6BU );
+        }
+
+        // Hash and displace perfect hashing over distinct 32 bit hashes. A hash belongs to bucket
+        // (hash & (buckets - 1)), and that bucket's displacement picks its slot. slots must be a power of 2.
+        TOOLS_FORCE_INLINE uint32 perfectHashSlot( uint32 hash, uint32 displacement, uint32 slots )
+        {
+            return tools::impl::constHashAvalanche( hash ^ ( displacement * 0x9E3779B9U )) & ( slots - 1U );
+        }
+
+        // Choose buckets, slots and a displacement per bucket so that each of the (distinct) hashes lands in a
+        // slot of its own. slotOf receives the slot of each hash, in the order given.
+        TOOLS_API void perfectHashBuild( uint32 const *, size_t, uint32 &, uint32 &, std::vector< uint32 > &, std::vector< uint32 > & );
+
         // Make your own defineHashAnyInit if you need to have custom initialization for your type
         template< typename AnyT >
         TOOLS_FORCE_INLINE uint32 defineHashAnyInit( AnyT *** )
@@ -419,6 +568,19 @@ namespace tools {
             return tools::impl::hashAny( static_cast< uint64 >( reinterpret_cast< ptrdiff_t >( v )), initial );
         }
 
+        TOOLS_FORCE_INLINE uint32 defineHashAny( std::string const & v, uint32 initial )
+        {
+            return hashBytes( v.data(), v.size(), initial );
+        }
+
+        // Contiguous runs of integers hash by their bytes.
+        template< typename ElementT, typename AllocT >
+        TOOLS_FORCE_INLINE typename std::enable_if< std::is_integral< ElementT >::value && !std::is_same< ElementT, bool >::value, uint32 >::type
+        defineHashAny( std::vector< ElementT, AllocT > const & v, uint32 initial )
+        {
+            return hashBytes( v.data(), v.size() * sizeof( ElementT ), initial );
+        }
+
         // This indirection is for ADL shenanigans
         template< typename AnyT >
         TOOLS_FORCE_INLINE uint32 dispatchHashAny( AnyT const & a, uint32 initial )
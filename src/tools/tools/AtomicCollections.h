@@ -4,8 +4,50 @@
 #include <tools/Tools.h>
 #include <tools/WeakPointer.h>
 
+#include <emmintrin.h>
+
 namespace tools
 {
+    namespace detail {
+        enum : size_t {
+            atomicCacheLineSize = 64U,
+        };
+
+        // Back off briefly while another thread finishes a short, bounded critical step.
+        static TOOLS_FORCE_INLINE void atomicSpinPause(void) {
+            _mm_pause();
+        }
+
+        // Prevent the compiler from moving ordinary loads and stores across this point. The hardware memory
+        // model (x86) already keeps loads ordered with loads and stores with stores.
+        static TOOLS_FORCE_INLINE void atomicCompilerBarrier(void) {
+#ifdef WINDOWS_PLATFORM
+            _ReadWriteBarrier();
+#else // WINDOWS_PLATFORM
+            __asm__ __volatile__("" ::: "memory");
+#endif // WINDOWS_PLATFORM
+        }
+
+        // Keep loads before this point ahead of any load or store after it.
+        static TOOLS_FORCE_INLINE void atomicAcquireFence(void) {
+#ifdef WINDOWS_PLATFORM
+            // x86 and x64 only, where this is already the hardware ordering.
+            _ReadWriteBarrier();
+#else // WINDOWS_PLATFORM
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif // WINDOWS_PLATFORM
+        }
+
+        // Keep loads and stores before this point ahead of any store after it.
+        static TOOLS_FORCE_INLINE void atomicReleaseFence(void) {
+#ifdef WINDOWS_PLATFORM
+            _ReadWriteBarrier();
+#else // WINDOWS_PLATFORM
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif // WINDOWS_PLATFORM
+        }
+    }; // detail namespace
+
     // A lock-free non-blocking singly linked list. The elements are intrusive, with a required member for a
     // link to the next element as well as an unlink method.
     //
@@ -386,6 +428,208 @@ namespace tools
         AnyT * volatile extracted_[2U]; // Extracted elements are placed in one of these lists. they alternate when there is contention among readers.
     };
 
+    // A bounded multi-producer/multi-consumer FIFO queue (after Dmitry Vyukov's design). Each cell carries a
+    // sequence number that tells producers and consumers whose turn it is to touch that cell, so the only
+    // contended writes are a single CAS on either the enqueue or dequeue position. Capacity must be a power
+    // of 2. Elements are copied in and out, so this is best suited to pointers and other small values.
+    //
+    // Batch operations claim a contiguous run of cells with one CAS, amortizing the contention over the whole
+    // batch. They return the number of elements actually moved, which may be less than requested when the
+    // queue is (nearly) full or empty.
+    template<typename ElementT, size_t capacity>
+    struct AtomicRingQueue
+    {
+        static_assert((capacity >= 2U) && ((capacity & (capacity - 1U)) == 0U), "AtomicRingQueue capacity must be a power of 2");
+
+        struct Cell
+        {
+            size_t volatile sequence_;
+            ElementT data_;
+        };
+
+        TOOLS_FORCE_INLINE AtomicRingQueue(void)
+            : enqueuePos_(0U)
+            , dequeuePos_(0U)
+        {
+            for (size_t i = 0U; i != capacity; ++i) {
+                cells_[i].sequence_ = i;
+            }
+        }
+
+        // Try to append an element. Returns false if the queue is full.
+        TOOLS_FORCE_INLINE bool tryPush(ElementT const & elem) {
+            return tryPushBatch(&elem, 1U) == 1U;
+        }
+
+        // Try to remove the oldest element. Returns false if the queue is empty.
+        TOOLS_FORCE_INLINE bool tryPop(ElementT & elem) {
+            return tryPopBatch(&elem, 1U) == 1U;
+        }
+
+        // Append up to 'count' elements, preserving their order. Returns the number appended.
+        TOOLS_FORCE_INLINE size_t tryPushBatch(ElementT const * elems, size_t count) {
+            size_t pos;
+            size_t claimed = claim(&enqueuePos_, count, 0U, pos);
+            for (size_t i = 0U; i != claimed; ++i) {
+                Cell & cell = cells_[(pos + i) & (capacity - 1U)];
+                cell.data_ = elems[i];
+                // Publish to consumers
+                atomicSet(&cell.sequence_, pos + i + 1U);
+            }
+            return claimed;
+        }
+
+        // Remove up to 'count' elements, oldest first. Returns the number removed.
+        TOOLS_FORCE_INLINE size_t tryPopBatch(ElementT * elems, size_t count) {
+            size_t pos;
+            size_t claimed = claim(&dequeuePos_, count, 1U, pos);
+            for (size_t i = 0U; i != claimed; ++i) {
+                Cell & cell = cells_[(pos + i) & (capacity - 1U)];
+                elems[i] = cell.data_;
+                // Hand the cell back to producers for the next lap
+                atomicSet(&cell.sequence_, pos + i + capacity);
+            }
+            return claimed;
+        }
+
+        // This is only a snapshot, and may be stale by the time the caller looks at it.
+        TOOLS_FORCE_INLINE size_t sizeApprox(void) const {
+            size_t dequeue = atomicRead(&dequeuePos_);
+            size_t enqueue = atomicRead(&enqueuePos_);
+            return (enqueue > dequeue) ? (enqueue - dequeue) : 0U;
+        }
+    private:
+        // Claim a run of cells starting at *site. A cell at position 'pos' is ready for us when its sequence is
+        // 'pos + lag' (lag is 0 for producers, 1 for consumers). Returns the number of cells claimed, and the
+        // first claimed position via refPos.
+        TOOLS_FORCE_INLINE size_t claim(size_t volatile * site, size_t count, size_t lag, size_t & refPos) {
+            size_t pos = atomicRead(site);
+            for (;;) {
+                size_t ready = 0U;
+                bool stale = false;
+                while (ready != count) {
+                    size_t target = pos + ready;
+                    ptrdiff_t diff = static_cast<ptrdiff_t>(atomicRead(&cells_[target & (capacity - 1U)].sequence_) - (target + lag));
+                    if (diff != 0) {
+                        // Someone else already claimed our first position, catch up.
+                        stale = ((diff > 0) && (ready == 0U));
+                        break;
+                    }
+                    ++ready;
+                }
+                if (stale) {
+                    pos = atomicRead(site);
+                    continue;
+                }
+                if (ready == 0U) {
+                    // Full (producers) or empty (consumers)
+                    return 0U;
+                }
+                size_t prev = atomicCas(site, pos, pos + ready);
+                if (prev == pos) {
+                    refPos = pos;
+                    return ready;
+                }
+                pos = prev;
+            }
+        }
+
+        Cell cells_[capacity];
+        uint8 pad0_[tools::detail::atomicCacheLineSize];
+        size_t volatile enqueuePos_;
+        uint8 pad1_[tools::detail::atomicCacheLineSize - sizeof(size_t)];
+        size_t volatile dequeuePos_;
+        uint8 pad2_[tools::detail::atomicCacheLineSize - sizeof(size_t)];
+    };
+
+    // An unbounded, intrusive, multi-producer/single-consumer FIFO queue. Producers are wait-free: a push is a
+    // single atomic exchange on the tail followed by a plain store to link the previous tail. The link member
+    // is supplied as a pointer to member, so existing intrusive links can be used directly. For example:
+    //
+    //   AtomicMpscQueue<Task, &Task::nextTask_> queue;
+    //
+    // An element may only be in one queue (or other list sharing the same link) at a time. Only a single
+    // thread may pop at any one time.
+    template<typename ElementT, ElementT * ElementT::* nextT>
+    struct AtomicMpscQueue
+    {
+        TOOLS_FORCE_INLINE AtomicMpscQueue(void)
+            : head_(nullptr)
+            , tail_(nullptr)
+        {}
+        TOOLS_FORCE_INLINE ~AtomicMpscQueue(void)
+        {
+            TOOLS_ASSERT(!head_ && !tail_);  // Should have been drained previously
+        }
+
+        TOOLS_FORCE_INLINE bool operator!(void) const {
+            return !atomicRead(&tail_);
+        }
+
+        // Append a single element
+        TOOLS_FORCE_INLINE void push(ElementT * elem) {
+            pushChain(elem, elem);
+        }
+
+        // Append a chain of elements, already linked from first to last via the link member. The whole chain
+        // becomes visible with a single atomic exchange.
+        TOOLS_FORCE_INLINE void pushChain(ElementT * first, ElementT * last) {
+            last->*nextT = nullptr;
+            ElementT * prev = atomicExchange(&tail_, last);
+            if (!!prev) {
+                atomicSet(&(prev->*nextT), first);
+            } else {
+                // The queue was empty, we become the head.
+                atomicSet(&head_, first);
+            }
+        }
+
+        // Remove the oldest element, returns nullptr if the queue is empty. An element whose push is still in
+        // flight may not be visible yet.
+        TOOLS_FORCE_INLINE ElementT * pop(void) {
+            ElementT * head = atomicRead(&head_);
+            if (!head) {
+                return nullptr;
+            }
+            ElementT * next = atomicRead(&(head->*nextT));
+            if (!next) {
+                // This may be the last element. If we can retire the tail, the queue is now empty. Pushes that
+                // start after that point will install themselves as the head.
+                if (atomicCas(&tail_, head, static_cast<ElementT *>(nullptr)) == head) {
+                    atomicCas(&head_, head, static_cast<ElementT *>(nullptr));
+                    return head;
+                }
+                // A producer has swapped the tail but has not linked behind us yet. That is only ever a couple of
+                // instructions away.
+                while (!(next = atomicRead(&(head->*nextT)))) {
+                    tools::detail::atomicSpinPause();
+                }
+            }
+            atomicSet(&head_, next);
+            head->*nextT = nullptr;
+            return head;
+        }
+
+        // Pop every element currently visible, passing each to the given function in FIFO order. The signature
+        // of the function is:
+        //     (ElementT *)->void
+        // Returns the number of elements visited.
+        template<typename VisitF>
+        TOOLS_FORCE_INLINE size_t popAll(VisitF && func) {
+            size_t ret = 0U;
+            while (ElementT * elem = pop()) {
+                func(elem);
+                ++ret;
+            }
+            return ret;
+        }
+    private:
+        ElementT * volatile head_;  // Consumer side
+        uint8 pad0_[tools::detail::atomicCacheLineSize - sizeof(ElementT *)];
+        ElementT * volatile tail_;  // Producer side
+        uint8 pad1_[tools::detail::atomicCacheLineSize - sizeof(ElementT *)];
+    };
+
     // Phantom-based singly linked list and hash table. Be aware, that because these use phantom implementations
     // there is likely to be higher than ideal memory load, because the phantom nodes are not deleted until
     // all threads have returned to idle.
@@ -927,6 +1171,8 @@ namespace tools
     {
         typedef tools::PhantomSlist< ElementT, PhantomT > BucketT;
 
+        static size_t const bucketCount = bucketsUsed;
+
         TOOLS_FORCE_INLINE PhantomHashMap(void)
             : hashInit_(tools::hashAnyInit< KeyT >())
         {}
@@ -953,6 +1199,17 @@ namespace tools
             });
         }
 
+        // As forEach, but over a single bucket (taken modulo the bucket count). This lets a walk of the whole
+        // map be spread out over time.
+        template< typename VisitorF >
+        TOOLS_FORCE_INLINE void
+        forEachInBucket(
+            size_t bucket,
+            VisitorF const & visitor) const
+        {
+            buckets_[bucket % bucketsUsed].peek(visitor);
+        }
+
         // Iterate the map, applying the given function to every element with a key matching the given. The
         // visitor function has the signature:
         //     (ElementT &)->bool
@@ -1137,4 +1394,438 @@ namespace tools
         uint32 hashInit_;
         BucketT buckets_[bucketsUsed];
     };
+    // Phantom skip list, is similar to map, an ordered associative container with unique keys. All
+    // modifications are lock-free. Readers (find, lowerBound, forEach) never write shared memory, but must
+    // be cloaked (as with the other phantom structures) for the duration they hold on to any returned
+    // element. Removed nodes are reclaimed through the phantom mechanism.
+    //
+    // Implementation overview:
+    //
+    // Each node has a random height and a tail of next links, one per level. A node is removed by marking
+    // its links (via setEnd(...)) top-down, level 0 last; whoever marks level 0 owns the removal. Marked
+    // links are never modified again, so a marked node's successors stay reachable until it is unlinked.
+    // Updating threads unlink marked nodes they pass over during a search. Because the inserting thread
+    // links the upper levels after level 0, a removal can overlap an insert. The node's state_ decides which
+    // of the two threads performs the final unlink and finalizes the node.
+    //
+    // The key type must support operator<. Values are copied in on insert and are immutable afterwards.
+    template< typename KeyT, typename ValueT, typename PhantomT = PhantomUniversal, unsigned levelsUsed = 24U >
+    struct PhantomSkipList
+    {
+        static_assert((levelsUsed > 0U) && (levelsUsed <= 32U), "Skip list height must be between 1 and 32");
+
+        struct Node;
+        typedef tools::FlagPointer< Node > LinkType;
+
+        struct Node
+            : tools::StandardPhantom< Node, tools::AllocTail< LinkType, tools::Platform >>
+        {
+            enum : uint32 {
+                stateLinking,
+                stateLinked,
+                stateRemoved,
+            };
+
+            TOOLS_FORCE_INLINE Node(
+                KeyT const & key,
+                ValueT const & value,
+                unsigned height)
+                : key_(key)
+                , value_(value)
+                , height_(height)
+                , state_(stateLinking)
+            {}
+
+            KeyT const key_;
+            ValueT const value_;
+            unsigned const height_;
+            uint32 volatile state_;
+            LinkType volatile next_[];
+        };
+
+        TOOLS_FORCE_INLINE PhantomSkipList(void)
+            : levelSeed_(0x9E3779B9U)
+            , size_(0U)
+        {
+            for (auto && link : head_) {
+                link.reset(nullptr);
+            }
+        }
+        TOOLS_FORCE_INLINE ~PhantomSkipList(void)
+        {
+            TOOLS_ASSERT(!head_[0]);  // Should have been cleared previously
+        }
+
+        TOOLS_FORCE_INLINE bool
+        operator!(void) const
+        {
+            return !head_[0];
+        }
+
+        // The number of elements. This is only exact when there are no concurrent modifications.
+        TOOLS_FORCE_INLINE size_t
+        sizeApprox(void) const
+        {
+            return size_;
+        }
+
+        // Insert a key/value pair. If an element with an equivalent key is already present, nothing is
+        // inserted and false is returned.
+        TOOLS_FORCE_INLINE bool
+        insert(
+            KeyT const & key,
+            ValueT const & value)
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            LinkType volatile * preds[levelsUsed];
+            Node * succs[levelsUsed];
+            Node * node = nullptr;
+            for (;; ) {
+                if (search(key, nullptr, preds, succs)) {
+                    // Never published, no need to go through the phantom
+                    delete node;
+                    return false;
+                }
+                if (!node) {
+                    unsigned height = randomHeight();
+                    node = new(height) Node(key, value, height);
+                }
+                for (unsigned level = 0U; level < node->height_; ++level) {
+                    node->next_[level].reset(succs[level]);
+                }
+                LinkType prevLink = LinkType::make(succs[0]);
+                if (atomicCas(preds[0], prevLink, LinkType::make(node)) == prevLink) {
+                    break;
+                }
+            }
+            atomicIncrement(&size_);
+            // The node is now in the list. Link the upper levels, giving up as soon as we see a remove.
+            for (unsigned level = 1U; level < node->height_; ++level) {
+                for (;; ) {
+                    LinkType expect;
+                    expect.reset(node->next_[level]);
+                    if (isEnd(expect)) {
+                        break;
+                    }
+                    if ((expect.get() != succs[level]) && (atomicCas(&node->next_[level], expect, LinkType::make(succs[level])) != expect)) {
+                        continue;
+                    }
+                    LinkType prevLink = LinkType::make(succs[level]);
+                    if (atomicCas(preds[level], prevLink, LinkType::make(node)) == prevLink) {
+                        break;
+                    }
+                    search(key, node, preds, succs);
+                }
+                if (isEnd(node->next_[level])) {
+                    break;
+                }
+            }
+            if (atomicCas(&node->state_, static_cast< uint32 >(Node::stateLinking), static_cast< uint32 >(Node::stateLinked)) != Node::stateLinking) {
+                // A remove happened while we were linking. It left the final unlink to us.
+                unlinkAndFinalize(node);
+            }
+            return true;
+        }
+
+        // Remove the element with the given key, returning false if there was none.
+        TOOLS_FORCE_INLINE bool
+        remove(
+            KeyT const & key)
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            LinkType volatile * preds[levelsUsed];
+            Node * succs[levelsUsed];
+            for (;; ) {
+                if (!search(key, nullptr, preds, succs)) {
+                    return false;
+                }
+                Node * node = succs[0];
+                for (unsigned level = node->height_; level-- > 1U; ) {
+                    atomicTryUpdate(&node->next_[level], [](LinkType & ref)->bool {
+                        if (isEnd(ref)) {
+                            return false;
+                        }
+                        setEnd(ref);
+                        return true;
+                    });
+                }
+                bool won = atomicTryUpdate(&node->next_[0], [](LinkType & ref)->bool {
+                    if (isEnd(ref)) {
+                        return false;
+                    }
+                    setEnd(ref);
+                    return true;
+                });
+                if (!won) {
+                    // Someone else removed it first, see if there is another to remove
+                    continue;
+                }
+                atomicDecrement(&size_);
+                if (atomicCas(&node->state_, static_cast< uint32 >(Node::stateLinking), static_cast< uint32 >(Node::stateRemoved)) == Node::stateLinking) {
+                    // The inserter is still linking, it will do the unlink
+                    return true;
+                }
+                unlinkAndFinalize(node);
+                return true;
+            }
+        }
+
+        // Find the value for a given key. The returned value is valid so long as the caller remains cloaked.
+        // Returns nullptr if no element matches.
+        TOOLS_FORCE_INLINE ValueT const *
+        find(
+            KeyT const & key) const
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            Node const * node = seek(key);
+            if (!node || (key < node->key_)) {
+                return nullptr;
+            }
+            return &node->value_;
+        }
+
+        // Visit the first element whose key is not less than a given key. The signature of the visitor is:
+        //     (KeyT const &, ValueT const &)->void
+        // This method returns false (without calling the visitor) if there is no such element.
+        template< typename VisitF >
+        TOOLS_FORCE_INLINE bool
+        lowerBound(
+            KeyT const & key,
+            VisitF const & visitor) const
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            Node const * node = seek(key);
+            if (!node) {
+                return false;
+            }
+            visitor(node->key_, node->value_);
+            return true;
+        }
+
+        // Visit elements in key order, starting at the first element whose key is not less than a given
+        // key. Elements removed during the walk may or may not be visited. The signature of the visitor is:
+        //     (KeyT const &, ValueT const &)->bool
+        // Returning false stops the iteration. This method returns a count of elements visited.
+        template< typename VisitF >
+        TOOLS_FORCE_INLINE size_t
+        forEach(
+            KeyT const & from,
+            VisitF const & visitor) const
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            return walk(seek(from), visitor);
+        }
+
+        // Visit every element in key order. See above for the visitor signature.
+        template< typename VisitF >
+        TOOLS_FORCE_INLINE size_t
+        forEach(
+            VisitF const & visitor) const
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            return walk(skipRemoved(head_[0].get()), visitor);
+        }
+
+        // Visit elements with keys in [lo, hi). See above for the visitor signature.
+        template< typename VisitF >
+        TOOLS_FORCE_INLINE size_t
+        range(
+            KeyT const & lo,
+            KeyT const & hi,
+            VisitF const & visitor) const
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            size_t ret = 0U;
+            for (Node * node = seek(lo); !!node && (node->key_ < hi); node = skipRemoved(node->next_[0].get())) {
+                ++ret;
+                if (!visitor(node->key_, node->value_)) {
+                    break;
+                }
+            }
+            return ret;
+        }
+
+        // Empty the list, returning a count of the number of elements removed.
+        TOOLS_FORCE_INLINE size_t
+        clear(void)
+        {
+            TOOLS_ASSERT(tools::phantomVerifyIsCloaked< PhantomT >());
+            size_t ret = 0U;
+            while (Node * node = skipRemoved(head_[0].get())) {
+                if (remove(node->key_)) {
+                    ++ret;
+                }
+            }
+            return ret;
+        }
+    private:
+        TOOLS_FORCE_INLINE LinkType volatile *
+        linkOf(
+            Node * node,
+            unsigned level) const
+        {
+            return !!node ? &node->next_[level] : const_cast< LinkType volatile * >(&head_[level]);
+        }
+
+        // Skip forward past removed nodes at level 0.
+        static TOOLS_FORCE_INLINE Node *
+        skipRemoved(
+            Node * node)
+        {
+            while (!!node) {
+                LinkType next;
+                next.reset(node->next_[0]);
+                if (!isEnd(next)) {
+                    break;
+                }
+                node = next.get();
+            }
+            return node;
+        }
+
+        // Read-only search for the first live node with a key not less than a given key. Following a marked
+        // link is safe here, since a marked node's successor cannot be unlinked before the marked node is.
+        // The exception is descending from a node that has been unlinked at the lower level, in which case
+        // we start over.
+        TOOLS_FORCE_INLINE Node *
+        seek(
+            KeyT const & key) const
+        {
+            Node * curr;
+            bool restart;
+            do {
+                restart = false;
+                Node * predNode = nullptr;
+                curr = nullptr;
+                for (unsigned level = levelsUsed; level-- > 0U; ) {
+                    LinkType link;
+                    link.reset(*linkOf(predNode, level));
+                    if (isEnd(link)) {
+                        restart = true;
+                        break;
+                    }
+                    curr = link.get();
+                    while (!!curr) {
+                        LinkType next;
+                        next.reset(curr->next_[level]);
+                        bool live = !isEnd(next);
+                        if (live) {
+                            if (!(curr->key_ < key)) {
+                                break;
+                            }
+                            predNode = curr;
+                        }
+                        curr = next.get();
+                    }
+                }
+            } while (restart);
+            return curr;
+        }
+
+        template< typename VisitF >
+        static TOOLS_FORCE_INLINE size_t
+        walk(
+            Node * node,
+            VisitF const & visitor)
+        {
+            size_t ret = 0U;
+            while (!!node) {
+                ++ret;
+                if (!visitor(node->key_, node->value_)) {
+                    break;
+                }
+                node = skipRemoved(node->next_[0].get());
+            }
+            return ret;
+        }
+
+        // Updating search. Fills in, for each level, the link preceding the position for key and the node
+        // that follows. Marked nodes found along the way are unlinked. If target is given, nodes with a key
+        // equivalent to key are passed over until target is reached, so that target itself is unlinked.
+        // Returns true if the node following at level 0 has a key equivalent to the given key.
+        TOOLS_FORCE_INLINE bool
+        search(
+            KeyT const & key,
+            Node * target,
+            LinkType volatile ** preds,
+            Node ** succs)
+        {
+            bool restart;
+            do {
+                restart = false;
+                Node * predNode = nullptr;
+                for (unsigned level = levelsUsed; level-- > 0U; ) {
+                    LinkType volatile * predLink = linkOf(predNode, level);
+                    LinkType link;
+                    link.reset(*predLink);
+                    if (isEnd(link)) {
+                        restart = true;
+                        break;
+                    }
+                    Node * curr = link.get();
+                    while (!!curr) {
+                        LinkType next;
+                        next.reset(curr->next_[level]);
+                        if (isEnd(next)) {
+                            // curr is being removed, help unlink it at this level
+                            LinkType prevLink = LinkType::make(curr);
+                            if (atomicCas(predLink, prevLink, LinkType::make(next.get())) != prevLink) {
+                                restart = true;
+                                break;
+                            }
+                            curr = next.get();
+                            continue;
+                        }
+                        if ((curr->key_ < key) || (!!target && (curr != target) && !(key < curr->key_))) {
+                            predNode = curr;
+                            predLink = &curr->next_[level];
+                            curr = next.get();
+                            continue;
+                        }
+                        break;
+                    }
+                    if (restart) {
+                        break;
+                    }
+                    preds[level] = predLink;
+                    succs[level] = curr;
+                }
+            } while (restart);
+            return !!succs[0] && !(key < succs[0]->key_);
+        }
+
+        // Make sure a removed node is unlinked at every level, then send it off to the phantom.
+        TOOLS_FORCE_INLINE void
+        unlinkAndFinalize(
+            Node * node)
+        {
+            LinkType volatile * preds[levelsUsed];
+            Node * succs[levelsUsed];
+            search(node->key_, node, preds, succs);
+            tools::phantomLocal< PhantomT >().finalize(tools::AutoDispose< tools::Weakling >(node));
+        }
+
+        // Geometric distribution with p = 1/2. The seed is updated without synchronization, a lost update
+        // only repeats a height.
+        TOOLS_FORCE_INLINE unsigned
+        randomHeight(void)
+        {
+            uint32 bits = levelSeed_;
+            bits ^= bits << 13;
+            bits ^= bits >> 17;
+            bits ^= bits << 5;
+            levelSeed_ = bits;
+            unsigned ret = 1U;
+            while ((ret < levelsUsed) && ((bits & 1U) != 0U)) {
+                ++ret;
+                bits >>= 1;
+            }
+            return ret;
+        }
+
+        LinkType volatile head_[levelsUsed];
+        uint8 pad0_[tools::detail::atomicCacheLineSize - ((sizeof(LinkType) * levelsUsed) % tools::detail::atomicCacheLineSize)];
+        uint32 volatile levelSeed_;
+        size_t volatile size_;
+    };
 }; // tools namespace
@@ -2555,6 +2555,8 @@ TOOLS_WARNINGS_RESTORE
         // Wait at most until the condition variable is signalled.  The active
         // monitor will be released while waiting and re-entered before returning.
         virtual void wait( void ) = 0;
+        // As above, but also return once this many nanoseconds have passed.
+        virtual void wait( uint64 ) = 0;
         // Signal at least one waiting monitor; if all is true, signal all monitors
         // currently waiting on this condition variable.  To prevent busy wakeups,
         // it's best if no monitor is held while calling signal.
@@ -8,6 +8,8 @@
 #include <tools/Threading.h>
 #include <tools/Tools.h>
 
+#include <vector>
+
 #include <boost/mpl/as_sequence.hpp>
 #include <boost/mpl/deref.hpp>
 #include <boost/mpl/empty_sequence.hpp>
@@ -46,6 +48,48 @@ namespace tools {
     {
     };
 
+    namespace impl {
+        ///
+        // An immutable table of the services an environment has factoried.  Environments publish a new
+        // one as they factory services, so finding a service that already exists takes neither a lock
+        // nor the environment's own maps.  Superseded snapshots live as long as the environment.
+        struct ServiceSnapshot
+        {
+            struct Slot
+            {
+                StringId name_;
+                Unknown * volatile service_;  // nullptr marks an empty slot, set after name_
+            };
+
+            TOOLS_FORCE_INLINE Slot const * find( StringId const & name ) const throw() {
+                for( size_t i = name.hash() & mask_;; i = ( i + 1U ) & mask_ ) {
+                    Slot const & slot = slots_[ i ];
+                    if( !atomicRead( &slot.service_ )) {
+                        return nullptr;
+                    }
+                    if( slot.name_ == name ) {
+                        return &slot;
+                    }
+                }
+            }
+
+            uint64 serial_;  // unique across all snapshots, never 0
+            size_t mask_;
+            std::vector< Slot > slots_;
+            ServiceSnapshot * retired_;  // the smaller snapshot this one replaced
+        };
+
+        // Where ServiceT was last found, as a snapshot serial (upper 40 bits) and slot (lower 24 bits).
+        template< typename ServiceT >
+        struct ServiceCallCache
+        {
+            static uint64 volatile * ticket( void ) throw() {
+                static uint64 volatile ticket_;
+                return &ticket_;
+            }
+        };
+    };  // impl namespace
+
     ///
     // This is the environment, and it represents the foundation of role virtualization and
     // the source of all tools that are not process global.  It contains references to objects
@@ -62,22 +106,45 @@ namespace tools {
     //
     // The lifetime of the environment is managed outside of its interface, and is likely
     // described by the factory that creates it.
+    //
+    // Environments may publish an impl::ServiceSnapshot.  The typed gets look there first, remembering
+    // per service type where they found it, so once services have started fetching one is a couple of loads.
+    // The environments created below may be used from any thread; they factory one service at a time.
     struct Environment
     {
+        Environment( void ) : snapshot_( nullptr ) {}
+
         virtual StringId const & name( void ) = 0;
         virtual Unknown * get( StringId const & ) = 0;
 
         template< typename ServiceT >
         typename tools::ServiceInterfaceOf< ServiceT >::Type * get( ServiceT *** = nullptr ) {
-            Unknown * ret = get( tools::ServiceName< ServiceT >() );
+            Unknown * ret = getCached( tools::ServiceName< ServiceT >(), impl::ServiceCallCache< ServiceT >::ticket() );
             return !!ret ? ret->getInterface< typename tools::ServiceInterfaceOf< ServiceT >::Type >() : nullptr;
         }
 
         template< typename ServiceT, typename ItfT >
         ItfT * get( ServiceT *** = nullptr, ItfT *** = nullptr ) {
-            Unknown * ret = get( tools::ServiceName< ServiceT >() );
+            Unknown * ret = getCached( tools::ServiceName< ServiceT >(), impl::ServiceCallCache< ServiceT >::ticket() );
             return !!ret ? ret->getInterface< ItfT >() : nullptr;
         }
+
+        TOOLS_FORCE_INLINE Unknown * getCached( StringId const & name, uint64 volatile * ticket ) {
+            impl::ServiceSnapshot const * snapshot = atomicRead( &snapshot_ );
+            if( TOOLS_LIKELY( !!snapshot )) {
+                uint64 last = atomicRead( ticket );
+                if( TOOLS_LIKELY( ( last >> 24 ) == snapshot->serial_ )) {
+                    return snapshot->slots_[ static_cast< size_t >( last & 0xFFFFFFU ) ].service_;
+                }
+                if( impl::ServiceSnapshot::Slot const * slot = snapshot->find( name )) {
+                    atomicSet( ticket, ( snapshot->serial_ << 24 ) | static_cast< uint64 >( slot - snapshot->slots_.data() ));
+                    return slot->service_;
+                }
+            }
+            return get( name );
+        }
+    protected:
+        impl::ServiceSnapshot * volatile snapshot_;
     };
 
     ///
@@ -97,11 +164,18 @@ namespace tools {
     // will respond to fetching impl::Service to give access to it's second stage initialization and
     // termination.
     //
+    // Second stage initialization follows the dependency graph: each service starts once every service
+    // it fetched during its construction has started, and independent services start concurrently.  A
+    // service whose start fails keeps its dependents from starting, but not unrelated services.  The
+    // start reports the error of the earliest factoried service to fail.  Services factoried after
+    // start() are started as they are factoried.  A factory that (indirectly) gets the service it is
+    // building is a fatal error.
+    //
     // The AutoDispose passed in to this function is filled with a Disposable that controls the
     // lifetime of the returned environment.  Before this can be disposed, the owner must complete the
     // second stage termination (stop()) on the environment.  Failing to do so will at the least
-    // assert.  During second stage termination, all services will undergo their second stage
-    // termination in reverse order to how they were initialized.  During dispose, all services will
+    // assert.  During second stage termination, each started service will undergo its second stage
+    // termination once the services that depend on it have.  During dispose, all services will
     // be disposed in reverse order to how they were factoried.
     TOOLS_API Environment * NewTwoStageEnvironment( AutoDispose<> &, StringId const & = StringIdEmpty() );
 
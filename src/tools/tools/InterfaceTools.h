@@ -1,9 +1,61 @@
 #pragma once
 
+#include <tools/Algorithms.h>
 #include <tools/Interface.h>
 #include <tools/Memory.h>
 
+#include <boost/mpl/empty.hpp>
+#include <boost/mpl/size.hpp>
+#include <vector>
+
 namespace tools {
+    namespace impl {
+        // One interface a type implements: its name, and the cast from the implementation to it.
+        struct InterfaceEntry
+        {
+            StringId const * name_;
+            void * ( *cast_ )( void const * );
+        };
+
+        // A build-once perfect hash from interface name to entry, so that finding an interface takes one
+        // probe however many a type implements. Should distinct names share a 32 bit hash, all but the
+        // first are kept aside and searched after a miss. A name listed twice resolves to its first listing.
+        struct InterfaceTable
+            : tools::AllocStatic< Platform >
+        {
+            TOOLS_API InterfaceTable( InterfaceEntry const *, size_t );
+
+            TOOLS_FORCE_INLINE InterfaceEntry const * find( StringId const & name ) const throw() {
+                uint32 hash = static_cast< uint32 >( name.hash() );
+                InterfaceEntry const * entry = table_[ tools::impl::perfectHashSlot( hash, displacements_[ hash & ( buckets_ - 1U )], slots_ )];
+                if( TOOLS_LIKELY( !!entry && ( *entry->name_ == name ))) {
+                    return entry;
+                }
+                for( auto && collided : collided_ ) {
+                    if( *collided->name_ == name ) {
+                        return collided;
+                    }
+                }
+                return nullptr;
+            }
+
+            uint32 buckets_;
+            uint32 slots_;
+            std::vector< uint32 > displacements_;
+            std::vector< InterfaceEntry const * > table_;
+            std::vector< InterfaceEntry const * > collided_;
+            std::vector< InterfaceEntry > entries_;
+        };
+
+        // Each StandardUnknown builds its table once, on first use.
+        struct InterfaceTableStorage : SpecifyService< InterfaceTable const > {};
+
+        template< typename UnknownT >
+        inline InterfaceTable const * staticServiceCacheInit( InterfaceTableStorage ***, UnknownT *** ) {
+            return UnknownT::interfaceTableNew();
+        }
+    };  // impl namespace
+
     template< typename ImplementationT, typename SequenceT=boost::mpl::empty_sequence,
         typename IterfaceT=tools::Unknown, typename AllocT = tools::AllocStatic<> >
     struct StandardUnknown
@@ -14,21 +66,39 @@ namespace tools {
             return nullptr;
         }
     protected:
+        template< typename InterfaceT >
+        static void * interfaceCast( void const * impl ) throw() {
+            return static_cast< InterfaceT * >( const_cast< ImplementationT * >( static_cast< ImplementationT const * >( impl )));
+        }
+
         template< typename IteratorT >
-        void * getInterfaceImpl( StringId const & typeName, IteratorT * ) const throw() {
-            if (typeName == tools::nameOf< typename boost::mpl::deref< IteratorT >::type >() ) {
-                return static_cast< typename boost::mpl::deref< IteratorT >::type * >( const_cast< ImplementationT * >( static_cast< ImplementationT const * >( this )));
-            }
-            return getInterfaceImpl( typeName, static_cast< typename boost::mpl::next< IteratorT >::type * >( nullptr ));
+        static void interfaceEntries( tools::impl::InterfaceEntry * entry, IteratorT * ) {
+            typedef typename boost::mpl::deref< IteratorT >::type InterfaceT;
+            entry->name_ = &tools::nameOf< InterfaceT >();
+            entry->cast_ = &interfaceCast< InterfaceT >;
+            interfaceEntries( entry + 1, static_cast< typename boost::mpl::next< IteratorT >::type * >( nullptr ));
         }
 
         // This terminates the iteration.
-        void * getInterfaceImpl( StringId const & typeName, typename boost::mpl::end< SequenceT >::type * ) const throw() {
-            return static_cast< ImplementationT const * >( this )->getInterfaceDynamic( typeName );
+        static void interfaceEntries( tools::impl::InterfaceEntry *, typename boost::mpl::end< SequenceT >::type * ) {
         }
     public:
+        static tools::impl::InterfaceTable const * interfaceTableNew( void ) {
+            // One spare, as an empty sequence still needs an array.
+            tools::impl::InterfaceEntry entries[ boost::mpl::size< SequenceT >::value + 1U ];
+            interfaceEntries( entries, static_cast< typename boost::mpl::begin< SequenceT >::type * >( nullptr ));
+            return new tools::impl::InterfaceTable( entries, boost::mpl::size< SequenceT >::value );
+        }
+
         void * getInterface( StringId const & typeName ) const throw() {
-            return getInterfaceImpl( typeName, static_cast< typename boost::mpl::begin< SequenceT >::type * >( nullptr ) );
+            ImplementationT const * impl = static_cast< ImplementationT const * >( this );
+            if( !boost::mpl::empty< SequenceT >::value ) {
+                tools::impl::InterfaceEntry const * entry = tools::staticServiceCacheFetch< tools::impl::InterfaceTableStorage, StandardUnknown >()->find( typeName );
+                if( !!entry ) {
+                    return entry->cast_( impl );
+                }
+            }
+            return impl->getInterfaceDynamic( typeName );
         }
     };
 
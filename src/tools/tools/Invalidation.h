@@ -1,8 +1,13 @@
 #pragma once
 
+#include <tools/AtomicCollections.h>
 #include <tools/Concurrency.h>
 #include <tools/InterfaceTools.h>
 #include <tools/Async.h>
+#include <tools/WeakPointer.h>
+
+#include <string.h>
+#include <type_traits>
 
 namespace tools {
     // Abstract interface for things that can be invalidated.
@@ -188,4 +193,199 @@ namespace tools {
         tools::AtomicAny< ItemT > item_;
         tools::AutoDispose< tools::Publisher > publisher_;
     };
+    // A sequence-locked container for small, trivially copyable, read-mostly values. Readers never write
+    // shared memory: they sample the sequence, copy the value, and retry if a writer was active or the
+    // sequence moved. Writers are serialized against each other by the sequence itself (an odd sequence
+    // means a write is in progress), and publish an invalidation after every change.
+    //
+    // Writes should be rare and short. A reader that races a writer spins until the write finishes.
+    template< typename ItemT, typename AllocT = tools::AllocStatic<> >
+    struct SeqLocked
+        : tools::StandardDisposable< SeqLocked< ItemT, AllocT >, tools::Publisher, AllocT >
+    {
+        static_assert( std::is_trivially_copyable< ItemT >::value, "SeqLocked requires a trivially copyable type" );
+
+        SeqLocked( tools::AutoDispose< tools::Publisher > && pub = tools::simplePublisherNew() )
+            : sequence_( 0U )
+            , item_( ItemT() )
+            , publisher_( std::move( pub ))
+        {}
+        SeqLocked( ItemT const & i, tools::AutoDispose< tools::Publisher > && pub = tools::simplePublisherNew() )
+            : sequence_( 0U )
+            , item_( i )
+            , publisher_( std::move( pub ))
+        {}
+
+        // Publisher
+        AutoDispose<> newSubscription( Thunk const & thunk, Thunk const & dead )
+        {
+            return publisher_->newSubscription( thunk, dead );
+        }
+        void invalidate( void )
+        {
+            publisher_->invalidate();
+        }
+
+        // local methods
+        ItemT get( void ) const
+        {
+            ItemT ret;
+            for( ;; ) {
+                uint32 before = tools::atomicRead( &sequence_ );
+                if( ( before & 1U ) != 0U ) {
+                    // A write is in progress
+                    tools::detail::atomicSpinPause();
+                    continue;
+                }
+                tools::detail::atomicAcquireFence();
+                memcpy( &ret, &item_, sizeof( ItemT ));
+                // The copy is complete before the sequence is checked again.
+                tools::detail::atomicAcquireFence();
+                if( tools::atomicRead( &sequence_ ) == before ) {
+                    return ret;
+                }
+            }
+        }
+        // A cheap way to tell if anything has been written since a previous call. This is always even.
+        uint32 version( void ) const
+        {
+            return tools::atomicRead( &sequence_ ) & ~1U;
+        }
+        void set( ItemT const & i )
+        {
+            update( [&i]( ItemT & ref )->void {
+                ref = i;
+            });
+        }
+        // Modify the value in place while holding the write side. The signature of the function is:
+        //     (ItemT &)->void
+        // If the function throws, the write side is still released and the change published, as the value
+        // may already be partly modified.
+        template< typename FuncT >
+        void update( FuncT && func )
+        {
+            uint32 seq;
+            for( ;; ) {
+                seq = tools::atomicRead( &sequence_ );
+                if( ( ( seq & 1U ) == 0U ) && ( tools::atomicCas( &sequence_, seq, seq + 1U ) == seq )) {
+                    break;
+                }
+                tools::detail::atomicSpinPause();
+            }
+            struct Release
+            {
+                ~Release( void )
+                {
+                    // The value is written before the sequence is even again.
+                    tools::detail::atomicReleaseFence();
+                    tools::atomicSet( &this_->sequence_, next_ );
+                    this_->publisher_->invalidate();
+                }
+
+                SeqLocked * this_;
+                uint32 next_;
+            } release = { this, seq + 2U };
+            // Readers see the odd sequence before any of the value changes.
+            tools::detail::atomicReleaseFence();
+            func( item_ );
+        }
+    protected:
+        uint32 volatile sequence_;
+        ItemT item_;
+        tools::AutoDispose< tools::Publisher > publisher_;
+    };
+
+    // An atomically swapped pointer to an immutable snapshot, for larger read-mostly state. Each write
+    // allocates a new version, swaps it in, and retires the previous version through the phantom of the
+    // given type. Readers must be cloaked in that phantom (see phantomTryBindPrototype) and may use a peeked
+    // snapshot for as long as they stay cloaked. Reading is a single pointer load.
+    template< typename ItemT, typename PhantomT = tools::PhantomUniversal, typename AllocT = tools::AllocStatic<> >
+    struct VersionedPtr
+        : tools::StandardDisposable< VersionedPtr< ItemT, PhantomT, AllocT >, tools::Publisher, AllocT >
+    {
+        struct Version
+            : tools::StandardPhantom< Version, AllocT >
+        {
+            Version( ItemT const & i, uint64 v ) : item_( i ), version_( v ) {}
+            Version( ItemT && i, uint64 v ) : item_( std::move( i )), version_( v ) {}
+
+            ItemT const item_;
+            uint64 const version_;
+        };
+
+        VersionedPtr( tools::AutoDispose< tools::Publisher > && pub = tools::simplePublisherNew() )
+            : current_( nullptr )
+            , publisher_( std::move( pub ))
+        {}
+        VersionedPtr( ItemT const & i, tools::AutoDispose< tools::Publisher > && pub = tools::simplePublisherNew() )
+            : current_( new Version( i, 1U ))
+            , publisher_( std::move( pub ))
+        {}
+        ~VersionedPtr( void )
+        {
+            if( Version * last = current_ ) {
+                tools::AutoDispose<> cloak( tools::phantomTryBindPrototype< PhantomT >() );
+                tools::phantomLocal< PhantomT >().finalize( tools::AutoDispose< tools::Weakling >( last ));
+            }
+        }
+
+        // Publisher
+        AutoDispose<> newSubscription( Thunk const & thunk, Thunk const & dead )
+        {
+            return publisher_->newSubscription( thunk, dead );
+        }
+        void invalidate( void )
+        {
+            publisher_->invalidate();
+        }
+
+        // local methods
+        // Return the current snapshot, or nullptr if none has been set. The snapshot remains valid while the
+        // calling thread stays cloaked.
+        ItemT const * peek( void ) const
+        {
+            TOOLS_ASSERT( tools::phantomVerifyIsCloaked< PhantomT >() );
+            Version * current = tools::atomicRead( &current_ );
+            return !!current ? &current->item_ : nullptr;
+        }
+        // The version of the current snapshot, 0 if none has been set.
+        uint64 version( void ) const
+        {
+            tools::AutoDispose<> cloak( tools::phantomTryBindPrototype< PhantomT >() );
+            Version * current = tools::atomicRead( &current_ );
+            return !!current ? current->version_ : 0U;
+        }
+        void set( ItemT const & i )
+        {
+            update( [&i]( ItemT const * )->ItemT {
+                return i;
+            });
+        }
+        // Derive a new snapshot from the current one (nullptr if there is none). If another writer gets in
+        // first, the function is called again with the newer snapshot. The signature of the function is:
+        //     (ItemT const *)->ItemT
+        template< typename FuncT >
+        void update( FuncT && func )
+        {
+            tools::AutoDispose<> cloak( tools::phantomTryBindPrototype< PhantomT >() );
+            Version * prev = tools::atomicRead( &current_ );
+            for( ;; ) {
+                Version * next = new Version( func( !!prev ? &prev->item_ : nullptr ), !!prev ? ( prev->version_ + 1U ) : 1U );
+                Version * actual = tools::atomicCas( &current_, prev, next );
+                if( actual == prev ) {
+                    break;
+                }
+                // Never visible to anyone else
+                delete next;
+                prev = actual;
+            }
+            if( !!prev ) {
+                tools::phantomLocal< PhantomT >().finalize( tools::AutoDispose< tools::Weakling >( prev ));
+            }
+            publisher_->invalidate();
+        }
+    protected:
+        Version * volatile current_;
+        tools::AutoDispose< tools::Publisher > publisher_;
+    };
 };  // namespace tools
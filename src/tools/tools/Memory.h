@@ -198,6 +198,10 @@ namespace tools {
         TOOLS_API bool regionIsUnmapped( void *, size_t );
         TOOLS_API bool regionIsPartiallyUnmapped( void *, size_t );
         TOOLS_API void * safeMalloc( size_t );
+        // Zeroed, cache line aligned memory for per-CPU counters. This comes from the untracked system heap as
+        // memory tracking itself keeps ScalableCounters.
+        TOOLS_API void * cpuSlotsAlloc( size_t );
+        TOOLS_API void cpuSlotsFree( void * );
     };  // impl namespace
     TOOLS_API AutoDispose<> poolUniqueAddrVmemNew( Pool **, impl::ResourceSample const &, size_t, size_t, unsigned );
     TOOLS_API Heap & heapHuge( void );
@@ -3,6 +3,7 @@
 #include <tools/Interface.h>
 #include <tools/InterfaceTools.h>
 #include <tools/Meta.h>
+#include <tools/StartupProfile.h>
 #include <tools/String.h>
 #include <tools/Tools.h>
 
@@ -14,6 +15,12 @@ namespace tools {
     // Fetch a registered item by name (or return nullptrptr if no such entry was found)
     TOOLS_API void * registryFetch( StringId const &, StringId const & ) throw();
 
+    // Index everything registered so far in a read-only perfect hash, so that fetches take one hash and
+    // one probe. Call this once static registration has settled (e.g. after startup). Inserts and removals
+    // keep working afterwards, later insertions simply land in a small overflow table. Only the first call
+    // has any effect.
+    TOOLS_API void registryFreeze( void ) throw();
+
     // Typesafe accessors
     template< typename ServiceT >
     typename tools::ServiceInterfaceOf< ServiceT >::Type * registryFetch( StringId const & type, ServiceT *** = 0 ) {
@@ -167,6 +174,7 @@ namespace tools {
     TOOLS_NO_INLINE inline void registryAutoInsert( ServiceT *** = 0, TypeT *** = 0 ) {
         static tools::AutoDispose<> register_;
         if( !register_ ) {
+            tools::StartupProfileScope profile( "autoRegister", tools::nameOf< ServiceT >(), tools::nameOf< TypeT >() );
             registryAutoDepends(static_cast<ServiceT ***>(nullptr), static_cast<TypeT ***>(nullptr));
             if( !register_ ) {
                 register_ = tools::registryFetch< AutoRegister, ServiceT >()->insert( tools::nameOf< TypeT >(), tools::detail::AutoFactoryRegister< ServiceT, TypeT >::storage() );
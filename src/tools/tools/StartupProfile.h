@@ -0,0 +1,78 @@
+#pragma once
+
+#include <tools/String.h>
+#include <tools/Tools.h>
+
+#include <stdio.h>
+#include <vector>
+
+namespace tools {
+    ///
+    // The startup profile answers where the time to come up goes.  While it is recording, each
+    // AutoRegister insertion, registry factory link, environment factory and service start is a frame
+    // that records its wall and CPU time, what it allocated through the tracked affinities, and the
+    // frame it ran inside of.  A frame that starts inside another is one of its dependencies.
+    //
+    // Recording is on from static initialization when the TOOLS_STARTUP_PROFILE environment variable
+    // is set, and ends at startupProfileFinish().  If the variable is anything other than 1, it names
+    // a file that the frames are also written to as folded stacks (one line per frame path and its self
+    // time in microseconds), which flame graph tools take as is.  TOOLS_STARTUP_PROFILE_SORT picks the
+    // report's order: wall (the default), self, cpu, allocs or bytes.
+    enum StartupProfileSort {
+        StartupProfileSortWall,
+        StartupProfileSortSelf,  // wall, less that of the frames that ran inside it
+        StartupProfileSortCpu,
+        StartupProfileSortAllocs,
+        StartupProfileSortBytes,
+    };
+
+    struct StartupProfileEntry
+    {
+        char const * kind_;
+        StringId name_;
+        StringId detail_;
+        size_t parent_;  // index of the enclosing entry, or SIZE_MAX
+        std::vector< size_t > needs_;  // entries that ran inside this one
+        uint64 wall_;  // nanoseconds, from beginning to completion (asynchronous starts included)
+        uint64 self_;
+        uint64 cpu_;  // nanoseconds on the thread(s) while it ran synchronously
+        uint64 allocs_;
+        uint64 bytes_;
+    };
+
+    namespace impl {
+        TOOLS_API bool startupProfileRecording( void );
+        TOOLS_API void * startupProfileEnter( char const *, StringId const &, StringId const & );
+        // Stop attributing this thread's time and allocations to the frame, while it continues
+        // asynchronously.
+        TOOLS_API void startupProfileDetach( void * );
+        TOOLS_API void startupProfileLeave( void * );
+        // Called by the tracked affinities.
+        TOOLS_API void startupProfileNoteAlloc( size_t );
+        // Throw away what has been recorded and start again, or stop.  Only for when nothing is being
+        // profiled (e.g. tests).
+        TOOLS_API void startupProfileReset( bool );
+    };  // impl namespace
+
+    // Finished frames, ordered as requested.  Parent and needs indices refer to the returned vector.
+    TOOLS_API std::vector< StartupProfileEntry > startupProfileEntries( StartupProfileSort = StartupProfileSortWall );
+    TOOLS_API void startupProfileReport( FILE *, StartupProfileSort = StartupProfileSortWall );
+    // Stop recording and write out the report (to stderr) and folded stacks as configured. This
+    // does nothing unless recording.
+    TOOLS_API void startupProfileFinish( void );
+
+    // A frame covering the enclosing scope, if the profile is recording.
+    struct StartupProfileScope
+    {
+        StartupProfileScope( char const * kind, StringId const & name, StringId const & detail = StringIdNull() )
+            : frame_( impl::startupProfileRecording() ? impl::startupProfileEnter( kind, name, detail ) : nullptr )
+        {}
+        ~StartupProfileScope( void ) {
+            if( !!frame_ ) {
+                impl::startupProfileLeave( frame_ );
+            }
+        }
+
+        void * frame_;
+    };
+};  // tools namespace
@@ -11,6 +11,12 @@
 #include <wchar.h>
 #include <string>
 #include <iostream>
+#if defined(__has_include)
+#  if __has_include(<string_view>) && ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#    include <string_view>
+#    define TOOLS_HAS_STRING_VIEW
+#  endif
+#endif
 
 namespace tools {
 #ifdef WINDOWS_PLATFORM
@@ -37,7 +43,7 @@ namespace tools {
             size_t length_;
 
 			StringIdData( void ) = delete;
-            StringIdData( char const * str, size_t hsh, size_t len ) : string_( str ), hash_( hsh ), length_( len ) {}
+            constexpr StringIdData( char const * str, size_t hsh, size_t len ) : string_( str ), hash_( hsh ), length_( len ) {}
             TOOLS_FORCE_INLINE bool operator==(StringIdData const & r) const {
                 bool ret = (string_ == r.string_);
                 if (!ret) {
@@ -50,15 +56,19 @@ namespace tools {
                 }
                 return ret;
             }
+            // Not lexicographic. This is the StringIdFastLess order (hash, length, then bytes unless the
+            // pointers match), which is all the intern table buckets need and rarely reads characters.
             TOOLS_FORCE_INLINE bool operator<(StringIdData const & r) const {
-                int cmp = strncmp(string_, r.string_, std::min(length_, r.length_));
-                bool ret = (cmp == 0);
-                if (ret) {
-                    ret = (length_ < r.length_);
-                } else {
-                    ret = (cmp < 0);
+                if (hash_ != r.hash_) {
+                    return hash_ < r.hash_;
                 }
-                return ret;
+                if (length_ != r.length_) {
+                    return length_ < r.length_;
+                }
+                if (string_ == r.string_) {
+                    return false;
+                }
+                return memcmp(string_, r.string_, length_) < 0;
             }
         };
 
@@ -66,9 +76,42 @@ namespace tools {
         {
             return static_cast<uint32>(sid.hash_ & 0xFFFFFFFF);
         }
+
+        enum : uint32 {
+            stringIdHashSeed = 0x5EED5EEDU,
+        };
+
+        // The hash a StringId of these characters has.
+        TOOLS_FORCE_INLINE size_t stringIdHash( char const * str, size_t len )
+        {
+            return tools::impl::hashBytes( str, len, stringIdHashSeed );
+        }
+
+        // A string literal with its StringId hash and length computed at compile time. Declared constexpr,
+        // this lives entirely in read-only data. It is not interned until converted to a StringId, and
+        // comparing one against a StringId needs neither the table nor hashing.
+        struct StringIdLiteral
+            : StringIdData
+        {
+            constexpr StringIdLiteral( char const * str, size_t len )
+                : StringIdData( str, tools::impl::constHashBytes( str, len, stringIdHashSeed ), len )
+            {}
+        };
     };  // namespace impl
 
     TOOLS_API StringId StaticStringId( char const * ) throw();
+    // Interns the literal as a static record, without copying or hashing its characters.
+    TOOLS_API StringId StaticStringId( impl::StringIdLiteral const & ) throw();
+    // The interned StringId for the given characters, or a null StringId if they are not interned. This
+    // never interns, and never allocates.
+    TOOLS_API StringId StringIdInterned( char const *, size_t ) throw();
+    // Write every interned string to a snapshot file, for stringIdSnapshotMap() on a later start. Returns
+    // false if the file could not be written.
+    TOOLS_API bool stringIdSnapshotWrite( char const * ) throw();
+    // Map a snapshot file read-only. Strings found in it are interned as static records over the mapped
+    // characters; others are interned as usual. Only one snapshot is ever mapped, call this early in startup.
+    // Returns false if the file is missing, invalid or another snapshot is already mapped.
+    TOOLS_API bool stringIdSnapshotMap( char const * ) throw();
 
     class StringId
     {
@@ -78,6 +121,8 @@ namespace tools {
 #endif // STRINGID_DEBUGGING
         TOOLS_API void fillInStringId( char const *, sint32 ) throw();
         friend StringId tools::StaticStringId( char const * ) throw();
+        friend StringId tools::StaticStringId( impl::StringIdLiteral const & ) throw();
+        friend StringId tools::StringIdInterned( char const *, size_t ) throw();
         TOOLS_FORCE_INLINE StringId( impl::StringIdData * data )
             : data_( data )
 #ifdef STRINGID_DEBUGGING
@@ -93,11 +138,30 @@ namespace tools {
         {}
         TOOLS_FORCE_INLINE StringId( char const * str, sint32 cnt = -1 ) throw() { fillInStringId( str, cnt ); }
         TOOLS_API StringId( StringId const & ) throw();
+        // Moves take the reference without touching the record or the table.
+        TOOLS_FORCE_INLINE StringId( StringId && sid ) throw()
+            : data_( sid.data_ )
+#ifdef STRINGID_DEBUGGING
+            , thisPointer_( this )
+#endif // STRINGID_DEBUGGING
+        {
+            sid.data_ = nullptr;
+        }
         TOOLS_FORCE_INLINE StringId( std::string const & str ) throw() { fillInStringId( str.c_str(), boost::numeric_cast<sint32>(str.length()) ); }
+        TOOLS_FORCE_INLINE StringId( impl::StringIdLiteral const & lit ) throw() : StringId( tools::StaticStringId( lit )) {}
         TOOLS_API ~StringId( void ) throw();
         TOOLS_FORCE_INLINE StringId & operator=( StringId const & sid ) throw() {
             return copy( sid );
         }
+        // Our previous value is released and the moved-from StringId is left null.
+        TOOLS_FORCE_INLINE StringId & operator=( StringId && sid ) throw() {
+            if( this != &sid ) {
+                StringId prev( data_ );
+                data_ = sid.data_;
+                sid.data_ = nullptr;
+            }
+            return *this;
+        }
         TOOLS_FORCE_INLINE bool operator==( StringId const & sid ) const throw() {
             bool ret = (data_ == sid.data_);
             if (!ret && !!data_ && !!sid.data_) {
@@ -132,6 +196,19 @@ namespace tools {
             }
             return str != data_->string_;
         }
+        // Interned from this literal is a pointer check, anything else is almost always settled by the hash.
+        TOOLS_FORCE_INLINE bool operator==( impl::StringIdLiteral const & lit ) const throw() {
+            if( !data_ ) {
+                return false;
+            }
+            if( data_->string_ == lit.string_ ) {
+                return data_->length_ == lit.length_;
+            }
+            return ( data_->hash_ == lit.hash_ ) && ( data_->length_ == lit.length_ ) && ( memcmp( data_->string_, lit.string_, lit.length_ ) == 0 );
+        }
+        TOOLS_FORCE_INLINE bool operator!=( impl::StringIdLiteral const & lit ) const throw() {
+            return !operator==( lit );
+        }
         TOOLS_FORCE_INLINE sint32 compareTo( StringId const & str ) const throw() {
             if( !str.data_ ) {
                 return ( !data_ ? 0 : 1 );
@@ -224,6 +301,14 @@ namespace tools {
         return sid == str;
     }
 
+    TOOLS_FORCE_INLINE bool operator==( impl::StringIdLiteral const & lit, StringId const & sid ) {
+        return sid == lit;
+    }
+
+    TOOLS_FORCE_INLINE bool operator!=( impl::StringIdLiteral const & lit, StringId const & sid ) {
+        return sid != lit;
+    }
+
     TOOLS_FORCE_INLINE bool operator!=( char const * str, StringId const & sid ) {
         return sid != str;
     }
@@ -247,6 +332,127 @@ namespace tools {
     // TOOLS_API StringId Widen( char const *, sint32 = -1 );
     // TOOLS_API StringId Widen( std::string const & );
 
+    TOOLS_FORCE_INLINE StringId StringIdInterned( char const * str ) throw() {
+        return !str ? StringId() : StringIdInterned( str, strlen( str ));
+    }
+
+    TOOLS_FORCE_INLINE StringId StringIdInterned( std::string const & str ) throw() {
+        return StringIdInterned( str.data(), str.size() );
+    }
+
+#ifdef TOOLS_HAS_STRING_VIEW
+    TOOLS_FORCE_INLINE StringId StringIdInterned( std::string_view str ) throw() {
+        return StringIdInterned( str.data(), str.size() );
+    }
+#endif // TOOLS_HAS_STRING_VIEW
+
+    // A fast total order on StringIds: null first, then by hash, then length, then bytes (skipped when both
+    // share a record). This is not lexicographic; use it where any consistent order will do, such as map keys.
+    struct StringIdFastLess
+    {
+        typedef void is_transparent;
+
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, StringId const & r ) const throw() {
+            return less( l.c_str(), l.hash(), l.length(), r.c_str(), r.hash(), r.length() );
+        }
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, impl::StringIdLiteral const & r ) const throw() {
+            return less( l.c_str(), l.hash(), l.length(), r.string_, r.hash_, r.length_ );
+        }
+        TOOLS_FORCE_INLINE bool operator()( impl::StringIdLiteral const & l, StringId const & r ) const throw() {
+            return less( l.string_, l.hash_, l.length_, r.c_str(), r.hash(), r.length() );
+        }
+
+        static TOOLS_FORCE_INLINE bool less( char const * l, size_t lHash, size_t lLen, char const * r, size_t rHash, size_t rLen ) throw() {
+            if( !l || !r ) {
+                return !l && !!r;
+            }
+            if( lHash != rHash ) {
+                return lHash < rHash;
+            }
+            if( lLen != rLen ) {
+                return lLen < rLen;
+            }
+            return ( l != r ) && ( memcmp( l, r, lLen ) < 0 );
+        }
+    };
+
+    // Transparent hash and equality for StringId keyed containers. The hash of characters is the hash the
+    // equivalent StringId has, so other key types may be used for heterogeneous lookup without interning.
+    struct StringIdHash
+    {
+        typedef void is_transparent;
+
+        TOOLS_FORCE_INLINE size_t operator()( StringId const & sid ) const throw() {
+            return sid.hash();
+        }
+        TOOLS_FORCE_INLINE size_t operator()( char const * str ) const throw() {
+            return !str ? 0U : impl::stringIdHash( str, strlen( str ));
+        }
+        TOOLS_FORCE_INLINE size_t operator()( std::string const & str ) const throw() {
+            return impl::stringIdHash( str.data(), str.size() );
+        }
+        TOOLS_FORCE_INLINE size_t operator()( impl::StringIdLiteral const & lit ) const throw() {
+            return lit.hash_;
+        }
+#ifdef TOOLS_HAS_STRING_VIEW
+        TOOLS_FORCE_INLINE size_t operator()( std::string_view str ) const throw() {
+            return impl::stringIdHash( str.data(), str.size() );
+        }
+#endif // TOOLS_HAS_STRING_VIEW
+    };
+
+    struct StringIdEqual
+    {
+        typedef void is_transparent;
+
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, StringId const & r ) const throw() {
+            return l == r;
+        }
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, char const * r ) const throw() {
+            return l == r;
+        }
+        TOOLS_FORCE_INLINE bool operator()( char const * l, StringId const & r ) const throw() {
+            return r == l;
+        }
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, std::string const & r ) const throw() {
+            return l == r;
+        }
+        TOOLS_FORCE_INLINE bool operator()( std::string const & l, StringId const & r ) const throw() {
+            return r == l;
+        }
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, impl::StringIdLiteral const & r ) const throw() {
+            return l == r;
+        }
+        TOOLS_FORCE_INLINE bool operator()( impl::StringIdLiteral const & l, StringId const & r ) const throw() {
+            return r == l;
+        }
+#ifdef TOOLS_HAS_STRING_VIEW
+        TOOLS_FORCE_INLINE bool operator()( StringId const & l, std::string_view r ) const throw() {
+            return !!l && ( l.length() == r.size() ) && ( memcmp( l.c_str(), r.data(), r.size() ) == 0 );
+        }
+        TOOLS_FORCE_INLINE bool operator()( std::string_view l, StringId const & r ) const throw() {
+            return operator()( r, l );
+        }
+#endif // TOOLS_HAS_STRING_VIEW
+    };
+
+    // Find a key in a StringId keyed map without interning it. With C++20 heterogeneous unordered lookup (and
+    // StringIdHash/StringIdEqual) this is the container's own find. Otherwise characters which are not
+    // interned cannot match any StringId key, and those which are convert without allocating.
+    template< typename MapT, typename KeyT >
+    inline typename MapT::iterator stringIdFind( MapT & map, KeyT const & key )
+    {
+#ifdef __cpp_lib_generic_unordered_lookup
+        return map.find( key );
+#else // __cpp_lib_generic_unordered_lookup
+        StringId sid( StringIdInterned( key ));
+        if( !sid ) {
+            return map.end();
+        }
+        return map.find( sid );
+#endif // __cpp_lib_generic_unordered_lookup
+    }
+
     TOOLS_FORCE_INLINE std::ostream & operator<<( std::ostream & stream, StringId const & str ) {
         return ( !!str ? ( stream << str.c_str() ) : ( stream << "(NULL)" ) );
     }
@@ -262,6 +468,24 @@ namespace tools {
     }
 };  // namespace tools
 
+namespace tools {
+    namespace literals {
+        // "name"_sid is a compile time impl::StringIdLiteral, after using namespace tools::literals. Bind it to a
+        // constexpr variable to be sure the hash is computed by the compiler. The compile time hash recurses once
+        // per 24 characters, so literals over about 10,000 characters exceed the usual constexpr depth limit of
+        // 512; bound to a constexpr variable they fail to compile, otherwise they are hashed at runtime.
+        constexpr tools::impl::StringIdLiteral operator "" _sid( char const * str, size_t len ) { return tools::impl::StringIdLiteral( str, len ); }
+    };  // namespace literals
+};  // namespace tools
+
+// A StringId const & for a string literal. The literal, hash and length are constant data, and the StringId is
+// interned on first use (once per expansion site) without hashing or copying the characters.
+#define TOOLS_SID( str ) ([]() -> ::tools::StringId const & { \
+        static constexpr ::tools::impl::StringIdLiteral literal_( str, sizeof( str ) - 1U ); \
+        static ::tools::StringId const sid_( literal_ ); \
+        return sid_; \
+    }())
+
 namespace std {
     template<>
     struct hash< tools::StringId > {
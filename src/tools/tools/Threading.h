@@ -4,6 +4,7 @@
 #include <tools/Interface.h>
 #include <tools/InterfaceTools.h>
 #include <tools/Async.h>
+#include <tools/Memory.h>
 #include <tools/String.h>
 #include <tools/Tools.h>
 
@@ -14,6 +15,14 @@ namespace tools {
     namespace impl {
         TOOLS_API uint64 threadId( void );
         TOOLS_API uint32 cpuNumber( void );
+        // The number of distinct values cpuNumber() may return. This counts configured CPUs rather than
+        // just those presently online, as CPU numbers are not dense once CPUs have been taken offline.
+        TOOLS_API uint32 cpuCount( void );
+        // Add to the slot for the current CPU, without a locked instruction, using a restartable sequence.
+        // Slots are 'stride' bytes apart. This returns false (having added nothing) if the current thread
+        // cannot use restartable sequences, the CPU number is not below 'slotCount', or the sequence was
+        // interrupted. The caller should then fall back to an atomic add.
+        TOOLS_API bool cpuLocalAdd( uint64 volatile * slots, size_t stride, unsigned slotCount, uint64 delta );
         TOOLS_API void * threadLocalGet( void * );
 
         // Lightweight concurrency object used to allow threads to sleep and be woken by other threads.
@@ -310,33 +319,38 @@ namespace tools {
 
 	struct TaskScheduler : SpecifyService< ThreadScheduler > {};
 
+    // A counter that scales with contention by keeping a slot per CPU. Increments are cheap (see
+    // impl::cpuLocalAdd). Reading sums all of the slots, and so is more expensive.
     struct ScalableCounter
     {
-        enum : unsigned {
-            maxNumCpus = 64U,
-        };
-
         struct Data
         {
-            Data( void ) : count_( 0ULL ) {}
-
             uint64 volatile count_;
             uint64 pad_[ 7 ];  // fill out cache line
         };
 
-        ScalableCounter( void ) {}
+        ScalableCounter( void )
+            : slotCount_( tools::impl::cpuCount() )
+        {
+            // Leave an unused entry on either end to guarentee no false sharing with our neighbors.
+            vec_ = static_cast< Data * >( tools::impl::cpuSlotsAlloc( sizeof( Data ) * ( slotCount_ + 2U ))) + 1;
+        }
         ScalableCounter(ScalableCounter const &) = delete;
+        ~ScalableCounter( void )
+        {
+            tools::impl::cpuSlotsFree( vec_ - 1 );
+        }
 
         ScalableCounter & operator=(ScalableCounter const &) = delete;
 
         inline void operator+=( uint64 delta )
         {
-            unsigned id = tools::impl::cpuNumber();
-            unsigned idx = id + 1;  // leave entry 0 empty to guarentee no false sharing.  See note above.
-            TOOLS_ASSERT( idx < ( vec_.size() - 1 ));
+            if( TOOLS_LIKELY( tools::impl::cpuLocalAdd( &vec_->count_, sizeof( Data ), slotCount_, delta ))) {
+                return;
+            }
             // Use atomics, we might migrate between looking up the CPU number and indexing into the array.
             // This isn't so bad as most of the time we will still be there, so there is no contention.
-            tools::atomicAdd( &vec_[ idx ].count_, delta );
+            tools::atomicAdd( &vec_[ tools::impl::cpuNumber() % slotCount_ ].count_, delta );
         }
         inline void operator-=( uint64 delta )
         {
@@ -346,14 +360,120 @@ namespace tools {
         inline operator uint64( void )
         {
             // This is very racy. But it is close enough to be very useful.
-            TOOLS_ASSERT( vec_.size() >= 2 );
-            // The first and last entry in the vector are unused (to prevent false sharing, see above), so
-            // skip them.
-            return std::accumulate( vec_.begin() + 1, vec_.end() - 1, static_cast< uint64 >( 0 ), []( uint64 left, Data const & right) { return left + tools::atomicRead( &right.count_ ); });
+            return std::accumulate( vec_, vec_ + slotCount_, static_cast< uint64 >( 0 ), []( uint64 left, Data const & right) { return left + tools::atomicRead( &right.count_ ); });
+        }
+
+    private:
+        unsigned slotCount_;
+        Data * vec_;
+    };
+
+    // A latency (or any other uint64 measure) histogram, with the same per-CPU recording scheme as
+    // ScalableCounter. Buckets are log-linear: each power of 2 is split into subBuckets linear buckets,
+    // which bounds the relative error of any bucket at 1/subBuckets. Values below subBuckets get exact
+    // buckets.
+    struct ScalableHistogram
+    {
+        enum : unsigned {
+            subBucketBits = 3U,
+            subBuckets = 1U << subBucketBits,
+            bucketCount = ( 64U - subBucketBits + 1U ) * subBuckets,
+        };
+
+        ScalableHistogram( void )
+            : slotCount_( tools::impl::cpuCount() )
+        {
+            // Each CPU gets a whole number of cache lines, plus an unused line on either end.
+            static_assert( ( ( sizeof( uint64 ) * bucketCount ) % 64U ) == 0U, "Histogram rows should fill out cache lines" );
+            vec_ = static_cast< uint64 volatile * >( tools::impl::cpuSlotsAlloc( ( sizeof( uint64 ) * bucketCount * slotCount_ ) + 128U )) + 8U;
+        }
+        ScalableHistogram(ScalableHistogram const &) = delete;
+        ~ScalableHistogram( void )
+        {
+            tools::impl::cpuSlotsFree( const_cast< uint64 * >( vec_ - 8U ));
+        }
+
+        ScalableHistogram & operator=(ScalableHistogram const &) = delete;
+
+        static inline unsigned bucketOf( uint64 value )
+        {
+            if( value < subBuckets ) {
+                return static_cast< unsigned >( value );
+            }
+            unsigned high;
+#ifdef WINDOWS_PLATFORM
+            unsigned long index;
+            _BitScanReverse64( &index, value );
+            high = static_cast< unsigned >( index );
+#else // WINDOWS_PLATFORM
+            high = 63U - static_cast< unsigned >( __builtin_clzll( value ));
+#endif // WINDOWS_PLATFORM
+            unsigned shift = high - subBucketBits;
+            return (( high - subBucketBits + 1U ) << subBucketBits ) + static_cast< unsigned >(( value >> shift ) & ( subBuckets - 1U ));
+        }
+        // The smallest value that falls in a given bucket
+        static inline uint64 bucketLow( unsigned bucket )
+        {
+            if( bucket < subBuckets ) {
+                return bucket;
+            }
+            unsigned shift = ( bucket >> subBucketBits ) - 1U;
+            return static_cast< uint64 >( subBuckets + ( bucket & ( subBuckets - 1U ))) << shift;
+        }
+        // The largest value that falls in a given bucket
+        static inline uint64 bucketHigh( unsigned bucket )
+        {
+            return ( bucket + 1U < bucketCount ) ? ( bucketLow( bucket + 1U ) - 1U ) : ~static_cast< uint64 >( 0U );
+        }
+
+        inline void record( uint64 value, uint64 count = 1U )
+        {
+            uint64 volatile * row = vec_ + bucketOf( value );
+            if( TOOLS_LIKELY( tools::impl::cpuLocalAdd( row, sizeof( uint64 ) * bucketCount, slotCount_, count ))) {
+                return;
+            }
+            tools::atomicAdd( row + ( static_cast< size_t >( tools::impl::cpuNumber() % slotCount_ ) * bucketCount ), count );
+        }
+
+        // Sum the per-CPU rows into 'buckets' (which must have bucketCount entries), returning the total
+        // count. Like ScalableCounter, this is racy with concurrent recording.
+        inline uint64 collect( uint64 * buckets ) const
+        {
+            uint64 ret = 0U;
+            for( unsigned b = 0U; b != bucketCount; ++b ) {
+                uint64 sum = 0U;
+                for( unsigned cpu = 0U; cpu != slotCount_; ++cpu ) {
+                    sum += tools::atomicRead( vec_ + ( static_cast< size_t >( cpu ) * bucketCount ) + b );
+                }
+                buckets[ b ] = sum;
+                ret += sum;
+            }
+            return ret;
+        }
+
+        // Estimate the value at a given quantile (0.0 - 1.0). This returns the upper bound of the bucket
+        // holding the quantile, or 0 if nothing has been recorded.
+        inline uint64 quantile( double q ) const
+        {
+            std::array< uint64, bucketCount > buckets;
+            uint64 total = collect( buckets.data() );
+            if( total == 0U ) {
+                return 0U;
+            }
+            uint64 target = static_cast< uint64 >( q * static_cast< double >( total ));
+            uint64 seen = 0U;
+            for( unsigned b = 0U; b != bucketCount; ++b ) {
+                seen += buckets[ b ];
+                if( seen > target ) {
+                    return bucketHigh( b );
+                }
+            }
+            return bucketHigh( bucketCount - 1U );
         }
 
     private:
-        std::array< Data, maxNumCpus + 2 > vec_;
+        unsigned slotCount_;
+        uint64 volatile * vec_;
     };
 
     namespace impl {
@@ -20,9 +20,33 @@ TOOLS_FORCE_INLINE tools::uint64 operator "" _ms(long double milliseconds) { ret
 TOOLS_FORCE_INLINE tools::uint64 operator "" _s(long double seconds) { return static_cast<tools::uint64>(seconds * TOOLS_NANOSECONDS_PER_SECOND); }
 
 namespace tools {
+    // A timer request. Until it fires, it can be cancelled, which finishes it with a cancel error, or be given a
+    // new deadline. Both return false once it has fired or been cancelled (or before it is started). A cancelled
+    // timer usually finishes before cancel returns, but one started only a moment ago may finish shortly after
+    // on the timer thread.
+    struct Timer
+        : Request
+    {
+        virtual bool cancel( void ) = 0;
+        // Now due this long from the call.
+        virtual bool reschedule( uint64 ) = 0;
+    };
+
+    // Timer wakeup metrics. These are gathered without locks and so are approximate.
+    struct TimingStats
+    {
+        uint64 wakeups_;  // Times the timer thread woke and fired something
+        uint64 fired_;  // Timers fired
+        uint64 saved_;  // Further wakeups firing at the exact deadlines would have taken
+    };
+
     struct Timing {
         virtual uint64 mark( void ) = 0;
         virtual uint64 mark( uint64 ) = 0;
-        virtual AutoDispose< Request > timer( uint64, uint64 * = 0 ) = 0;
+        // The last argument is slack: how much later than due the timer may fire. Timers whose windows overlap
+        // are moved to a common point within them, so that they fire on a single wakeup. A timer never fires
+        // early.
+        virtual AutoDispose< Timer > timer( uint64, uint64 * = 0, uint64 = 0 ) = 0;
+        virtual TimingStats stats( void ) = 0;
     };
 };  // tools namespace
@@ -74,11 +74,13 @@
 #endif // WINDOWS_PLATFORM
 #ifdef UNIX_PLATFORM
 #  ifdef __GNUC__
-#    ifdef __i386__
+// The x86 paths use the SSE 4.2 crc32 instruction, 64 bit form included. Without -msse4.2 (or a -march that
+// implies it) x86-64 builds take the TOOLS_ARCH_UNKNOWN paths, which check for it at runtime.
+#    if defined(__x86_64__) && defined(__SSE4_2__)
 #      define TOOLS_ARCH_X86
-#    else // __i386__
+#    else // __x86_64__ && __SSE4_2__
 #      define TOOLS_ARCH_UNKNOWN
-#    endif // __i386__
+#    endif // __x86_64__ && __SSE4_2__
 #  else // __GNUC__
 #    define TOOLS_ARCH_UNKNOWN
 #  endif // __GNUC__
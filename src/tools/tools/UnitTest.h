@@ -158,6 +158,10 @@ namespace tools {
         virtual void generatorNext(NoDispose<Generator> const &, unsigned = 5) = 0;
 	};
 
+    // Tests which time something print what they measured only when TOOLS_TEST_TIMINGS is set in the
+    // environment. They assert on relative timings either way.
+    TOOLS_API bool testTimingsReported(void);
+
     struct AutoMock
     {
         virtual void factory(Test & test, NoDispose<TestEnv> subEnv) = 0;
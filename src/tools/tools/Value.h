@@ -5,8 +5,13 @@
 #include <tools/Interface.h>
 #include <tools/Tools.h>
 
+#include <tools/Memory.h>
+#include <tools/String.h>
+
+#include <new>
+#include <string.h>
+#include <type_traits>
 #include <typeinfo>
-#include <boost/any.hpp>
 #include <boost/type_traits.hpp>
 
 namespace tools {
@@ -19,6 +24,7 @@ namespace tools {
       virtual bool isPointer( void ) const = 0;
       virtual size_t sizeOf( void ) const = 0;
       virtual StringId const & typeName( void ) const = 0;
+      virtual std::type_info const & typeInfo( void ) const = 0;
     };
 
     template< typename TypeT >
@@ -31,6 +37,7 @@ namespace tools {
       bool isPointer( void ) const { return boost::is_pointer< TypeT >::value; }
       size_t sizeOf( void ) const { return sizeof( TypeT ); }
       StringId const & typeName( void ) const { return tools::nameOf< TypeT >(); }
+      std::type_info const & typeInfo( void ) const { return typeid( TypeT ); }
       static ValueTypeInfoBase const * getSingleton( void ) {
         static const ValueTypeInfo< TypeT > singleton;
         return static_cast< ValueTypeInfoBase const * >( &singleton );
@@ -48,21 +55,134 @@ namespace tools {
       bool isPointer( void ) const { return false; }
       size_t sizeOf( void ) const { return 0; }
       StringId const & typeName( void ) const { return tools::nameOf< void >(); }
+      std::type_info const & typeInfo( void ) const { return typeid( void ); }
       static ValueTypeInfoBase const * getSingleton( void ) {
         static const ValueTypeInfo< void > singleton;
         return static_cast< ValueTypeInfoBase const * >( &singleton );
       }
     };
+
+    // How a Value holds its payload. Scalars, StringIds, pointers and small trivially copyable types are
+    // stored inline. Anything else is boxed on the heap.
+    enum ValueTag : uint8 {
+      valueTagVoid,
+      valueTagBool,
+      valueTagSint8,
+      valueTagSint16,
+      valueTagSint32,
+      valueTagSint64,
+      valueTagUint8,
+      valueTagUint16,
+      valueTagUint32,
+      valueTagUint64,
+      valueTagFloat,
+      valueTagDouble,
+      valueTagStringId,
+      valueTagPointer,
+      valueTagInline,
+      valueTagBoxed,
+    };
+
+    enum : size_t {
+      valueInlineBytes = 2U * sizeof( void * ),
+    };
+
+    template< bool isSigned, size_t size > struct ValueIntegerTag;
+    template<> struct ValueIntegerTag< true, 1 > { static const ValueTag tag = valueTagSint8; typedef sint8 Type; };
+    template<> struct ValueIntegerTag< true, 2 > { static const ValueTag tag = valueTagSint16; typedef sint16 Type; };
+    template<> struct ValueIntegerTag< true, 4 > { static const ValueTag tag = valueTagSint32; typedef sint32 Type; };
+    template<> struct ValueIntegerTag< true, 8 > { static const ValueTag tag = valueTagSint64; typedef sint64 Type; };
+    template<> struct ValueIntegerTag< false, 1 > { static const ValueTag tag = valueTagUint8; typedef uint8 Type; };
+    template<> struct ValueIntegerTag< false, 2 > { static const ValueTag tag = valueTagUint16; typedef uint16 Type; };
+    template<> struct ValueIntegerTag< false, 4 > { static const ValueTag tag = valueTagUint32; typedef uint32 Type; };
+    template<> struct ValueIntegerTag< false, 8 > { static const ValueTag tag = valueTagUint64; typedef uint64 Type; };
+
+    // Which tag a (decayed) type is stored with.
+    template< typename TypeT, typename EnableT = void >
+    struct ValueTagOf {
+      static const ValueTag tag = ( boost::has_trivial_copy< TypeT >::value && boost::has_trivial_destructor< TypeT >::value
+        && ( sizeof( TypeT ) <= valueInlineBytes ) && ( std::alignment_of< TypeT >::value <= std::alignment_of< double >::value )
+        && ( std::alignment_of< TypeT >::value <= std::alignment_of< void * >::value )) ? valueTagInline : valueTagBoxed;
+    };
+
+    template<>
+    struct ValueTagOf< bool > {
+      static const ValueTag tag = valueTagBool;
+      typedef bool Type;
+    };
+
+    template< typename TypeT >
+    struct ValueTagOf< TypeT, typename std::enable_if< std::is_integral< TypeT >::value && !std::is_same< TypeT, bool >::value >::type >
+      : ValueIntegerTag< std::is_signed< TypeT >::value, sizeof( TypeT ) >
+    {};
+
+    template<>
+    struct ValueTagOf< float > {
+      static const ValueTag tag = valueTagFloat;
+      typedef float Type;
+    };
+
+    template<>
+    struct ValueTagOf< double > {
+      static const ValueTag tag = valueTagDouble;
+      typedef double Type;
+    };
+
+    template<>
+    struct ValueTagOf< StringId > {
+      static const ValueTag tag = valueTagStringId;
+    };
+
+    template< typename TypeT >
+    struct ValueTagOf< TypeT *, typename std::enable_if< !std::is_function< TypeT >::value >::type > {
+      static const ValueTag tag = valueTagPointer;
+    };
+
+    struct ValueBox
+      : AllocStatic<>
+    {
+      virtual ~ValueBox( void ) {}
+      virtual ValueBox * clone( void ) const = 0;
+      virtual void const * get( void ) const = 0;
+    };
+
+    template< typename TypeT >
+    struct ValueBoxOf
+      : ValueBox
+    {
+      ValueBoxOf( TypeT const & v ) : value_( v ) {}
+      ValueBox * clone( void ) const { return new ValueBoxOf< TypeT >( value_ ); }
+      void const * get( void ) const { return &value_; }
+
+      TypeT value_;
+    };
   }; // namespace impl
 
   struct Value {
-    Value( void ) : type_( impl::ValueTypeInfo< void >::getSingleton() ) {}
-    template< typename TypeT >
-    Value( TypeT const & v ) : value_( v ), type_( impl::ValueTypeInfo< TypeT >::getSingleton() ) {};
-    Value( Value const & c ) : value_( c.value_ ), type_( c.type_ ) {}
-    Value const & operator=( Value const & c ) { value_ = c.value_; type_ = c.type_; return *this; }
+    Value( void ) : tag_( impl::valueTagVoid ), type_( impl::ValueTypeInfo< void >::getSingleton() ) {}
+    template< typename TypeT, typename = typename std::enable_if< !std::is_same< typename std::decay< TypeT >::type, Value >::value >::type >
+    Value( TypeT const & v ) : tag_( impl::valueTagVoid ), type_( impl::ValueTypeInfo< void >::getSingleton() ) { assign( v ); }
+    Value( Value const & c ) : tag_( impl::valueTagVoid ), type_( impl::ValueTypeInfo< void >::getSingleton() ) { copyFrom( c ); }
+    Value( Value && c ) throw() : tag_( impl::valueTagVoid ), type_( impl::ValueTypeInfo< void >::getSingleton() ) { moveFrom( c ); }
+    ~Value( void ) { reset(); }
+    Value const & operator=( Value const & c ) {
+      if( this != &c ) {
+        Value next( c );
+        reset();
+        moveFrom( next );
+      }
+      return *this;
+    }
+    Value const & operator=( Value && c ) throw() {
+      if( this != &c ) {
+        reset();
+        moveFrom( c );
+      }
+      return *this;
+    }
+    // The new value is built before the old is released, v may refer into this Value.
     template< typename TypeT >
-    void set( TypeT const & v ) { value_ = v; type_ = impl::ValueTypeInfo< TypeT >::getSingleton(); }
+    void set( TypeT const & v ) { Value next( v ); *this = std::move( next ); }
     bool operator!( void ) const { return !( type_->isVoid() ); }
     inline bool isVoid( void ) const { return type_->isVoid(); }
     inline bool isInteger( void ) const { return type_->isInteger(); }
@@ -71,9 +191,129 @@ namespace tools {
     inline bool isPointer( void ) const { return type_->isPointer(); }
     inline size_t sizeOf( void ) const { return type_->sizeOf(); }
     inline StringId const & typeName( void ) const { return type_->typeName(); }
+    inline impl::ValueTag tag( void ) const { return tag_; }
 
-    boost::any value_;
+    // Whether this holds exactly a TypeT (after array and function decay).
+    template< typename TypeT >
+    bool isType( void ) const {
+      typedef typename std::decay< TypeT >::type StoredT;
+      return ( type_ == impl::ValueTypeInfo< StoredT >::getSingleton() ) || ( type_->typeInfo() == typeid( StoredT ));
+    }
+
+    // The held StringId, inline or boxed value if it is exactly a TypeT, otherwise nullptr. Use
+    // interpret_cast for scalars and pointers.
+    template< typename TypeT >
+    TypeT const * getIf( void ) const {
+      static_assert( impl::ValueTagOf< TypeT >::tag >= impl::valueTagStringId && impl::ValueTagOf< TypeT >::tag != impl::valueTagPointer,
+        "getIf is for StringId and non-scalar types" );
+      if( !isType< TypeT >() ) {
+        return nullptr;
+      }
+      if( tag_ == impl::valueTagBoxed ) {
+        return static_cast< TypeT const * >( storage_.box_->get() );
+      }
+      return reinterpret_cast< TypeT const * >( storage_.bytes_ );
+    }
+
+    union Storage {
+      bool bool_;
+      sint8 sint8_;
+      sint16 sint16_;
+      sint32 sint32_;
+      sint64 sint64_;
+      uint8 uint8_;
+      uint16 uint16_;
+      uint32 uint32_;
+      uint64 uint64_;
+      float float_;
+      double double_;
+      void const * pointer_;
+      impl::ValueBox * box_;
+      char bytes_[ impl::valueInlineBytes ];
+    };
+
+    Storage storage_;
+    impl::ValueTag tag_;
     impl::ValueTypeInfoBase const * type_;
+  private:
+    template< impl::ValueTag tagT >
+    struct TagType : std::integral_constant< impl::ValueTag, tagT > {};
+
+    template< typename TypeT >
+    void assign( TypeT const & v ) {
+      typedef typename std::decay< TypeT const >::type StoredT;
+      static const impl::ValueTag storedTag = impl::ValueTagOf< StoredT >::tag;
+      assignAs< StoredT >( v, TagType< ( storedTag < impl::valueTagStringId ) ? impl::valueTagBool : storedTag >() );
+      tag_ = storedTag;
+      type_ = impl::ValueTypeInfo< StoredT >::getSingleton();
+    }
+    // Scalars are stored as the fixed width type their tag names.
+    template< typename StoredT >
+    void assignAs( StoredT const & v, TagType< impl::valueTagBool > ) {
+      typename impl::ValueTagOf< StoredT >::Type scaler = static_cast< typename impl::ValueTagOf< StoredT >::Type >( v );
+      memcpy( storage_.bytes_, &scaler, sizeof( scaler ));
+    }
+    template< typename StoredT >
+    void assignAs( StringId const & v, TagType< impl::valueTagStringId > ) {
+      static_assert( sizeof( StringId ) <= impl::valueInlineBytes, "StringId must fit inline in a Value" );
+      new( storage_.bytes_ ) StringId( v );
+    }
+    template< typename StoredT >
+    void assignAs( StoredT const & v, TagType< impl::valueTagPointer > ) {
+      storage_.pointer_ = const_cast< void const * >( static_cast< void const volatile * >( v ));
+    }
+    template< typename StoredT >
+    void assignAs( StoredT const & v, TagType< impl::valueTagInline > ) {
+      memcpy( storage_.bytes_, &v, sizeof( StoredT ));
+    }
+    template< typename StoredT >
+    void assignAs( StoredT const & v, TagType< impl::valueTagBoxed > ) {
+      storage_.box_ = new impl::ValueBoxOf< StoredT >( v );
+    }
+    void copyFrom( Value const & c ) {
+      switch( c.tag_ ) {
+      case impl::valueTagStringId:
+        new( storage_.bytes_ ) StringId( *reinterpret_cast< StringId const * >( c.storage_.bytes_ ));
+        break;
+      case impl::valueTagBoxed:
+        storage_.box_ = c.storage_.box_->clone();
+        break;
+      default:
+        storage_ = c.storage_;
+        break;
+      }
+      tag_ = c.tag_;
+      type_ = c.type_;
+    }
+    // Leaves c void.
+    void moveFrom( Value & c ) {
+      tag_ = c.tag_;
+      type_ = c.type_;
+      if( c.tag_ == impl::valueTagStringId ) {
+        new( storage_.bytes_ ) StringId( std::move( *reinterpret_cast< StringId * >( c.storage_.bytes_ )));
+      } else {
+        storage_ = c.storage_;
+        if( c.tag_ == impl::valueTagBoxed ) {
+          // The box is ours now
+          c.tag_ = impl::valueTagVoid;
+        }
+      }
+      c.reset();
+    }
+    void reset( void ) {
+      switch( tag_ ) {
+      case impl::valueTagStringId:
+        reinterpret_cast< StringId * >( storage_.bytes_ )->~StringId();
+        break;
+      case impl::valueTagBoxed:
+        delete storage_.box_;
+        break;
+      default:
+        break;
+      }
+      tag_ = impl::valueTagVoid;
+      type_ = impl::ValueTypeInfo< void >::getSingleton();
+    }
   };
 
   //struct ValueException : Exception {
@@ -108,6 +348,21 @@ namespace tools {
     TOOLS_API float ValueToFloat( Value const & );
     TOOLS_API double ValueToDouble( Value const & );
 
+    // Column conversions: interpret count Values into a contiguous array. Values which cannot be converted
+    // are stored as 0 (or null). Returns how many converted.
+    TOOLS_API size_t ValuesToStringId( Value const *, size_t, StringId * );
+    TOOLS_API size_t ValuesToBool( Value const *, size_t, bool * );
+    TOOLS_API size_t ValuesToSint8( Value const *, size_t, sint8 * );
+    TOOLS_API size_t ValuesToSint16( Value const *, size_t, sint16 * );
+    TOOLS_API size_t ValuesToSint32( Value const *, size_t, sint32 * );
+    TOOLS_API size_t ValuesToSint64( Value const *, size_t, sint64 * );
+    TOOLS_API size_t ValuesToUint8( Value const *, size_t, uint8 * );
+    TOOLS_API size_t ValuesToUint16( Value const *, size_t, uint16 * );
+    TOOLS_API size_t ValuesToUint32( Value const *, size_t, uint32 * );
+    TOOLS_API size_t ValuesToUint64( Value const *, size_t, uint64 * );
+    TOOLS_API size_t ValuesToFloat( Value const *, size_t, float * );
+    TOOLS_API size_t ValuesToDouble( Value const *, size_t, double * );
+
     template< typename TypeT >
     TypeT interpretAsIntegral( Value const & v ) {
       if( boost::is_signed< TypeT >::value ) {
@@ -138,7 +393,6 @@ namespace tools {
         }
       }
       // what exactly do we have here?
-      throw ValueException( v.typeName(), tools::nameOf< TypeT >() );
       return TypeT();
     }
 
@@ -153,44 +407,39 @@ namespace tools {
         break;
       }
       // what exactly do we have here?
-      throw ValueException( v.typeName(), tools::nameOf< TypeT >() );
       return TypeT();
     }
   };  // namespace impl
 
   namespace detail {
+    // Conversions never throw. A Value which cannot be interpreted as the requested type yields its default.
     template< typename TypeT >
     struct InterpretCastOp {
       TypeT operator()( Value const & v ) const {
-        // try the general case first
-        try {
-          return boost::any_cast< TypeT >( v.value_ );
-        }
-        catch( boost::bad_any_cast const & ) {
-        }
-        if( boost::is_integral< TypeT >::value ) {
-          return impl::interpretAsIntegral< TypeT >( v );
-        }
-        if( boost::is_floating_point< TypeT >::value ) {
-          return impl::interpretAsFloat< TypeT >( v );
-        }
-        // TODO: implement this
-        throw ValueException( v.typeName(), tools::nameOf< TypeT >() );
-        return TypeT();
+        return interpret( v, std::integral_constant< int, boost::is_integral< TypeT >::value ? 1 : ( boost::is_floating_point< TypeT >::value ? 2 : 0 ) >() );
+      }
+    private:
+      static TypeT interpret( Value const & v, std::integral_constant< int, 1 > ) {
+        return impl::interpretAsIntegral< TypeT >( v );
+      }
+      static TypeT interpret( Value const & v, std::integral_constant< int, 2 > ) {
+        return impl::interpretAsFloat< TypeT >( v );
+      }
+      static TypeT interpret( Value const & v, std::integral_constant< int, 0 > ) {
+        // TODO: implement conversions between other types
+        TypeT const * ret = v.getIf< TypeT >();
+        return !ret ? TypeT() : *ret;
       }
     };
 
     template< typename TypeT >
     struct InterpretCastOp< TypeT * > {
       TypeT * operator()( Value const & v ) const {
-        try {
-          return boost::any_cast< TypeT * >( v.value_ );
-        }
-        catch( boost::bad_any_cast const & ) {
+        if(( v.tag() == impl::valueTagPointer ) && v.isType< TypeT * >() ) {
+          return static_cast< TypeT * >( const_cast< void * >( v.storage_.pointer_ ));
         }
         // TODO: implement this
-        throw ValueException( v.typeName(), tools::nameOf< TypeT * >() );
-        return (TypeT *)0L;
+        return nullptr;
       }
     };
 
@@ -221,6 +470,20 @@ namespace tools {
     return detail::InterpretCastOp< TypeT >()( v );
   }
 
+  // interpret_cast a whole column of Values at once. Returns how many converted, the rest are 0 (or null).
+  inline size_t interpretColumn( Value const * values, size_t count, StringId * out ) { return impl::ValuesToStringId( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, bool * out ) { return impl::ValuesToBool( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, sint8 * out ) { return impl::ValuesToSint8( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, sint16 * out ) { return impl::ValuesToSint16( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, sint32 * out ) { return impl::ValuesToSint32( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, sint64 * out ) { return impl::ValuesToSint64( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, uint8 * out ) { return impl::ValuesToUint8( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, uint16 * out ) { return impl::ValuesToUint16( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, uint32 * out ) { return impl::ValuesToUint32( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, uint64 * out ) { return impl::ValuesToUint64( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, float * out ) { return impl::ValuesToFloat( values, count, out ); }
+  inline size_t interpretColumn( Value const * values, size_t count, double * out ) { return impl::ValuesToDouble( values, count, out ); }
+
   //typedef Iterator< Value > ValueIterator;
   //typedef Iterator< Value const > ValueConstIterator;
 
@@ -79,6 +79,28 @@ namespace tools {
     TOOLS_API PhantomCloak & definePhantomLocal( PhantomRealTime *** );
     TOOLS_API PhantomPrototype & definePhantomPrototype( PhantomRealTime *** );
 
+    // Epoch-based phantoms. Cloaking, touching and uncloaking only write to a per-thread epoch record, so
+    // there is no global sequence traffic on the hot path. Finalized Weaklings are batched per thread, and
+    // disposed by the finalizing thread itself (a 'help reclaim' step) once every cloaked thread has been
+    // seen in a later epoch. A thread that stays cloaked still holds up reclamation of anything finalized
+    // since it cloaked, but a long running task can touch() cheaply and often to avoid that. Weaklings
+    // are disposed while the disposing thread is cloaked in this phantom.
+    struct PhantomEpoch {};
+
+    TOOLS_API PhantomCloak & definePhantomLocal( PhantomEpoch *** );
+    TOOLS_API PhantomPrototype & definePhantomPrototype( PhantomEpoch *** );
+
+    // Reclamation metrics for PhantomEpoch. These are gathered without locks and so are approximate.
+    struct PhantomEpochStats
+    {
+        uint64 epoch_;  // The current global epoch
+        uint64 pending_;  // Weaklings finalized, but not yet disposed
+        uint64 disposed_;  // Weaklings disposed since startup
+        uint64 lag_;  // Epochs between the global epoch and the oldest cloaked thread (0 if none)
+    };
+
+    TOOLS_API PhantomEpochStats phantomEpochStats( void );
+
     // Verify the current thread is cloaked.  If not it is likely any phantom protected structure is
     // unstable.
     template< typename PhantomT >
@@ -42,8 +42,12 @@ namespace {
         // ConditionVar
         AutoDispose< Monitor > monitorNew( impl::ResourceSample const & );
         void wait( void );
+        void wait( uint64 );
         void signal( bool );
 
+        // local methods
+        void waitInner( DWORD );
+
         CONDITION_VARIABLE cvar_;
     };
 
@@ -223,6 +227,27 @@ namespace tools {
             return static_cast< uint32 >( GetCurrentProcessorNumber() );
         }
 
+        uint32
+        cpuCount( void )
+        {
+            static uint32 count = 0U;
+            if( !count ) {
+                count = std::max( static_cast< uint32 >( GetMaximumProcessorCount( ALL_PROCESSOR_GROUPS )), 1U );
+            }
+            return count;
+        }
+
+        bool
+        cpuLocalAdd(
+            uint64 volatile *,
+            size_t,
+            unsigned,
+            uint64 )
+        {
+            // No restartable sequences here, always use the atomic fallback.
+            return false;
+        }
+
         AutoDispose< ThreadSleepVariable >
         threadSleepVariableNew( void )
         {
@@ -395,6 +420,22 @@ SimpleConditionVar::monitorNew(
 
 void
 SimpleConditionVar::wait( void )
+{
+    waitInner( INFINITE /* 177817 */ );
+}
+
+void
+SimpleConditionVar::wait(
+    uint64 timeout )
+{
+    // Round up to whole milliseconds, so that a short timeout doesn't become a busy loop.
+    uint64 msec = ( timeout + TOOLS_NANOSECONDS_PER_MILLISECOND - 1U ) / TOOLS_NANOSECONDS_PER_MILLISECOND;
+    waitInner( static_cast< DWORD >( std::min< uint64 >( msec, INFINITE - 1U )));
+}
+
+void
+SimpleConditionVar::waitInner(
+    DWORD timeout )
 {
     impl::ConditionVarLock ** cvarMonitor = impl::conditionVarPlatformLockRef( this );
     impl::ConditionVarLock * lockVal = *cvarMonitor;
@@ -409,7 +450,7 @@ SimpleConditionVar::wait( void )
     // Since condition variables users must tollerate spurrious wakeups, insert some to
     // prevent spurious drops (about 5 minutes).
     SleepConditionVariableSRW( &cvar_, &static_cast< SrwMonitor * >( lockVal->monitor_ )->lock_,
-        INFINITE /* 177817 */, 0 );
+        timeout, 0 );
 
     TOOLS_ASSERT( !lockVal->lock_ );
     lockVal->lock_ = lock;
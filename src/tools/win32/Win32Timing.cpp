@@ -52,7 +52,8 @@ struct TimingImpl
     // Timing
     uint64 mark( void );
     uint64 mark( uint64 );
-    AutoDispose< Request > timer( uint64, uint64 * );
+    AutoDispose< Timer > timer( uint64, uint64 *, uint64 );
+    TimingStats stats( void );
 
     double                          timerFreq_;  // in nanoseconds
     AutoDispose< WinTimerThread >   timerThread_;
@@ -77,6 +78,32 @@ tools::impl::getHighResTime( void )
     return numeric_cast< uint64 >( i.QuadPart * ( 1000000000LL / j.QuadPart ));
 }
 
+uint64
+tools::impl::getOsTime( void )
+{
+    return getHighResTime();
+}
+
+bool
+tools::impl::highResTimeFromTsc( void )
+{
+    // QueryPerformanceCounter already reads the TSC when Windows judges it invariant.
+    return false;
+}
+
+uint64
+tools::impl::getThreadCpuTime( void )
+{
+    FILETIME creation, exit, kernel, user;
+    if( !GetThreadTimes( GetCurrentThread(), &creation, &exit, &kernel, &user )) {
+        return 0U;
+    }
+    // FILETIMEs count 100ns intervals.
+    uint64 total = ( static_cast< uint64 >( kernel.dwHighDateTime ) << 32 ) + kernel.dwLowDateTime +
+        ( static_cast< uint64 >( user.dwHighDateTime ) << 32 ) + user.dwLowDateTime;
+    return total * 100U;
+}
+
 /////////////////
 // WinTimerThread
 /////////////////
@@ -184,10 +211,21 @@ TimingImpl::mark(
         numeric_cast< sint64 >( begin )) * timerFreq_ );
 }
 
-AutoDispose< Request >
+AutoDispose< Timer >
 TimingImpl::timer(
     uint64      duration,
-    uint64 *    startTime )
+    uint64 *    startTime,
+    uint64      slack )
+{
+    // Scheduler workers keep the timers they make, so that they fire on the same thread.
+    if( TimerQueueOwner * local = impl::timerQueueLocal() ) {
+        return std::move( local->queue().timer( duration, startTime, slack ));
+    }
+    return std::move( timerThread_->queue_->timer( duration, startTime, slack ));
+}
+
+TimingStats
+TimingImpl::stats( void )
 {
-    return std::move( timerThread_->queue_->timer( duration, startTime ));
+    return timerThread_->queue_->stats();
 }
@@ -8,6 +8,8 @@
 #include "Win32Tools.h"
 #include <assert.h>
 #include <DbgHelp.h>
+#include <algorithm>
+#include <string>
 #ifdef WINDOWS_PLATFORM
 #  pragma warning( default : 4987 )
 #endif // WINDOWS_PLATFORM
@@ -31,6 +33,81 @@ tools::impl::isAbnormalShutdown( void )
     return !shutdownOk;
 }
 
+namespace tools {
+    namespace impl {
+        void const *
+        platformMapFile(
+            char const * path,
+            size_t * size )
+        {
+            HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+            if( file == INVALID_HANDLE_VALUE ) {
+                return nullptr;
+            }
+            void const * ret = nullptr;
+            LARGE_INTEGER fileSize;
+            if( GetFileSizeEx( file, &fileSize ) && ( fileSize.QuadPart > 0 )) {
+                HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+                if( !!mapping ) {
+                    // The view keeps the mapping (and file) open
+                    ret = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+                    if( !!ret ) {
+                        *size = static_cast< size_t >( fileSize.QuadPart );
+                    }
+                    CloseHandle( mapping );
+                }
+            }
+            CloseHandle( file );
+            return ret;
+        }
+
+        void
+        platformUnmapFile(
+            void const * site,
+            size_t )
+        {
+#ifdef TOOLS_DEBUG
+            bool success = !!
+#endif // TOOLS_DEBUG
+                UnmapViewOfFile( site );
+            TOOLS_ASSERT( success );
+        }
+
+        bool
+        platformWriteFile(
+            char const * path,
+            void const * data,
+            size_t size )
+        {
+            // Write aside and rename, so that nobody maps a partial file.
+            std::string temp( path );
+            temp.append( ".tmp" );
+            HANDLE file = CreateFileA( temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+            if( file == INVALID_HANDLE_VALUE ) {
+                return false;
+            }
+            char const * next = static_cast< char const * >( data );
+            char const * end = next + size;
+            while( next != end ) {
+                DWORD written = 0;
+                DWORD chunk = static_cast< DWORD >( std::min< size_t >( end - next, 1U << 30 ));
+                if( !WriteFile( file, next, chunk, &written, nullptr ) || !written ) {
+                    break;
+                }
+                next += written;
+            }
+            bool ret = !!CloseHandle( file ) && ( next == end );
+            if( ret ) {
+                ret = !!MoveFileExA( temp.c_str(), path, MOVEFILE_REPLACE_EXISTING );
+            }
+            if( !ret ) {
+                DeleteFileA( temp.c_str() );
+            }
+            return ret;
+        }
+    };  // impl namespace
+};  // tools namespace
+
 static BOOL WINAPI
 CtrlHandlerCallback(
         DWORD /*ctrlType*/)